@@ -522,6 +522,13 @@ void Adafruit_GFX::setRotation(uint8_t x) {
   }
 }
 
+uint8_t Adafruit_GFX::fontColumn(unsigned char c, uint8_t i) {
+  if (i >= 5) return 0x0;
+  if (c >= 176) c++; // 'classic' charset behavior
+
+  return pgm_read_byte(font+(c*5)+i);
+}
+
 // Enable (or disable) Code Page 437-compatible charset.
 // There was an error in glcdfont.c for the longest time -- one character
 // (#176, the 'light shade' block) was missing -- this threw off the index
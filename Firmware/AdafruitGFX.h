@@ -73,6 +73,11 @@ class Adafruit_GFX : public Print {
 
   uint8_t getRotation(void) const;
 
+  // column i (0 to 5, the last is the spacing) of character c of the font
+  // used by drawChar(), bit 0 is the top pixel. The classic charset is used
+  // (as with cp437(false))
+  static uint8_t fontColumn(unsigned char c, uint8_t i);
+
   // get current cursor position (get rotation safe maximum values, using: width() for x, height() for y)
   int16_t getCursorX(void) const;
   int16_t getCursorY(void) const;
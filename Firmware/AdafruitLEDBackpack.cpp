@@ -18,14 +18,13 @@
   MIT license, all text above must be included in any redistribution
  ****************************************************/
 
-#ifdef __AVR_ATtiny85__
- #include <TinyWireM.h>
- #define Wire TinyWireM
-#else
- #include <Wire.h>
-#endif
+// Transactions are queued and transferred by the TWI interrupt, so that
+// writeDisplay() doesn't wait for the bus
+#include "twiqueue.h"
+#define Wire twiQueue
 #include "AdafruitLEDBackpack.h"
 #include "AdafruitGFX.h"
+#include "matrixblit.h"
 
 #ifndef _BV
   #define _BV(bit) (1<<(bit))
@@ -198,6 +197,7 @@ void Adafruit_LEDBackpack::blinkRate(uint8_t b) {
 }
 
 Adafruit_LEDBackpack::Adafruit_LEDBackpack(void) {
+  writtenvalid = false;
 }
 
 void Adafruit_LEDBackpack::begin(uint8_t _addr = 0x70) {
@@ -220,8 +220,40 @@ void Adafruit_LEDBackpack::writeDisplay(void) {
   for (uint8_t i=0; i<8; i++) {
     Wire.write(displaybuffer[i] & 0xFF);    
     Wire.write(displaybuffer[i] >> 8);    
+    writtenbuffer[i] = displaybuffer[i];
   }
   Wire.endTransmission();  
+  writtenvalid = true;
+}
+
+uint8_t Adafruit_LEDBackpack::writeDisplayChanges(void) {
+  if (!writtenvalid) {
+    writeDisplay();
+    return 8;
+  }
+
+  // finding the first and last changed rows, the ones in between are
+  // written as well (the address auto increments)
+  uint8_t first = 8, last = 0;
+  for (uint8_t i=0; i<8; i++) {
+    if (displaybuffer[i] != writtenbuffer[i]) {
+      if (first == 8) first = i;
+      last = i;
+    }
+  }
+  if (first == 8) return 0;
+
+  Wire.beginTransmission(i2c_addr);
+  Wire.write((uint8_t)(first * 2)); // two bytes of display RAM for each row
+
+  for (uint8_t i=first; i<=last; i++) {
+    Wire.write(displaybuffer[i] & 0xFF);    
+    Wire.write(displaybuffer[i] >> 8);    
+    writtenbuffer[i] = displaybuffer[i];
+  }
+  Wire.endTransmission();  
+
+  return last - first + 1;
 }
 
 void Adafruit_LEDBackpack::clear(void) {
@@ -369,6 +401,18 @@ void Adafruit_8x8matrix::drawPixel(int16_t x, int16_t y, uint16_t color) {
   }
 }
 
+void Adafruit_8x8matrix::drawRows(const uint8_t *bitmap) {
+  uint8_t rows[8];
+  memcpy_P(rows, bitmap, 8);
+
+  // the rotation and the wiring of the display are applied to whole rows
+  blitMatrixRows(rows, getRotation(), displaybuffer);
+}
+
+void Adafruit_8x8matrix::drawColumns(const uint8_t *columns) {
+  blitMatrixColumns(columns, getRotation(), displaybuffer);
+}
+
 /******************************* 8x8 BICOLOR MATRIX OBJECT */
 
 Adafruit_BicolorMatrix::Adafruit_BicolorMatrix(void) : Adafruit_GFX(8, 8) {
@@ -26,11 +26,6 @@
  #include "WProgram.h"
 #endif
 
-#ifdef __AVR_ATtiny85__
- #include <TinyWireM.h>
-#else
- #include <Wire.h>
-#endif
 #include "AdafruitGFX.h"
 
 #define LED_ON 1
@@ -62,6 +57,9 @@ class Adafruit_LEDBackpack {
   void setBrightness(uint8_t b);
   void blinkRate(uint8_t b);
   void writeDisplay(void);
+  // only writes the rows of displaybuffer changed since the last write, in
+  // a single transaction. Returns the number of rows written
+  uint8_t writeDisplayChanges(void);
   void clear(void);
 
   uint16_t displaybuffer[8]; 
@@ -69,6 +67,10 @@ class Adafruit_LEDBackpack {
   void init(uint8_t a);
  protected:
   uint8_t i2c_addr;
+ private:
+  // the rows the display is showing, valid if writtenvalid is true
+  uint16_t writtenbuffer[8];
+  boolean writtenvalid;
 };
 
 class Adafruit_AlphaNum4 : public Adafruit_LEDBackpack {
@@ -107,6 +109,12 @@ class Adafruit_8x8matrix : public Adafruit_LEDBackpack, public Adafruit_GFX {
   Adafruit_8x8matrix(void);
 
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  // replaces the whole display buffer with an 8x8 PROGMEM bitmap (same
+  // format as drawBitmap()), much faster than drawing it pixel by pixel
+  void drawRows(const uint8_t *bitmap);
+  // the same with the 8 columns of the bitmap in RAM, bit 0 is the top pixel
+  // (as in the font of drawChar())
+  void drawColumns(const uint8_t *columns);
 
  private:
 };
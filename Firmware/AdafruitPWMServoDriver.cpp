@@ -16,20 +16,25 @@
  ****************************************************/
 
 #include "AdafruitPWMServoDriver.h"
-#include <Wire.h>
-#if defined(__AVR__)
- #define WIRE Wire
-#elif defined(CORE_TEENSY) // Teensy boards
- #define WIRE Wire
-#else // Arduino Due
- #define WIRE Wire1
-#endif
+// Transactions are queued and transferred by the TWI interrupt, so that
+// setPWM() doesn't wait for the bus
+#include "twiqueue.h"
+#define WIRE twiQueue
 
 // Set to true to print some debug messages, or false to disable them.
 #define ENABLE_DEBUG_OUTPUT false
 
 Adafruit_PWMServoDriver::Adafruit_PWMServoDriver(uint8_t addr) {
   _i2caddr = addr;
+  _inFrame = false;
+
+  // We don't know the values of channels yet, so the first frame writes all
+  _frameFirst = 0;
+  _frameLast = PCA9685_CHANNELS - 1;
+  for (uint8_t i=0; i<PCA9685_CHANNELS; i++) {
+    _on[i] = 0;
+    _off[i] = 4096;
+  }
 }
 
 void Adafruit_PWMServoDriver::begin(void) {
@@ -40,6 +45,9 @@ void Adafruit_PWMServoDriver::begin(void) {
 
 void Adafruit_PWMServoDriver::reset(void) {
  write8(PCA9685_MODE1, 0x0);
+ // Outputs change on stop (OCH = 0) with totem pole structure (the default),
+ // so all channels written in a transaction change at the same time
+ write8(PCA9685_MODE2, 0x04);
 }
 
 void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
@@ -63,6 +71,7 @@ void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
   write8(PCA9685_MODE1, newmode); // go to sleep
   write8(PCA9685_PRESCALE, prescale); // set the prescaler
   write8(PCA9685_MODE1, oldmode);
+  WIRE.flush(); // the oscillator must be running before the delay starts
   delay(5);
   write8(PCA9685_MODE1, oldmode | 0xa1);  //  This sets the MODE1 register to turn on auto increment.
                                           // This is why the beginTransmission below was not working.
@@ -72,6 +81,18 @@ void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
 void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   //Serial.print("Setting PWM "); Serial.print(num); Serial.print(": "); Serial.print(on); Serial.print("->"); Serial.println(off);
 
+  if (_inFrame) {
+    if ((_on[num] != on) || (_off[num] != off)) {
+      _on[num] = on;
+      _off[num] = off;
+      if (num < _frameFirst) _frameFirst = num;
+      if (num > _frameLast) _frameLast = num;
+    }
+    return;
+  }
+  _on[num] = on;
+  _off[num] = off;
+
   WIRE.beginTransmission(_i2caddr);
   WIRE.write(LED0_ON_L+4*num);
   WIRE.write(on);
@@ -81,6 +102,33 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   WIRE.endTransmission();
 }
 
+void Adafruit_PWMServoDriver::beginFrame(void) {
+  _inFrame = true;
+}
+
+void Adafruit_PWMServoDriver::commitFrame(void) {
+  _inFrame = false;
+  if (_frameFirst > _frameLast) {
+    // Nothing changed
+    return;
+  }
+
+  // Registers auto increment (see setPWMFreq()), so all channels between the
+  // first and the last changed one are written in a single transaction
+  WIRE.beginTransmission(_i2caddr);
+  WIRE.write(LED0_ON_L+4*_frameFirst);
+  for (uint8_t i=_frameFirst; i<=_frameLast; i++) {
+    WIRE.write(_on[i]);
+    WIRE.write(_on[i]>>8);
+    WIRE.write(_off[i]);
+    WIRE.write(_off[i]>>8);
+  }
+  WIRE.endTransmission();
+
+  _frameFirst = PCA9685_CHANNELS;
+  _frameLast = 0;
+}
+
 // Sets pin without having to deal with on/off tick placement and properly handles
 // a zero value as completely off.  Optional invert parameter supports inverting
 // the pulse for sinking to ground.  Val should be a value from 0 to 4095 inclusive.
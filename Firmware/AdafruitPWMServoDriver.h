@@ -30,6 +30,7 @@
 #define PCA9685_SUBADR3 0x4
 
 #define PCA9685_MODE1 0x0
+#define PCA9685_MODE2 0x1
 #define PCA9685_PRESCALE 0xFE
 
 #define LED0_ON_L 0x6
@@ -42,6 +43,8 @@
 #define ALLLED_OFF_L 0xFC
 #define ALLLED_OFF_H 0xFD
 
+#define PCA9685_CHANNELS 16
+
 
 class Adafruit_PWMServoDriver {
  public:
@@ -51,12 +54,23 @@ class Adafruit_PWMServoDriver {
   void setPWMFreq(float freq);
   void setPWM(uint8_t num, uint16_t on, uint16_t off);
   void setPin(uint8_t num, uint16_t val, bool invert=false);
+  uint8_t read8(uint8_t addr);
+  void write8(uint8_t addr, uint8_t d);
+
+  // Between beginFrame() and commitFrame() setPWM() and setPin() only store
+  // values. commitFrame() writes all changed channels in a single transaction
+  // ending with a stop, so outputs change together (see reset())
+  void beginFrame(void);
+  void commitFrame(void);
 
  private:
   uint8_t _i2caddr;
 
-  uint8_t read8(uint8_t addr);
-  void write8(uint8_t addr, uint8_t d);
+  // The values of all channels and the range of channels changed since the
+  // last commitFrame() (empty when _frameFirst > _frameLast)
+  bool _inFrame;
+  uint8_t _frameFirst, _frameLast;
+  uint16_t _on[PCA9685_CHANNELS], _off[PCA9685_CHANNELS];
 };
 
 #endif
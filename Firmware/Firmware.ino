@@ -19,57 +19,94 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
  ******************************************************************************/
 
-// import Wire library to use I²C (I have to include it here because doing it
-// only in Adafruit_PWMServoDriver.cpp doesn't work...)
-#include <Wire.h>
 #include "serialcommunication.h"
 #include "sequenceplayer.h"
+#include "eventcodes.h"
+#include "interpolation.h"
 #include <stdlib.h>
 // import backpack library to use LED backpacks
 #include "AdafruitLEDBackpack.h"
 // import GFX library to draw bitmaps on LED backpacks
 #include "AdafruitGFX.h"
+// import the queue used to transfer data to I²C devices
+#include "twiqueue.h"
+// import the object sampling the battery in background
+#include "batterymonitor.h"
+// import the animations of the face
+#include "faceanimator.h"
 
-// The possible states
-enum States {IdleState, StreamMode, StreamModeStopping, ImmediateMode};
-
-// The minimum and maximum PWM value of all servos
+// The minimum and maximum PWM value of all servos (there must be one value for
+// each servo, see NUM_SERVOS in sequencepoint.h)
 const unsigned int servoMin[SequencePoint::dim] = {1150,  500,  500,  800,  900,  550,  800,  550,  920,  500,  750, 1000,  500,  750,  650, 1450};
 const unsigned int servoMax[SequencePoint::dim] = {1770, 1840, 1800, 2200, 1700, 1750, 2050, 1670, 2000, 1700, 2020, 1800, 1800, 1650, 2000, 2200};
 const unsigned int servoMid[SequencePoint::dim] = {1500, 1840, 1000, 1150, 1300, 1400, 1160, 1250, 1300, 1320, 1100, 1420, 1350, 1650,  650, 1800};
 
-// The current status
-States status = IdleState;
+// The current status (the possible states are in eventcodes.h, because they
+// are also sent in events)
+FirmwareState status = IdleState;
 // The baud rate to use for communication with computer
 const long baudRate = 115200;
 // The object that handles communication
 SerialCommunication serialCommunication;
 // The microseconds of the last loop
 unsigned long lastTime = 0;
+// The I²C addresses of the PWM boards (add one address for each board when
+// NUM_SERVOS is greater than 16). Servos 0 to 15 are on the first board, 16
+// to 31 on the second one and so on
+const unsigned char pwmBoardAddresses[SequencePlayer::numBoards] = {0x40};
 // The object controlling the servos
-SequencePlayer sequencePlayer(servoMin, servoMax);
-// Each how many milliseconds we should send the battery charge
-const unsigned long batteryInterval = 500;
-// The milliseconds we last sent the battery charge
-unsigned long lastBatteryTime = 0;
+SequencePlayer sequencePlayer(servoMin, servoMax, pwmBoardAddresses);
+// Each how many milliseconds we should send the status (point dimension,
+// saturation counts and I²C statistics)
+const unsigned long statusInterval = 500;
+// The milliseconds we last sent the status
+unsigned long lastStatusTime = 0;
 // This is true if the sequence buffer was full
 bool sequenceBufferWasFull = false;
+// The number of points received since the stream started (wraps around)
+unsigned int streamPoints = 0;
+// The number of buffer underruns since startup (wraps around)
+unsigned int underruns = 0;
+// True if the buffer ran empty while streaming and the next point has not
+// arrived yet
+bool underrunning = false;
+// The millis() at which the current underrun started
+unsigned long underrunStartTime = 0;
+// What to do with scheduled points that arrive late (e.g. after an underrun)
+const LatePointPolicy latePointPolicy = CatchUpLatePoints;
+// The number of late points skipped that has been reported to the PC
+unsigned char reportedDroppedPoints = 0;
 // Battery pin
 const int batteryPin = 3;
+// The battery charge is only sent when it changes by at least this much (255
+// is 100%)
+const unsigned char batteryReportThreshold = 3;
+// The battery charge is sent at least once every this many milliseconds
+const unsigned long batteryMaxReportInterval = 5000;
+// The drop of the battery reading caused by each moving servo in 1/16 of ADC
+// units (0 disables compensation). Measure it on the robot before enabling it
+const unsigned int batteryLoadCompensation = 0;
+// The object sampling the battery. 420 = 100% - 300 = 0%
+BatteryMonitor batteryMonitor(batteryPin, 300, 420);
+// Below this charge a message is scrolled on the face (255 is 100%)
+const unsigned char lowBatteryCharge = 25;
+// True if the battery low message has been shown. It is shown again only
+// after the battery has been recharged
+bool lowBatteryShown = false;
+// The I²C bus frequencies tried at startup, from the fastest. The first one
+// passing the bus test is used
+const unsigned long busFrequencies[] = {1000000, 400000, 100000};
+// The maximum I²C bus frequency. The HT16K33 of the face works up to 400 kHz,
+// the PCA9685 up to 1 MHz: raise this only if there is no face on the bus
+const unsigned long maxBusFrequency = 400000;
+// The number of register writes of the bus test
+const unsigned int busTestWrites = 100;
 
 // The face object
 Adafruit_8x8matrix face = Adafruit_8x8matrix();
 
-// A bitmap for a smile
-static const uint8_t PROGMEM smile_bmp[] =
-  { B00000000,
-    B01100110,
-    B00000000,
-    B00100100,
-    B00000000,
-    B01000010,
-    B00111100,
-    B00000000 };
+// The object playing animations on the face
+FaceAnimator faceAnimator(face);
 
 /**
  * \brief Initializes led for the face
@@ -87,41 +124,121 @@ void initializeFace()
 }
 
 /**
- * \brief Draws a smiling face
+ * \brief Selects the fastest I²C bus frequency that works
+ *
+ * Frequencies in busFrequencies up to maxBusFrequency are tested from the
+ * fastest, stopping at the first that passes the test. The result of each
+ * test is sent to the PC. If all tests fail, the slowest frequency is kept
+ */
+void selectBusFrequency()
+{
+	const int numFrequencies = sizeof(busFrequencies) / sizeof(busFrequencies[0]);
+
+	for (int i = 0; i < numFrequencies; ++i) {
+		if (busFrequencies[i] > maxBusFrequency) {
+			continue;
+		}
+
+		twiQueue.setClock(busFrequencies[i]);
+		const unsigned long transactionsPerSecond = sequencePlayer.testBus(busTestWrites);
+		serialCommunication.sendBusTestResult(busFrequencies[i] / 1000, transactionsPerSecond);
+
+		if (transactionsPerSecond != 0) {
+			return;
+		}
+	}
+}
+
+/**
+ * \brief Handles the commands changing how the sequence is played
+ *
+ * These are the pause, resume and time scale commands, accepted while a
+ * sequence is being streamed
+ * \return true if the received command was one of those handled here
  */
-void smile()
+bool handlePlaybackCommand()
 {
-	// clear whatever was left on the display
-	face.clear();
+	if (serialCommunication.isPause()) {
+		sequencePlayer.pause();
+	} else if (serialCommunication.isResume()) {
+		sequencePlayer.resume();
+	} else if (serialCommunication.isTimeScale()) {
+		sequencePlayer.setTimeScale(serialCommunication.timeScale());
+	} else {
+		return false;
+	}
+
+	return true;
+}
 
-	// send bitmap to cover the entire display area
-	face.drawBitmap(0, 0, smile_bmp, 8, 8, LED_ON);
+/**
+ * \brief Handles the commands configuring the robot
+ *
+ * These are accepted in any state (pings too, so that the round trip time can
+ * be measured at any time)
+ * \return true if the received command was one of those handled here
+ */
+bool handleConfigurationCommand()
+{
+	if (serialCommunication.isServoLimits()) {
+		if (serialCommunication.limitsServo() >= SequencePoint::dim) {
+			serialCommunication.sendEvent(InvalidServoEvent, serialCommunication.limitsServo());
+		} else {
+			sequencePlayer.setLimits(serialCommunication.limitsServo(), serialCommunication.maxSpeed(), serialCommunication.maxAcceleration());
+		}
+	} else if (serialCommunication.isFaceExpression()) {
+		if (!faceAnimator.setExpression(serialCommunication.faceExpression())) {
+			serialCommunication.sendEvent(InvalidFaceExpressionEvent, serialCommunication.faceExpression());
+		}
+	} else if (serialCommunication.isFaceText()) {
+		faceAnimator.showText(serialCommunication.faceText());
+	} else if (serialCommunication.isPing()) {
+		serialCommunication.sendPong();
+	} else {
+		return false;
+	}
 
-	// show image
-	face.writeDisplay();
+	return true;
 }
 
 void setup()
 {
 	// initialize Adafruit's LED backpack
 	initializeFace();
-	// draw a smiling face
-	smile();
- 
+
 	// Initializing the object handling serial communication
 	serialCommunication.begin(baudRate);
 
+	// Starting to sample the battery in background
+	batteryMonitor.setReportThreshold(batteryReportThreshold);
+	batteryMonitor.setMaxReportInterval(batteryMaxReportInterval);
+	batteryMonitor.setLoadCompensation(batteryLoadCompensation);
+	batteryMonitor.begin();
+
 	// The initial position of servos
 	SequencePoint startPos;
 	startPos.duration = 0;
 	startPos.timeToTarget = 0;
+	startPos.profile = LinearProfile;
+	startPos.partial = false;
+	startPos.scheduled = false;
+	startPos.startTime = 0;
+	memset(startPos.channels, 0xFF, sizeof(startPos.channels));
 	for (int i = 0; i < SequencePoint::dim; ++i) {
-		unsigned long p = (unsigned long)(servoMid[i] - servoMin[i]) * 256 / (unsigned long)(servoMax[i] - servoMin[i]);
+		unsigned long p = (unsigned long)(servoMid[i] - servoMin[i]) * SequencePoint::maxPosition / (unsigned long)(servoMax[i] - servoMin[i]);
 		startPos.point[i] = p;
 	}
 
 	// Initializing the object handling servos
 	sequencePlayer.begin(startPos);
+	sequencePlayer.setLatePointPolicy(latePointPolicy);
+
+	// Now that all devices are initialized, using the fastest bus frequency
+	// that works
+	selectBusFrequency();
+
+	// the face starts smiling, it is drawn in the first loop
+	faceAnimator.setExpression(SmileExpression);
 
 	// Setting the point to fill. The buffer cannot be full at this stage!
 	serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
@@ -137,6 +254,9 @@ void loop()
 		// We have finally stopped, clearing the sequence player buffer and returning idle
 		sequencePlayer.clearBuffer();
 		status = IdleState;
+		if (sequencePlayer.saturationCountsChanged()) {
+			serialCommunication.sendSaturationCounts(sequencePlayer.saturationCounts());
+		}
 		serialCommunication.sendSequenceFinished();
 	} else if ((status == StreamMode) && sequenceBufferWasFull && (!sequencePlayer.bufferFull())) {
 		// If the buffer was full and it is no longer full, sending a buffer not full package
@@ -146,41 +266,71 @@ void loop()
 		sequenceBufferWasFull = false;
 	}
 
-	// Checking if there are new commands
-	if (serialCommunication.commandReceived()) {
+	// If the buffer runs empty while streaming (and not paused) the PC is
+	// late: servos are frozen until the next point arrives. Before the first
+	// point the buffer is empty because the stream is starting
+	if ((status == StreamMode) && emptyBuffer && (streamPoints != 0) && (!underrunning) && (!sequencePlayer.paused())) {
+		underrunning = true;
+		underrunStartTime = millis();
+		++underruns;
+	}
+
+	// Telling the PC if late points were skipped
+	if (sequencePlayer.droppedPoints() != reportedDroppedPoints) {
+		reportedDroppedPoints = sequencePlayer.droppedPoints();
+		if (reportedDroppedPoints != 0) {
+			serialCommunication.sendEvent(LatePointsDroppedEvent, reportedDroppedPoints);
+		}
+	}
+
+	// Checking if there are new commands (configuration commands are handled in any state)
+	if (serialCommunication.commandReceived() && !handleConfigurationCommand()) {
 		switch (status) {
 			case IdleState:
 				if (serialCommunication.isStartStream()) {
 					// Checking that we got the correct point dimension
 					if (serialCommunication.pointDimension() != SequencePoint::dim) {
-						serialCommunication.sendDebugPacket("Invalid point dimension");
+						serialCommunication.sendEvent(InvalidPointDimensionEvent, serialCommunication.pointDimension(), SequencePoint::dim);
 					} else {
 						status = StreamMode;
 						sequenceBufferWasFull = false;
+						streamPoints = 0;
+						underrunning = false;
+						sequencePlayer.resume();
+						sequencePlayer.resetSaturationCounts();
 						serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
 					}
 				} else if (serialCommunication.isStartImmediate()) {
 					// Checking that we got the correct point dimension
 					if (serialCommunication.pointDimension() != SequencePoint::dim) {
-						serialCommunication.sendDebugPacket("Invalid point dimension");
+						serialCommunication.sendEvent(InvalidPointDimensionEvent, serialCommunication.pointDimension(), SequencePoint::dim);
 					} else {
 						status = ImmediateMode;
 						sequenceBufferWasFull = false;
 						serialCommunication.setNextSequencePointToFill(sequencePlayer.pointToFill());
 					}
 				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					serialCommunication.sendEvent(UnexpectedCommandEvent, serialCommunication.receivedCommand(), status);
 				}
 				break;
 			case StreamMode:
 				if (serialCommunication.isSequencePoint()) {
-					// If the queue was full, sending a debug packet
+					// If the queue was full, sending an event
 					if (serialCommunication.nextSequencePointToFill() == NULL) {
-						serialCommunication.sendDebugPacket("Sequence point received but buffer full");
+						serialCommunication.sendEvent(PointBufferFullEvent, SequencePlayer::bufferDimension);
 					} else {
 						// Marking the point as complete
 						sequencePlayer.pointFilled();
 
+						// The underrun ends with the point the robot was waiting for. It
+						// is reported only now, so that the end of a stream is not
+						// mistaken for an underrun
+						if (underrunning) {
+							serialCommunication.sendUnderrun(underruns, streamPoints, underrunStartTime, millis() - underrunStartTime);
+							underrunning = false;
+						}
+						++streamPoints;
+
 						// Checking what to send in response and setting the next object
 						// to fill
 						sequenceBufferWasFull = sequencePlayer.bufferFull();
@@ -193,26 +343,45 @@ void loop()
 						}
 					}
 				} else if (serialCommunication.isStop()) {
-					// Setting status to stopping. We still have to play all remaining sequence points
-					status = StreamModeStopping;
-				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					if (sequencePlayer.paused()) {
+						// When paused we stop immediately, without playing the remaining points
+						sequencePlayer.clearBuffer();
+						sequencePlayer.resume();
+						status = IdleState;
+						serialCommunication.sendSequenceFinished();
+					} else {
+						// Setting status to stopping. We still have to play all remaining sequence points
+						status = StreamModeStopping;
+					}
+				} else if (!handlePlaybackCommand()) {
+					serialCommunication.sendEvent(UnexpectedCommandEvent, serialCommunication.receivedCommand(), status);
 				}
 				break;
 			case StreamModeStopping:
-				// We do not expect any packet here
-				serialCommunication.sendDebugPacket("Unexpected command (sequence stopping)");
+				// We only expect commands changing how the remaining points are played here,
+				// or a new stop. That stops immediately, as the remaining points would never
+				// be played if we have been paused
+				if (serialCommunication.isStop()) {
+					sequencePlayer.clearBuffer();
+					sequencePlayer.resume();
+					status = IdleState;
+					serialCommunication.sendSequenceFinished();
+				} else if (!handlePlaybackCommand()) {
+					serialCommunication.sendEvent(UnexpectedCommandEvent, serialCommunication.receivedCommand(), status);
+				}
 				break;
 			case ImmediateMode:
 				if (serialCommunication.isSequencePoint()) {
-					// If the queue was full, sending a debug packet
+					// If the queue was full, sending an event
 					if (serialCommunication.nextSequencePointToFill() == NULL) {
-						serialCommunication.sendDebugPacket("Sequence point received but buffer full");
+						serialCommunication.sendEvent(PointBufferFullEvent, SequencePlayer::bufferDimension);
 					} else {
-						// Setting both sequence point duration and timeToTarget to 0, so that the new
-						// position is immediately reached
+						// Setting both sequence point duration and timeToTarget to 0 (and
+						// ignoring the start time), so that the new position is immediately
+						// reached
 						serialCommunication.nextSequencePointToFill()->duration = 0;
 						serialCommunication.nextSequencePointToFill()->timeToTarget = 0;
+						serialCommunication.nextSequencePointToFill()->scheduled = false;
 
 						// Marking the point as complete
 						sequencePlayer.pointFilled();
@@ -223,24 +392,49 @@ void loop()
 					sequencePlayer.clearBuffer();
 					status = IdleState;
 				} else {
-					serialCommunication.sendDebugPacket("Unexpected command");
+					serialCommunication.sendEvent(UnexpectedCommandEvent, serialCommunication.receivedCommand(), status);
 				}
 				break;
 		}
 	}
 
-	// Checking if we have to send the battery level
-	const unsigned long curBatteryTime = millis();
-	if ((curBatteryTime - lastBatteryTime) > batteryInterval) {
-		// Sending battery charge. 420 = 100% - 300 = 0%
-		int v = (analogRead(batteryPin) - 300) * 256 / (420 - 300);
-		if (v < 0) {
-			v = 0;
-		} else if (v > 255) {
-			v = 255;
+	// Sending the battery level if it changed. The battery is sampled in
+	// background, this never waits for the ADC
+	const unsigned long curTime = millis();
+
+	// Animating the face with the time left. This never waits for the I²C bus
+	faceAnimator.update(curTime);
+
+	batteryMonitor.setLoad(sequencePlayer.movingServos());
+	if (batteryMonitor.reportNeeded(curTime)) {
+		serialCommunication.sendBatteryCharge(batteryMonitor.reportedCharge());
+
+		// Also telling who is near the robot that the battery is low
+		if (batteryMonitor.reportedCharge() < lowBatteryCharge) {
+			if (!lowBatteryShown) {
+				faceAnimator.showText_P(PSTR("Battery low"));
+				lowBatteryShown = true;
+			}
+		} else if (batteryMonitor.reportedCharge() > (lowBatteryCharge + batteryReportThreshold)) {
+			lowBatteryShown = false;
 		}
-		serialCommunication.sendBatteryCharge(v);
+	}
+
+	// Checking if we have to send the status
+	if ((curTime - lastStatusTime) > statusInterval) {
+		// Sending the point dimension, so that the PC knows how many servos
+		// we have
+		serialCommunication.sendPointDimension();
+
+		// Also sending saturation counts, if needed
+		if (sequencePlayer.saturationCountsChanged()) {
+			serialCommunication.sendSaturationCounts(sequencePlayer.saturationCounts());
+		}
+
+		// And the statistics of the I²C queue
+		serialCommunication.sendBusStatistics(twiQueue.maxQueued(), twiQueue.completedTransactions(), twiQueue.failedTransactions(), twiQueue.stalls());
+		twiQueue.resetMaxQueued();
 
-		lastBatteryTime = curBatteryTime;
+		lastStatusTime = curTime;
 	}
 }
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "batterymonitor.h"
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace {
+	// The object handling the ADC interrupt (set by begin())
+	BatteryMonitor* activeMonitor = NULL;
+}
+
+ISR(ADC_vect)
+{
+	activeMonitor->handleInterrupt();
+}
+
+BatteryMonitor::BatteryMonitor(unsigned char pin, int emptyReading, int fullReading)
+	: m_pin(pin)
+	, m_emptyReading(emptyReading)
+	, m_fullReading(fullReading)
+	, m_blockSum(0)
+	, m_blockSamples(0)
+	, m_filtered(0)
+	, m_ready(false)
+	, m_load(0)
+	, m_loadCompensation(0)
+	, m_reportThreshold(3)
+	, m_maxReportInterval(0)
+	, m_reported(false)
+	, m_reportedCharge(0)
+	, m_lastReportTime(0)
+{
+}
+
+void BatteryMonitor::begin()
+{
+	activeMonitor = this;
+
+	// Using the AVcc reference (as analogRead() does by default) and the
+	// channel of the battery pin
+	ADMUX = _BV(REFS0) | (m_pin & 0x07);
+#ifdef MUX5
+	// Boards with more than 8 analog inputs have one more channel bit. ADTS
+	// is 0 for free running mode
+	ADCSRB = (m_pin > 7) ? _BV(MUX5) : 0;
+#else
+	ADCSRB = 0;
+#endif
+
+	// Starting the conversions in free running mode with the interrupt
+	// enabled. The prescaler is 128 (125 kHz with a 16 MHz clock, about 9600
+	// readings per second)
+	ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+void BatteryMonitor::setReportThreshold(unsigned char threshold)
+{
+	m_reportThreshold = (threshold == 0) ? 1 : threshold;
+}
+
+void BatteryMonitor::setMaxReportInterval(unsigned long interval)
+{
+	m_maxReportInterval = interval;
+}
+
+void BatteryMonitor::setLoadCompensation(unsigned int drop)
+{
+	m_loadCompensation = drop;
+}
+
+void BatteryMonitor::setLoad(unsigned char movingServos)
+{
+	m_load = m_load - (m_load >> filterShift) + movingServos;
+}
+
+unsigned char BatteryMonitor::charge() const
+{
+	// The filtered value is changed by the interrupt, reading it atomically
+	noInterrupts();
+	const unsigned long filtered = m_filtered;
+	interrupts();
+
+	// Both the reading and the compensation are multiplied by 2^filterShift
+	// here, to keep the fractional part
+	const long reading = (filtered / samplesPerBlock) + ((long(m_loadCompensation) * long(m_load)) >> filterShift);
+	const long empty = long(m_emptyReading) << filterShift;
+	const long range = long(m_fullReading - m_emptyReading) << filterShift;
+
+	const long c = ((reading - empty) * 256) / range;
+	if (c < 0) {
+		return 0;
+	} else if (c > 255) {
+		return 255;
+	}
+
+	return c;
+}
+
+bool BatteryMonitor::reportNeeded(unsigned long curTime)
+{
+	if (!m_ready) {
+		return false;
+	}
+
+	const unsigned char c = charge();
+	const unsigned char change = (c > m_reportedCharge) ? (c - m_reportedCharge) : (m_reportedCharge - c);
+	const bool intervalElapsed = (m_maxReportInterval != 0) && ((curTime - m_lastReportTime) >= m_maxReportInterval);
+
+	if (m_reported && (change < m_reportThreshold) && !intervalElapsed) {
+		return false;
+	}
+
+	m_reported = true;
+	m_reportedCharge = c;
+	m_lastReportTime = curTime;
+
+	return true;
+}
+
+void BatteryMonitor::handleInterrupt()
+{
+	m_blockSum += ADC;
+	++m_blockSamples;
+	if (m_blockSamples < samplesPerBlock) {
+		return;
+	}
+
+	if (m_ready) {
+		m_filtered = m_filtered - (m_filtered >> filterShift) + m_blockSum;
+	} else {
+		// The first block initializes the filter, so that we don't start
+		// from 0
+		m_filtered = ((unsigned long) m_blockSum) << filterShift;
+		m_ready = true;
+	}
+
+	m_blockSum = 0;
+	m_blockSamples = 0;
+}
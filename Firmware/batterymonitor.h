@@ -0,0 +1,239 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef BATTERYMONITOR_H
+#define BATTERYMONITOR_H
+
+/**
+ * \brief Measures the battery charge in background
+ *
+ * The ADC runs in free running mode on the battery pin and each conversion is
+ * handled by the ADC interrupt, so reading the charge never waits for a
+ * conversion. Blocks of samplesPerBlock readings are averaged and then
+ * smoothed with an exponential filter (the time constant is about 0.1
+ * seconds). The ADC cannot be used with analogRead() while this is running.
+ *
+ * The charge goes from 0 (the reading is emptyReading or less) to 255 (the
+ * reading is fullReading or more). As servos draw current the battery
+ * voltage drops: to compensate, call setLoad() with how many servos are
+ * moving and set the reading drop caused by each servo with
+ * setLoadCompensation() (the load is filtered as well). Use reportNeeded()
+ * to only send the charge when it changes by at least the report threshold
+ */
+class BatteryMonitor
+{
+public:
+	/**
+	 * \brief The number of readings averaged before filtering
+	 */
+	static const unsigned int samplesPerBlock = 64;
+
+	/**
+	 * \brief The exponential filter factor as a power of 2
+	 *
+	 * Each new block weights 1 / 2^filterShift
+	 */
+	static const unsigned char filterShift = 4;
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param pin the analog pin of the battery (0 for A0, 1 for A1, ...)
+	 * \param emptyReading the ADC reading of a depleted battery
+	 * \param fullReading the ADC reading of a fully charged battery
+	 */
+	BatteryMonitor(unsigned char pin, int emptyReading, int fullReading);
+
+	/**
+	 * \brief Starts the ADC
+	 *
+	 * Call this inside setup()
+	 */
+	void begin();
+
+	/**
+	 * \brief Sets the minimum change of charge that needs to be reported
+	 *
+	 * \param threshold the minimum change between 1 and 255. The default is
+	 *                  3 (about 1%)
+	 */
+	void setReportThreshold(unsigned char threshold);
+
+	/**
+	 * \brief Sets the maximum time between two reports
+	 *
+	 * \param interval the maximum time in milliseconds between two reports
+	 *                 even if the charge does not change. 0 (the default)
+	 *                 means that the charge is only reported when it changes
+	 */
+	void setMaxReportInterval(unsigned long interval);
+
+	/**
+	 * \brief Sets how much the reading drops for each moving servo
+	 *
+	 * \param drop the drop of the ADC reading caused by each moving servo in
+	 *             1/16 of ADC units. 0 (the default) disables compensation
+	 */
+	void setLoadCompensation(unsigned int drop);
+
+	/**
+	 * \brief Sets the current load of the battery
+	 *
+	 * Call this periodically (e.g. once per loop), the value is filtered
+	 * \param movingServos the number of servos currently moving
+	 */
+	void setLoad(unsigned char movingServos);
+
+	/**
+	 * \brief Returns true if the first block of readings has been filtered
+	 *
+	 * \return true if charge() is valid
+	 */
+	bool ready() const
+	{
+		return m_ready;
+	}
+
+	/**
+	 * \brief Returns the current (filtered and compensated) charge
+	 *
+	 * \return the current charge between 0 (depleted) and 255 (full)
+	 */
+	unsigned char charge() const;
+
+	/**
+	 * \brief Returns true if the charge needs to be reported
+	 *
+	 * This happens if the charge changed by at least the report threshold
+	 * since the last time this returned true, the maximum report interval
+	 * elapsed or the charge has never been reported. When this returns true
+	 * the charge is considered reported and is returned by reportedCharge()
+	 * \param curTime the current value of millis()
+	 * \return true if the charge needs to be reported
+	 */
+	bool reportNeeded(unsigned long curTime);
+
+	/**
+	 * \brief Returns the charge at the last time reportNeeded() returned
+	 *        true
+	 *
+	 * \return the last reported charge
+	 */
+	unsigned char reportedCharge() const
+	{
+		return m_reportedCharge;
+	}
+
+	/**
+	 * \brief Handles the ADC interrupt
+	 *
+	 * This is called by the interrupt service routine, never call it directly
+	 */
+	void handleInterrupt();
+
+private:
+	/**
+	 * \brief The analog pin of the battery
+	 */
+	const unsigned char m_pin;
+
+	/**
+	 * \brief The reading of a depleted battery
+	 */
+	const int m_emptyReading;
+
+	/**
+	 * \brief The reading of a fully charged battery
+	 */
+	const int m_fullReading;
+
+	/**
+	 * \brief The sum of the readings of the current block
+	 */
+	unsigned int m_blockSum;
+
+	/**
+	 * \brief The number of readings in the current block
+	 */
+	unsigned char m_blockSamples;
+
+	/**
+	 * \brief The filtered sum of blocks
+	 *
+	 * This is the reading multiplied by samplesPerBlock and by
+	 * 2^filterShift
+	 */
+	volatile unsigned long m_filtered;
+
+	/**
+	 * \brief True once the first block has been filtered
+	 */
+	volatile bool m_ready;
+
+	/**
+	 * \brief The filtered number of moving servos multiplied by
+	 *        2^filterShift
+	 */
+	unsigned int m_load;
+
+	/**
+	 * \brief The reading drop per moving servo in 1/16 of ADC units
+	 */
+	unsigned int m_loadCompensation;
+
+	/**
+	 * \brief The minimum change of charge to report
+	 */
+	unsigned char m_reportThreshold;
+
+	/**
+	 * \brief The maximum time between two reports (0 for no limit)
+	 */
+	unsigned long m_maxReportInterval;
+
+	/**
+	 * \brief True if the charge has been reported at least once
+	 */
+	bool m_reported;
+
+	/**
+	 * \brief The last reported charge
+	 */
+	unsigned char m_reportedCharge;
+
+	/**
+	 * \brief The time of the last report
+	 */
+	unsigned long m_lastReportTime;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	BatteryMonitor(const BatteryMonitor&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	BatteryMonitor& operator=(const BatteryMonitor&);
+};
+
+#endif
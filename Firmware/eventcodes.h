@@ -0,0 +1,72 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef EVENTCODES_H
+#define EVENTCODES_H
+
+/**
+ * \file eventcodes.h
+ *
+ * The codes of the events the firmware sends to the PC in event packets. This
+ * is shared between the firmware and the GUI (which turns codes into
+ * messages), so it has no dependency on the Arduino libraries. Never change
+ * the value of existing codes, only add new ones
+ */
+
+/**
+ * \brief The codes of events
+ *
+ * The comment of each code describes the two arguments of the event (unused
+ * arguments are 0)
+ */
+enum EventCode {
+	// A start packet had the wrong point dimension. The arguments are the
+	// received and the expected dimension
+	InvalidPointDimensionEvent = 1,
+	// A command was not expected in the current state. The arguments are the
+	// command and the state (see FirmwareState)
+	UnexpectedCommandEvent = 2,
+	// A sequence point was received but the buffer was full. The first
+	// argument is the size of the buffer
+	PointBufferFullEvent = 3,
+	// A servo limits command had an invalid servo index. The first argument
+	// is the index
+	InvalidServoEvent = 4,
+	// A face expression command had an invalid expression. The first
+	// argument is the expression
+	InvalidFaceExpressionEvent = 5,
+	// Scheduled points were skipped because they were late. The first
+	// argument is the number of points skipped since the stream started (at
+	// most 255)
+	LatePointsDroppedEvent = 6
+};
+
+/**
+ * \brief The states of the firmware, as sent in events
+ */
+enum FirmwareState {
+	IdleState = 0,
+	StreamMode,
+	StreamModeStopping,
+	ImmediateMode
+};
+
+#endif
@@ -0,0 +1,270 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "faceanimator.h"
+#include "AdafruitLEDBackpack.h"
+#include "twiqueue.h"
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+namespace {
+	// A frame of an animation: the rows of the matrix (the most significant
+	// bit is the leftmost pixel) and the duration in units of
+	// FaceAnimator::frameTimeUnit (0 to keep the frame)
+	struct FaceFrame {
+		unsigned char rows[8];
+		unsigned char duration;
+	};
+
+	// An animation: its frames and the expression to show when the last
+	// frame ends (the same expression for looping animations)
+	struct FaceAnimation {
+		const FaceFrame* frames;
+		unsigned char numFrames;
+		unsigned char next;
+	};
+
+	// The bytes of the largest transaction queued when drawing (the header
+	// in the queue, the display address and two bytes per row)
+	const unsigned char maxDisplayTransaction = 2 + 1 + 16;
+
+	// Returns true if the I²C queue has room for a display transaction
+	bool displayTransactionFits()
+	{
+		return twiQueue.queued() <= (TwiQueue::bufferSize - 1 - maxDisplayTransaction);
+	}
+
+	const FaceFrame smileFrames[] PROGMEM = {
+		{{B00000000,
+		  B01100110,
+		  B00000000,
+		  B00100100,
+		  B00000000,
+		  B01000010,
+		  B00111100,
+		  B00000000}, 250},
+		{{B00000000,
+		  B00000000,
+		  B01100110,
+		  B00100100,
+		  B00000000,
+		  B01000010,
+		  B00111100,
+		  B00000000}, 15}
+	};
+
+	const FaceFrame blinkFrames[] PROGMEM = {
+		{{B00000000,
+		  B00000000,
+		  B01100110,
+		  B00100100,
+		  B00000000,
+		  B01000010,
+		  B00111100,
+		  B00000000}, 15}
+	};
+
+	const FaceFrame talkFrames[] PROGMEM = {
+		{{B00000000,
+		  B01100110,
+		  B00000000,
+		  B00100100,
+		  B00000000,
+		  B00111100,
+		  B00000000,
+		  B00000000}, 12},
+		{{B00000000,
+		  B01100110,
+		  B00000000,
+		  B00100100,
+		  B00111100,
+		  B01000010,
+		  B00111100,
+		  B00000000}, 12}
+	};
+
+	const FaceFrame sadFrames[] PROGMEM = {
+		{{B00000000,
+		  B01100110,
+		  B00000000,
+		  B00100100,
+		  B00000000,
+		  B00111100,
+		  B01000010,
+		  B00000000}, 0}
+	};
+
+	const FaceFrame surprisedFrames[] PROGMEM = {
+		{{B01100110,
+		  B01100110,
+		  B00000000,
+		  B00100100,
+		  B00011000,
+		  B00100100,
+		  B00011000,
+		  B00000000}, 0}
+	};
+
+	const FaceFrame sleepFrames[] PROGMEM = {
+		{{B00000000,
+		  B00000000,
+		  B01100110,
+		  B00000000,
+		  B00000000,
+		  B00000000,
+		  B00111100,
+		  B00000000}, 0}
+	};
+
+	// The animations, in the order of FaceExpression
+	const FaceAnimation animations[FaceAnimator::numExpressions] PROGMEM = {
+		{smileFrames, sizeof(smileFrames) / sizeof(FaceFrame), SmileExpression},
+		{blinkFrames, sizeof(blinkFrames) / sizeof(FaceFrame), SmileExpression},
+		{talkFrames, sizeof(talkFrames) / sizeof(FaceFrame), TalkExpression},
+		{sadFrames, sizeof(sadFrames) / sizeof(FaceFrame), SadExpression},
+		{surprisedFrames, sizeof(surprisedFrames) / sizeof(FaceFrame), SurprisedExpression},
+		{sleepFrames, sizeof(sleepFrames) / sizeof(FaceFrame), SleepExpression}
+	};
+
+	// Copies the description of an animation from program memory
+	FaceAnimation readAnimation(unsigned char expression)
+	{
+		FaceAnimation a;
+		memcpy_P(&a, &animations[expression], sizeof(FaceAnimation));
+
+		return a;
+	}
+}
+
+FaceAnimator::FaceAnimator(Adafruit_8x8matrix& face)
+	: m_face(face)
+	, m_expression(SmileExpression)
+	, m_frame(0)
+	, m_drawPending(true)
+	, m_frameStart(0)
+	, m_frameDuration(0)
+{
+}
+
+bool FaceAnimator::setExpression(unsigned char expression)
+{
+	if (expression >= numExpressions) {
+		return false;
+	}
+
+	m_expression = expression;
+	m_frame = 0;
+	if (!m_scroller.scrolling()) {
+		m_drawPending = true;
+	}
+
+	return true;
+}
+
+void FaceAnimator::showText(const char* text)
+{
+	if (text[0] == '\0') {
+		m_scroller.stop();
+	} else {
+		m_scroller.start(text);
+	}
+	m_drawPending = true;
+}
+
+void FaceAnimator::showText_P(const char* text)
+{
+	m_scroller.start_P(text);
+	m_drawPending = true;
+}
+
+bool FaceAnimator::update(unsigned long curTime)
+{
+	if (m_scroller.scrolling()) {
+		if ((!m_drawPending && ((curTime - m_frameStart) < scrollColumnTime)) || !displayTransactionFits()) {
+			return false;
+		}
+
+		if (m_scroller.nextColumn()) {
+			drawText(curTime);
+
+			return true;
+		}
+
+		// The text is over, going back to the animation from its first frame
+		m_frame = 0;
+		m_drawPending = true;
+	}
+
+	if (!m_drawPending) {
+		if ((m_frameDuration == 0) || ((curTime - m_frameStart) < m_frameDuration)) {
+			return false;
+		}
+
+		nextFrame();
+	}
+
+	// Waiting for the servos to be written if there is no room for the frame
+	// in the I²C queue (writing now would block until there is)
+	if (!displayTransactionFits()) {
+		return false;
+	}
+
+	drawFrame(curTime);
+
+	return true;
+}
+
+void FaceAnimator::nextFrame()
+{
+	const FaceAnimation a = readAnimation(m_expression);
+
+	++m_frame;
+	if (m_frame >= a.numFrames) {
+		m_expression = a.next;
+		m_frame = 0;
+	}
+	m_drawPending = true;
+}
+
+void FaceAnimator::drawFrame(unsigned long curTime)
+{
+	const FaceAnimation a = readAnimation(m_expression);
+	const FaceFrame* frame = &a.frames[m_frame];
+
+	m_face.drawRows(frame->rows);
+	m_face.writeDisplayChanges();
+
+	m_drawPending = false;
+	m_frameStart = curTime;
+	m_frameDuration = pgm_read_byte(&frame->duration) * frameTimeUnit;
+}
+
+void FaceAnimator::drawText(unsigned long curTime)
+{
+	unsigned char columns[TextScroller::numColumns];
+	m_scroller.columns(columns);
+
+	m_face.drawColumns(columns);
+	m_face.writeDisplayChanges();
+
+	m_drawPending = false;
+	m_frameStart = curTime;
+}
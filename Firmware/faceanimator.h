@@ -0,0 +1,218 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef FACEANIMATOR_H
+#define FACEANIMATOR_H
+
+#include "textscroller.h"
+
+class Adafruit_8x8matrix;
+
+/**
+ * \brief The expressions of the face
+ *
+ * The values are those sent by the PC in face expression packets
+ */
+enum FaceExpression {
+	SmileExpression = 0,
+	BlinkExpression,
+	TalkExpression,
+	SadExpression,
+	SurprisedExpression,
+	SleepExpression
+};
+
+/**
+ * \brief Plays animations on the LED matrix of the face
+ *
+ * Each expression is an animation, a sequence of frames stored in program
+ * memory. Each frame has a duration and when the last frame of an animation
+ * ends another one starts (the same one for looping animations, e.g. the
+ * smile animation blinks from time to time, while the blink animation goes
+ * back to the smile). Frames with a duration of 0 are kept until the
+ * expression is changed.
+ *
+ * Call update() at every loop after servos have been moved: it returns
+ * immediately unless a new frame is due. When drawing, only the rows of the
+ * matrix that changed are sent to the display and the transaction is only
+ * queued (see TwiQueue). If the I²C queue does not have room for the whole
+ * transaction, the frame is postponed to a later loop instead of waiting, so
+ * the face never delays servos.
+ *
+ * Texts (e.g. status messages) can be scrolled on the face with showText().
+ * The animation is suspended while the text scrolls, one column every
+ * scrollColumnTime milliseconds, and then starts again from its first frame
+ */
+class FaceAnimator
+{
+public:
+	/**
+	 * \brief The number of expressions
+	 */
+	static const unsigned char numExpressions = SleepExpression + 1;
+
+	/**
+	 * \brief The unit of the duration of frames in milliseconds
+	 */
+	static const unsigned int frameTimeUnit = 10;
+
+	/**
+	 * \brief The time in milliseconds between two steps of scrolling texts
+	 */
+	static const unsigned int scrollColumnTime = 60;
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param face the LED matrix of the face. It must be initialized
+	 *             before update() is called
+	 */
+	FaceAnimator(Adafruit_8x8matrix& face);
+
+	/**
+	 * \brief Starts the animation of an expression
+	 *
+	 * The first frame is drawn by the next call to update()
+	 * \param expression the expression to show (one of FaceExpression)
+	 * \return false if the expression is not valid. In this case the
+	 *         current animation is not changed
+	 */
+	bool setExpression(unsigned char expression);
+
+	/**
+	 * \brief Returns the expression being shown
+	 *
+	 * This changes when an animation that is not looping ends
+	 * \return the expression being shown
+	 */
+	unsigned char expression() const
+	{
+		return m_expression;
+	}
+
+	/**
+	 * \brief Scrolls a text on the face
+	 *
+	 * A text already scrolling is replaced. Texts longer than
+	 * TextScroller::maxTextLength are truncated
+	 * \param text the text to show. An empty text stops scrolling
+	 */
+	void showText(const char* text);
+
+	/**
+	 * \brief Scrolls a text stored in program memory on the face
+	 *
+	 * \param text the text to show (e.g. from PSTR())
+	 */
+	void showText_P(const char* text);
+
+	/**
+	 * \brief Returns true if a text is scrolling
+	 *
+	 * \return true if a text is scrolling
+	 */
+	bool showingText() const
+	{
+		return m_scroller.scrolling();
+	}
+
+	/**
+	 * \brief Draws the next frame if it is due
+	 *
+	 * \param curTime the current value of millis()
+	 * \return true if a frame has been drawn
+	 */
+	bool update(unsigned long curTime);
+
+private:
+	/**
+	 * \brief Moves to the next frame of the animation
+	 *
+	 * At the end of the animation this starts the next one
+	 */
+	void nextFrame();
+
+	/**
+	 * \brief Draws the current frame and queues the changed rows
+	 *
+	 * \param curTime the current value of millis()
+	 */
+	void drawFrame(unsigned long curTime);
+
+	/**
+	 * \brief Draws the visible columns of the text and queues the changed
+	 *        rows
+	 *
+	 * \param curTime the current value of millis()
+	 */
+	void drawText(unsigned long curTime);
+
+	/**
+	 * \brief The LED matrix of the face
+	 */
+	Adafruit_8x8matrix& m_face;
+
+	/**
+	 * \brief The object rendering scrolling texts
+	 */
+	TextScroller m_scroller;
+
+	/**
+	 * \brief The expression being shown
+	 */
+	unsigned char m_expression;
+
+	/**
+	 * \brief The index of the current frame in the animation
+	 */
+	unsigned char m_frame;
+
+	/**
+	 * \brief True if the current frame (or the first column of a text) has
+	 *        not been drawn yet
+	 */
+	bool m_drawPending;
+
+	/**
+	 * \brief The value of millis() when the current frame (or the last
+	 *        column of a text) was drawn
+	 */
+	unsigned long m_frameStart;
+
+	/**
+	 * \brief The duration of the current frame in milliseconds (0 if it is
+	 *        kept until the expression changes)
+	 */
+	unsigned int m_frameDuration;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	FaceAnimator(const FaceAnimator&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	FaceAnimator& operator=(const FaceAnimator&);
+};
+
+#endif
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef INTERPOLATION_H
+#define INTERPOLATION_H
+
+/**
+ * \file interpolation.h
+ *
+ * The functions used by SequencePlayer to compute the position of servos. They
+ * have no dependency on the Arduino libraries so that the PC program can
+ * include this file and compute exactly the same positions the firmware
+ * computes
+ */
+
+// Easing tables are stored in flash on the board
+#ifdef __AVR__
+	#include <avr/pgmspace.h>
+	#define INTERPOLATION_PROGMEM PROGMEM
+	#define interpolationReadTable(addr) pgm_read_word(addr)
+#else
+	#define INTERPOLATION_PROGMEM
+	#define interpolationReadTable(addr) (*(addr))
+#endif
+
+/**
+ * \brief The possible interpolation profiles
+ *
+ * The profile defines how a servo moves from the previous position to the
+ * target: LinearProfile moves at constant speed, the others start and end with
+ * zero speed, so that there are no speed steps between consecutive points
+ */
+enum InterpolationProfile {
+	LinearProfile = 0,
+	CubicProfile,
+	MinimumJerkProfile,
+	TrapezoidalProfile,
+	NumInterpolationProfiles
+};
+
+/**
+ * \brief The number of intervals in easing tables
+ */
+const unsigned int easingTableSteps = 64;
+
+/**
+ * \brief The value in easing tables corresponding to the target position
+ */
+const long easingTableScale = 16384;
+
+/**
+ * \brief The easing tables of non-linear profiles
+ *
+ * The first table is for profile 1 (CubicProfile), and so on. Each table has
+ * the fraction of the movement done (scaled by easingTableScale) at
+ * easingTableSteps + 1 equally spaced instants between the beginning and the
+ * end of the movement. Values in between are linearly interpolated
+ */
+static const unsigned short easingTables[NumInterpolationProfiles - 1][easingTableSteps + 1] INTERPOLATION_PROGMEM = {
+	// CubicProfile: 3x^2 - 2x^3
+	{
+		    0,    12,    47,   105,   184,   284,   405,   545,
+		  704,   881,  1075,  1286,  1512,  1753,  2009,  2278,
+		 2560,  2854,  3159,  3475,  3800,  4134,  4477,  4827,
+		 5184,  5547,  5915,  6288,  6664,  7043,  7425,  7808,
+		 8192,  8576,  8959,  9341,  9720, 10096, 10469, 10837,
+		11200, 11557, 11907, 12250, 12584, 12909, 13225, 13530,
+		13824, 14106, 14375, 14631, 14872, 15098, 15309, 15503,
+		15680, 15839, 15979, 16100, 16200, 16279, 16337, 16372,
+		16384
+	},
+	// MinimumJerkProfile: 10x^3 - 15x^4 + 6x^5
+	{
+		    0,     1,     5,    16,    36,    69,   117,   181,
+		  263,   365,   488,   632,   799,   989,  1202,  1437,
+		 1696,  1977,  2280,  2605,  2949,  3313,  3695,  4094,
+		 4509,  4938,  5379,  5831,  6292,  6760,  7234,  7712,
+		 8192,  8672,  9150,  9624, 10092, 10553, 11005, 11446,
+		11875, 12290, 12689, 13071, 13435, 13779, 14104, 14407,
+		14688, 14947, 15182, 15395, 15585, 15752, 15896, 16019,
+		16121, 16203, 16267, 16315, 16348, 16368, 16379, 16383,
+		16384
+	},
+	// TrapezoidalProfile: constant acceleration for the first third,
+	// constant speed, constant deceleration for the last third
+	{
+		    0,     9,    36,    81,   144,   225,   324,   441,
+		  576,   729,   900,  1089,  1296,  1521,  1764,  2025,
+		 2304,  2601,  2916,  3249,  3600,  3969,  4352,  4736,
+		 5120,  5504,  5888,  6272,  6656,  7040,  7424,  7808,
+		 8192,  8576,  8960,  9344,  9728, 10112, 10496, 10880,
+		11264, 11648, 12032, 12415, 12784, 13135, 13468, 13783,
+		14080, 14359, 14620, 14863, 15088, 15295, 15484, 15655,
+		15808, 15943, 16060, 16159, 16240, 16303, 16348, 16375,
+		16384
+	}
+};
+
+/**
+ * \brief Computes the position of a servo while moving towards a target
+ *
+ * This uses integer arithmetic (results are truncated towards the starting
+ * position). For non-linear profiles the fraction of movement done is taken
+ * from the easing tables. Positions can be up to 16 bits wide (the firmware
+ * uses positions with 8 fractional bits, see SequencePoint)
+ * \param prev the position at the beginning of the movement
+ * \param target the position to reach
+ * \param t the time in milliseconds since the beginning of the movement. This
+ *          MUST not be greater than timeToTarget
+ * \param timeToTarget the time in milliseconds to reach the target. If 0 the
+ *                     target is returned
+ * \param profile the interpolation profile (one of InterpolationProfile).
+ *                Invalid values are treated as LinearProfile
+ * \return the position of the servo at time t
+ */
+inline unsigned int interpolatePosition(unsigned int prev, unsigned int target, unsigned long t, unsigned int timeToTarget, unsigned char profile = LinearProfile)
+{
+	if (timeToTarget == 0) {
+		return target;
+	}
+
+	const long d = long(target) - long(prev);
+
+	if ((profile == LinearProfile) || (profile >= NumInterpolationProfiles)) {
+		// Both the distance and t are less than 2^16, so the product fits in
+		// 32 bits if we work on the absolute value of the distance
+		const unsigned long absD = (d < 0) ? -d : d;
+		const unsigned long step = (absD * t) / timeToTarget;
+
+		return (d < 0) ? (prev - step) : (prev + step);
+	}
+
+	// The position in the table with 8 fractional bits
+	unsigned long x = (t * (easingTableSteps << 8)) / timeToTarget;
+	if (x > (easingTableSteps << 8)) {
+		x = easingTableSteps << 8;
+	}
+	const unsigned int i = x >> 8;
+	const long frac = x & 0xFF;
+
+	const unsigned short* table = easingTables[profile - 1];
+	long e = interpolationReadTable(table + i);
+	if (i < easingTableSteps) {
+		e += ((long(interpolationReadTable(table + i + 1)) - e) * frac) / 256;
+	}
+
+	const long newP = long(prev) + ((d * e) / easingTableScale);
+
+	return (unsigned int) newP;
+}
+
+/**
+ * \brief Returns how long a sequence point is played in milliseconds
+ *
+ * SequencePlayer::step() moves to the next point only when the time elapsed
+ * since the beginning of the current one is strictly greater than
+ * timeToTarget + duration. With a control loop running at least once per
+ * millisecond this means that each point lasts one millisecond more than
+ * timeToTarget + duration
+ * \param timeToTarget the time to target of the point in milliseconds
+ * \param duration the duration of the point in milliseconds
+ * \return the time in milliseconds after which the next point starts
+ */
+inline unsigned long pointPlayTime(unsigned int timeToTarget, unsigned int duration)
+{
+	return (unsigned long) timeToTarget + (unsigned long) duration + 1;
+}
+
+#endif
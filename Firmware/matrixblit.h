@@ -0,0 +1,166 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef MATRIXBLIT_H
+#define MATRIXBLIT_H
+
+#include <stdint.h>
+
+/**
+ * \file matrixblit.h
+ *
+ * The functions used by Adafruit_8x8matrix::drawRows() and drawColumns() to
+ * copy a whole 8x8 bitmap in the display buffer at once. They have no dependency on the
+ * Arduino libraries so that they can be tested (and benchmarked) on the PC
+ */
+
+/**
+ * \brief The operations turning bitmap rows or columns into display rows
+ *        for each rotation
+ *
+ * See matrixRotationTable and matrixColumnRotationTable
+ */
+enum MatrixRotationOperations {
+	// The rows of the display are the columns of the bitmap
+	MatrixTranspose = 0x01,
+	// The order of rows is reversed
+	MatrixFlipRows = 0x02,
+	// The order of bits in each row is reversed
+	MatrixReverseBits = 0x04
+};
+
+/**
+ * \brief The operations to perform for each rotation (0 to 3, as in
+ *        Adafruit_GFX::setRotation())
+ *
+ * The operations are performed in the order they are listed in
+ * MatrixRotationOperations. The result has the pixel at x in bit x of each
+ * row, the display wiring is applied afterwards
+ */
+static const uint8_t matrixRotationTable[4] = {
+	MatrixReverseBits,
+	MatrixTranspose | MatrixFlipRows | MatrixReverseBits,
+	MatrixFlipRows,
+	MatrixTranspose
+};
+
+/**
+ * \brief The operations to perform for each rotation when the bitmap is
+ *        given by columns
+ *
+ * These are the operations of matrixRotationTable preceded by those turning
+ * columns into rows (a transpose and a reversal of bits), simplified
+ */
+static const uint8_t matrixColumnRotationTable[4] = {
+	MatrixTranspose,
+	MatrixReverseBits,
+	MatrixTranspose | MatrixFlipRows | MatrixReverseBits,
+	MatrixFlipRows
+};
+
+/**
+ * \brief Reverses the order of the bits of a byte
+ *
+ * \param b the byte
+ * \return the byte with bit 0 swapped with bit 7, bit 1 with bit 6 and so on
+ */
+inline uint8_t reverseMatrixRowBits(uint8_t b)
+{
+	b = (b >> 4) | (b << 4);
+	b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+	b = ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+
+	return b;
+}
+
+/**
+ * \brief Copies 8 bytes in the display buffer of an 8x8 matrix performing
+ *        the given operations
+ *
+ * This is used by blitMatrixRows() and blitMatrixColumns()
+ * \param data the bytes to copy
+ * \param operations the operations to perform (see
+ *                   MatrixRotationOperations)
+ * \param displaybuffer the display buffer of the matrix
+ */
+inline void blitMatrix(const uint8_t data[8], uint8_t operations, uint16_t displaybuffer[8])
+{
+	uint8_t r[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	if (operations & MatrixTranspose) {
+		// Shifting the bits of each byte into the columns, r[k] gets bit k of
+		// all bytes (byte j in bit j)
+		for (int8_t j = 7; j >= 0; --j) {
+			uint8_t b = data[j];
+			for (uint8_t k = 0; k < 8; ++k) {
+				r[k] = (r[k] << 1) | (b & 1);
+				b >>= 1;
+			}
+		}
+	} else {
+		for (uint8_t j = 0; j < 8; ++j) {
+			r[j] = data[j];
+		}
+	}
+
+	for (uint8_t y = 0; y < 8; ++y) {
+		uint8_t b = r[(operations & MatrixFlipRows) ? (7 - y) : y];
+		if (operations & MatrixReverseBits) {
+			b = reverseMatrixRowBits(b);
+		}
+
+		// The display is wired with the pixel at x in bit (x + 7) % 8
+		displaybuffer[y] = (uint8_t) ((b >> 1) | (b << 7));
+	}
+}
+
+/**
+ * \brief Copies an 8x8 bitmap in the display buffer of an 8x8 matrix
+ *
+ * This gives the same result as clearing the buffer and drawing the bitmap
+ * with Adafruit_GFX::drawBitmap() on an Adafruit_8x8matrix, without going
+ * through drawPixel() for each pixel
+ * \param rows the rows of the bitmap, from the top. The most significant bit
+ *             is the leftmost pixel (as in Adafruit_GFX::drawBitmap())
+ * \param rotation the rotation of the matrix (0 to 3)
+ * \param displaybuffer the display buffer of the matrix (only the lower byte
+ *                      of each row is used by 8x8 matrices)
+ */
+inline void blitMatrixRows(const uint8_t rows[8], uint8_t rotation, uint16_t displaybuffer[8])
+{
+	blitMatrix(rows, matrixRotationTable[rotation & 3], displaybuffer);
+}
+
+/**
+ * \brief Copies an 8x8 bitmap given by columns in the display buffer of an
+ *        8x8 matrix
+ *
+ * \param columns the columns of the bitmap, from the left. The least
+ *                significant bit is the top pixel (as in the font used by
+ *                Adafruit_GFX::drawChar())
+ * \param rotation the rotation of the matrix (0 to 3)
+ * \param displaybuffer the display buffer of the matrix
+ */
+inline void blitMatrixColumns(const uint8_t columns[8], uint8_t rotation, uint16_t displaybuffer[8])
+{
+	blitMatrix(columns, matrixColumnRotationTable[rotation & 3], displaybuffer);
+}
+
+#endif
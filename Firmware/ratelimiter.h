@@ -0,0 +1,289 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+/**
+ * \file ratelimiter.h
+ *
+ * The class used by SequencePlayer to limit the speed and acceleration of
+ * servos. It has no dependency on the Arduino libraries so that it can be
+ * tested on the PC
+ */
+
+/**
+ * \brief Limits the speed and acceleration of a single servo
+ *
+ * Call update() with the position the servo should have and the time elapsed
+ * since the previous call: the returned position is as close as possible to the
+ * requested one without exceeding the maximum speed and acceleration. When
+ * accelerations are limited, the servo also slows down in time to stop on the
+ * requested position (it never goes past it). Positions have 8 fractional bits
+ * (as in SequencePoint), speeds are internally kept in 1/256 of position per
+ * millisecond and accelerations in 1/65536 of position per millisecond
+ * squared. A limit of 0 means no limit: without limits the requested position
+ * is returned as is
+ */
+class RateLimiter
+{
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * By default there are no limits
+	 */
+	RateLimiter()
+		: m_pos(0)
+		, m_vel(0)
+		, m_maxSpeed(0)
+		, m_maxAcceleration(0)
+		, m_saturated(false)
+	{
+	}
+
+	/**
+	 * \brief Sets the limits
+	 *
+	 * \param maxSpeed the maximum speed in positions per second (0 means no
+	 *                 limit)
+	 * \param maxAcceleration the maximum acceleration in positions per
+	 *                        second squared (0 means no limit)
+	 */
+	void setLimits(unsigned int maxSpeed, unsigned int maxAcceleration)
+	{
+		// Converting to the internal units, without letting a non-zero
+		// limit become 0 (i.e. no limit)
+		m_maxSpeed = (((unsigned long) maxSpeed) << 8) / 1000;
+		if ((maxSpeed != 0) && (m_maxSpeed == 0)) {
+			m_maxSpeed = 1;
+		}
+		m_maxAcceleration = (((unsigned long) maxAcceleration) << 16) / 1000000;
+		if ((maxAcceleration != 0) && (m_maxAcceleration == 0)) {
+			m_maxAcceleration = 1;
+		}
+	}
+
+	/**
+	 * \brief Returns true if there is at least one limit
+	 *
+	 * \return true if there is at least one limit
+	 */
+	bool limited() const
+	{
+		return (m_maxSpeed != 0) || (m_maxAcceleration != 0);
+	}
+
+	/**
+	 * \brief Sets the position, with zero speed
+	 *
+	 * \param pos the new position
+	 */
+	void reset(unsigned int pos)
+	{
+		m_pos = pos;
+		m_vel = 0;
+		m_saturated = false;
+	}
+
+	/**
+	 * \brief Moves towards the requested position
+	 *
+	 * \param target the position the servo should have
+	 * \param dt the time elapsed since the previous call in milliseconds.
+	 *           Intervals longer than one second are considered one second
+	 *           long. If 0 and there are limits, the position does not
+	 *           change
+	 * \return the position the servo should be moved to
+	 */
+	unsigned int update(unsigned int target, unsigned long dt)
+	{
+		const long desired = (long) target;
+
+		if (!limited()) {
+			m_pos = desired;
+			m_vel = 0;
+			m_saturated = false;
+
+			return target;
+		}
+
+		if (dt == 0) {
+			return position();
+		}
+		if (dt > 1000) {
+			dt = 1000;
+		}
+
+		const long err = desired - long(m_pos);
+		const long absErr = (err < 0) ? -err : err;
+		const long sign = (err < 0) ? -1 : 1;
+
+		// The speed needed to reach the target in this step. All the checks
+		// below only reduce it, so we never go past the target
+		long v = err / long(dt);
+		bool saturated = false;
+
+		if ((m_maxSpeed != 0) && ((v * sign) > long(m_maxSpeed))) {
+			v = sign * long(m_maxSpeed);
+			saturated = true;
+		}
+
+		if (m_maxAcceleration != 0) {
+			// The highest speed from which we can still stop at the target:
+			// v^2 = 2 * a * err (the shift converts units)
+			long vStop = squareRoot((2ul * m_maxAcceleration * ((unsigned long) absErr)) >> 8);
+			if (vStop == 0) {
+				vStop = 1;
+			}
+			if ((v * sign) > vStop) {
+				v = sign * vStop;
+				saturated = true;
+			}
+
+			// Limiting the change of speed
+			long dvMax = (long(m_maxAcceleration) * long(dt)) >> 8;
+			if (dvMax == 0) {
+				dvMax = 1;
+			}
+			if ((v - m_vel) > dvMax) {
+				v = m_vel + dvMax;
+				saturated = true;
+			} else if ((m_vel - v) > dvMax) {
+				v = m_vel - dvMax;
+				saturated = true;
+			}
+
+			// If we were moving fast in the other direction we must slow down
+			// first. Otherwise we never go past the target
+			if (((v * sign) > 0) && ((v * long(dt) * sign) > absErr)) {
+				v = err / long(dt);
+			}
+		}
+
+		// When the target can be reached within the limits we land exactly on
+		// it: err / dt is truncated, so moving by v * dt could stop short of
+		// the target forever
+		long newPos = (v == (err / long(dt))) ? desired : (long(m_pos) + v * long(dt));
+		if (newPos < 0) {
+			newPos = 0;
+			v = 0;
+		} else if (newPos > (255l << 8)) {
+			newPos = 255l << 8;
+			v = 0;
+		}
+
+		m_pos = newPos;
+		m_vel = v;
+		m_saturated = saturated;
+
+		return position();
+	}
+
+	/**
+	 * \brief Returns the current position
+	 *
+	 * \return the current position
+	 */
+	unsigned int position() const
+	{
+		return m_pos;
+	}
+
+	/**
+	 * \brief Returns true if the last call to update() was limited
+	 *
+	 * \return true if the position returned by the last call to update()
+	 *         was not the requested one because of limits
+	 */
+	bool saturated() const
+	{
+		return m_saturated;
+	}
+
+	/**
+	 * \brief Returns true if the servo is still at the given position
+	 *
+	 * \param target the position to check
+	 * \return true if the servo is at target with zero speed
+	 */
+	bool settled(unsigned int target) const
+	{
+		return (m_vel == 0) && (m_pos == target);
+	}
+
+private:
+	/**
+	 * \brief Computes the integer square root
+	 *
+	 * \param x the number
+	 * \return the largest integer whose square is not greater than x
+	 */
+	static long squareRoot(unsigned long x)
+	{
+		unsigned long res = 0;
+		unsigned long bit = 1ul << 30;
+
+		while (bit > x) {
+			bit >>= 2;
+		}
+		while (bit != 0) {
+			if (x >= (res + bit)) {
+				x -= res + bit;
+				res = (res >> 1) + bit;
+			} else {
+				res >>= 1;
+			}
+			bit >>= 2;
+		}
+
+		return long(res);
+	}
+
+	/**
+	 * \brief The position with 8 fractional bits
+	 */
+	unsigned int m_pos;
+
+	/**
+	 * \brief The speed in 1/256 of position per millisecond
+	 */
+	long m_vel;
+
+	/**
+	 * \brief The maximum speed in 1/256 of position per millisecond
+	 */
+	unsigned int m_maxSpeed;
+
+	/**
+	 * \brief The maximum acceleration in 1/65536 of position per
+	 *        millisecond squared
+	 */
+	unsigned int m_maxAcceleration;
+
+	/**
+	 * \brief True if the last call to update() was limited
+	 */
+	bool m_saturated;
+};
+
+#endif
@@ -20,6 +20,8 @@
  ******************************************************************************/
 
 #include "sequenceplayer.h"
+#include "interpolation.h"
+#include "twiqueue.h"
 #include <stdlib.h>
 #include <string.h>
 #include <Arduino.h>
@@ -28,33 +30,61 @@
 // #include "serialcommunication.h"
 // extern SerialCommunication serialCommunication;
 
-SequencePlayer::SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim])
+SequencePlayer::SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim], const unsigned char boardAddresses[numBoards])
 	: m_pwm()
 	, m_curPoint(1)
 	, m_prevPoint(0)
 	, m_pointToFill(1)
-	, m_stepStartTime(0)
+	, m_stepTime(0)
+	, m_lastTime(0)
+	, m_timeScale(normalTimeScale)
+	, m_paused(false)
+	, m_pausedAt(0)
+	, m_lastMoveTime(0)
+	, m_servosSettled(true)
+	, m_movingServos(0)
+	, m_movingUntil(0)
+	, m_saturationCountsChanged(false)
 	, m_startingNewPoint(true)
+	, m_latePointPolicy(CatchUpLatePoints)
+	, m_droppedPoints(0)
 {
+	for (int i = 0; i < numBoards; ++i) {
+		m_pwm[i] = Adafruit_PWMServoDriver(boardAddresses[i]);
+	}
+
 	// Copying the minimum PWM for servos and computing the range
 	memcpy(m_servoMin, servoMin, sizeof(m_servoMin));
 	for (int i = 0; i < SequencePoint::dim; ++i) {
 		m_servoRange[i] = servoMax[i] - servoMin[i];
 	}
+
+	resetSaturationCounts();
 }
 
 void SequencePlayer::begin(const SequencePoint& curPos)
 {
 	memcpy(&(m_buffer[m_prevPoint]), &curPos, sizeof(SequencePoint));
 
-	// Initializing the pwm driver
-	m_pwm.begin();
-	m_pwm.setPWMFreq(200);
+	// Initializing the pwm drivers
+	for (int i = 0; i < numBoards; ++i) {
+		m_pwm[i].begin();
+		m_pwm[i].setPWMFreq(200);
+	}
 
-	// Moving all servos to their position
+	// Moving all servos to their position, where their segments end
+	beginFrames();
 	for (int i = 0; i < SequencePoint::dim; ++i) {
+		m_segmentStart[i] = curPos.point[i];
+		m_segmentTarget[i] = curPos.point[i];
+		m_segmentTimeToTarget[i] = 0;
+		m_segmentProfile[i] = LinearProfile;
+		m_segmentTime[i] = 0;
+		m_limiters[i].reset(curPos.point[i]);
 		moveServo(i, curPos.point[i]);
 	}
+	commitFrames();
+	m_lastMoveTime = millis();
 }
 
 SequencePoint* SequencePlayer::pointToFill()
@@ -63,6 +93,11 @@ SequencePoint* SequencePlayer::pointToFill()
 		return NULL;
 	}
 
+	// Missing coordinates are taken from the last filled point (or the last
+	// played one if the buffer has been cleared, which is the same)
+	const int lastFilled = (m_pointToFill + bufferDimension - 1) % bufferDimension;
+	memcpy(m_buffer[m_pointToFill].point, m_buffer[lastFilled].point, sizeof(m_buffer[m_pointToFill].point));
+
 	return &(m_buffer[m_pointToFill]);
 }
 
@@ -78,36 +113,168 @@ void SequencePlayer::forceNextPoint()
 	m_prevPoint = (m_prevPoint + 1) % bufferDimension;
 }
 
+void SequencePlayer::pause()
+{
+	if (!m_paused) {
+		m_pausedAt = millis();
+		m_paused = true;
+	}
+}
+
+void SequencePlayer::resume()
+{
+	if (m_paused) {
+		// The time spent paused must not be counted, scheduled points are
+		// delayed by it
+		m_lastTime = millis();
+		const unsigned long pausedTime = m_lastTime - m_pausedAt;
+		for (int i = m_curPoint; i != m_pointToFill; i = (i + 1) % bufferDimension) {
+			if (m_buffer[i].scheduled) {
+				m_buffer[i].startTime += pausedTime;
+			}
+		}
+		m_paused = false;
+	}
+}
+
+void SequencePlayer::setTimeScale(unsigned int scale)
+{
+	m_timeScale = scale;
+}
+
+void SequencePlayer::setLimits(int servo, unsigned int maxSpeed, unsigned int maxAcceleration)
+{
+	m_limiters[servo].setLimits(maxSpeed, maxAcceleration);
+}
+
+bool SequencePlayer::saturationCountsChanged()
+{
+	const bool changed = m_saturationCountsChanged;
+
+	m_saturationCountsChanged = false;
+
+	return changed;
+}
+
+void SequencePlayer::resetSaturationCounts()
+{
+	memset(m_saturationCount, 0, sizeof(m_saturationCount));
+	m_saturationCountsChanged = false;
+}
+
 bool SequencePlayer::step()
 {
+	// Counted again below if servos are moved in this step
+	m_movingServos = 0;
+
 	if (bufferEmpty()) {
+		// Servos lagging behind because of limits still have to reach their
+		// target
+		// Servos hold still otherwise, so the next movement is limited from
+		// now and not from the last time they moved
+		if (!m_servosSettled) {
+			settleServos(millis());
+		} else {
+			m_lastMoveTime = millis();
+		}
+
 		return false;
 	}
 
+	// When paused we simply leave servos where they are
+	if (m_paused) {
+		m_lastMoveTime = millis();
+
+		return true;
+	}
+
+	// Updating the time elapsed since the beginning of the point, scaling
+	// the time passed since the last step
+	const unsigned long curTime = millis();
+	const bool lastPoint = (((m_curPoint + 1) % bufferDimension) == m_pointToFill);
 	if (m_startingNewPoint) {
-		// Storing the start time
-		m_stepStartTime = millis();
+		// Scheduled points start at their time. If late, they are played
+		// from where they would be now
+		unsigned long lateness = 0;
+		const SequencePoint& p = m_buffer[m_curPoint];
+		if (p.scheduled) {
+			if (((long) (curTime - p.startTime)) < 0) {
+				// Too early, only servos lagging behind because of limits move
+				if (!m_servosSettled) {
+					settleServos(curTime);
+				} else {
+					m_lastMoveTime = curTime;
+				}
+
+				return true;
+			}
+
+			lateness = curTime - p.startTime;
+			if ((m_latePointPolicy == DropLatePoints) && (!lastPoint) && (((lateness * m_timeScale) >> 8) > pointEndTime())) {
+				// The point should already be over, skipping it
+				if (m_droppedPoints < 255) {
+					++m_droppedPoints;
+				}
+				forceNextPoint();
+
+				return step();
+			}
+		}
+
+		m_stepTime = lateness * m_timeScale;
+	} else {
+		m_stepTime += (curTime - m_lastTime) * m_timeScale;
 	}
+	m_lastTime = curTime;
+
+	// Now checking how much has passed since we being move (in milliseconds)
+	const unsigned long stepTime = m_stepTime >> 8;
 
-	// Now checking how much has passed since we being move
-	const unsigned long stepTime = millis() - m_stepStartTime;
+	// Channels updated by a new point begin a new segment
+	if (m_startingNewPoint) {
+		startSegments();
+	}
 
 	// Checking what to do. Notice that if both timeToTarget and duration are 0, we move
 	// to the target position directly. If the first check, the !m_startingNewPoint condition
 	// is checked to avoid skipping a point that has both timeToTarget and duration to 0 when
-	// millis() changes between the two calls above
-	if ((!m_startingNewPoint) && (stepTime > (m_buffer[m_curPoint].timeToTarget + m_buffer[m_curPoint].duration))) {
+	// millis() changes between the two calls above. If the next point is scheduled, the
+	// current one lasts until the next one starts
+	const SequencePoint& next = m_buffer[(m_curPoint + 1) % bufferDimension];
+	const bool pointEnded = ((!lastPoint) && next.scheduled) ? (((long) (curTime - next.startTime)) >= 0) : ((stepTime > pointEndTime()) && ((!lastPoint) || (stepTime > m_movingUntil)));
+	if ((!m_startingNewPoint) && pointEnded) {
 		// The current step has finished, moving to the next one and recursively calling self
+		advanceSegments(stepTime);
 		forceNextPoint();
 
 		return step();
 	} else {
+		// The time since servos were last moved, used to limit their speed
+		const unsigned long moveTime = curTime - m_lastMoveTime;
+
 		// Checking if we have to move (if not we simply wait)
-		if ((m_startingNewPoint) || (stepTime <= m_buffer[m_curPoint].timeToTarget)) {
-			// We have not reached the point yet, moving servos
+		if ((m_startingNewPoint) || (stepTime <= m_movingUntil)) {
+			// Some segment has not reached its target yet, moving servos
+			m_servosSettled = true;
+			beginFrames();
 			for (int i = 0; i < SequencePoint::dim; ++i) {
-				moveServo(i, currentServoPos(i, stepTime));
+				// A servo is only settled once its segment has ended
+				const unsigned int pos = currentServoPos(i, stepTime);
+				const bool settled = moveServoLimited(i, pos, moveTime) && (pos == m_segmentTarget[i]);
+				if (!settled) {
+					++m_movingServos;
+				}
+				m_servosSettled = settled && m_servosSettled;
 			}
+			commitFrames();
+			m_lastMoveTime = curTime;
+		} else if (!m_servosSettled) {
+			// Servos lagging behind because of limits still have to reach
+			// the point
+			settleServos(curTime);
+		} else {
+			// Waiting with all servos on target
+			m_lastMoveTime = curTime;
 		}
 	}
 
@@ -120,38 +287,162 @@ bool SequencePlayer::step()
 	return true;
 }
 
+unsigned long SequencePlayer::testBus(unsigned int numWrites)
+{
+	// The register used for the test (its default value is restored at the
+	// end). It is only used when the subaddress is enabled in MODE1, which we
+	// never do
+	const uint8_t testRegister = PCA9685_SUBADR1;
+	const uint8_t testRegisterDefault = 0xE2;
+
+	// Waiting for the transactions already queued, only ours are timed
+	twiQueue.flush();
+	const unsigned int completedBefore = twiQueue.completedTransactions();
+	const unsigned int failedBefore = twiQueue.failedTransactions();
+	const unsigned long startTime = micros();
+
+	// The lowest bit of the register is read only
+	uint8_t value = 0;
+	for (unsigned int i = 0; i < numWrites; ++i) {
+		value = (i << 1) & 0xFE;
+		m_pwm[0].write8(testRegister, value);
+	}
+
+	// Reading waits for the writes to be transferred
+	const bool valueOk = (m_pwm[0].read8(testRegister) == value);
+	const unsigned long elapsedTime = micros() - startTime;
+	const unsigned long completed = twiQueue.completedTransactions() - completedBefore;
+	const bool failed = (twiQueue.failedTransactions() != failedBefore);
+
+	m_pwm[0].write8(testRegister, testRegisterDefault);
+
+	if (!valueOk || failed || (elapsedTime == 0)) {
+		return 0;
+	}
+
+	return (completed * 1000000UL) / elapsedTime;
+}
+
 void SequencePlayer::clearBuffer()
 {
 	// Changing m_pointToFill so that we do not have to also change m_prevPoint
 	m_pointToFill = m_curPoint;
+	m_droppedPoints = 0;
 
 	// We also set the flag for the starting of a new point to true to store the start time
 	// the first time step() is called with a point
 	m_startingNewPoint = true;
 }
 
-unsigned char SequencePlayer::currentServoPos(int servo, unsigned long curTime)
+unsigned int SequencePlayer::currentServoPos(int servo, unsigned long curTime)
 {
-	// Computing the new position. This is still a value between 0 and 255.
-	// If timeToTarget is 0, the new position will be the one in curPoint
-	unsigned char newPos;
+	// The time since the beginning of the segment of the servo
+	const unsigned long t = m_segmentTime[servo] + curTime;
+	if (t >= m_segmentTimeToTarget[servo]) {
+		return m_segmentTarget[servo];
+	}
 
-	if (m_buffer[m_curPoint].timeToTarget == 0) {
-		newPos = m_buffer[m_curPoint].point[servo];
-	} else {
-		const long d = long(m_buffer[m_curPoint].point[servo]) - long(m_buffer[m_prevPoint].point[servo]);
-		const long newP = long(m_buffer[m_prevPoint].point[servo]) + ((d * long(curTime)) / long(m_buffer[m_curPoint].timeToTarget));
-		newPos = (unsigned char) newP;
+	// Computing the new position. This is still a value between 0 and
+	// SequencePoint::maxPosition. The computation is in interpolation.h because it is shared with the
+	// PC program
+	return interpolatePosition(m_segmentStart[servo], m_segmentTarget[servo], t, m_segmentTimeToTarget[servo], m_segmentProfile[servo]);
+}
+
+unsigned long SequencePlayer::pointEndTime() const
+{
+	const SequencePoint& p = m_buffer[m_curPoint];
+
+	// Partial points do not wait for their channels to reach the target
+	return p.partial ? p.duration : (static_cast<unsigned long>(p.timeToTarget) + p.duration);
+}
+
+void SequencePlayer::startSegments()
+{
+	const SequencePoint& p = m_buffer[m_curPoint];
+
+	m_movingUntil = 0;
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		if (p.updatesChannel(i)) {
+			// The new segment starts where the servo is now
+			m_segmentStart[i] = currentServoPos(i, 0);
+			m_segmentTarget[i] = p.point[i];
+			m_segmentTimeToTarget[i] = p.timeToTarget;
+			m_segmentProfile[i] = p.profile;
+			m_segmentTime[i] = 0;
+		}
+
+		if (m_segmentTime[i] < m_segmentTimeToTarget[i]) {
+			const unsigned long remaining = m_segmentTimeToTarget[i] - m_segmentTime[i];
+			if (remaining > m_movingUntil) {
+				m_movingUntil = remaining;
+			}
+		}
 	}
+}
 
-	return newPos;
+void SequencePlayer::advanceSegments(unsigned long curTime)
+{
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		// No need to keep counting once the target has been reached (this
+		// also avoids overflows)
+		const unsigned long t = m_segmentTime[i] + curTime;
+		m_segmentTime[i] = (t < m_segmentTimeToTarget[i]) ? t : m_segmentTimeToTarget[i];
+	}
 }
 
-void SequencePlayer::moveServo(int servo, unsigned char pos)
+void SequencePlayer::moveServo(int servo, unsigned int pos)
 {
-	// Here we map the position in the PWM range. pos is always a value between 0 and 255
-	const long mappedPos = ((long(pos) * m_servoRange[servo]) / 255) + m_servoMin[servo];
+	// Here we map the position in the PWM range. pos is always a value between 0 and
+	// SequencePoint::maxPosition, so that we use the whole resolution of the driver
+	const long mappedPos = ((long(pos) * m_servoRange[servo]) / long(SequencePoint::maxPosition)) + m_servoMin[servo];
 
 	// Moving servo
-	m_pwm.setPWM(servo, 0, mappedPos);
+	m_pwm[servo / channelsPerBoard].setPWM(servo % channelsPerBoard, 0, mappedPos);
+}
+
+void SequencePlayer::settleServos(unsigned long curTime)
+{
+	const unsigned long moveTime = curTime - m_lastMoveTime;
+
+	m_servosSettled = true;
+	beginFrames();
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		const bool settled = moveServoLimited(i, m_segmentTarget[i], moveTime);
+		if (!settled) {
+			++m_movingServos;
+		}
+		m_servosSettled = settled && m_servosSettled;
+	}
+	commitFrames();
+	m_lastMoveTime = curTime;
+}
+
+void SequencePlayer::beginFrames()
+{
+	for (int i = 0; i < numBoards; ++i) {
+		m_pwm[i].beginFrame();
+	}
+}
+
+void SequencePlayer::commitFrames()
+{
+	for (int i = 0; i < numBoards; ++i) {
+		m_pwm[i].commitFrame();
+	}
+}
+
+bool SequencePlayer::moveServoLimited(int servo, unsigned int pos, unsigned long dt)
+{
+	RateLimiter& limiter = m_limiters[servo];
+
+	// Without limits this simply returns pos
+	const unsigned int limitedPos = limiter.update(pos, dt);
+	if (limiter.saturated() && (m_saturationCount[servo] != 0xFFFF)) {
+		++m_saturationCount[servo];
+		m_saturationCountsChanged = true;
+	}
+
+	moveServo(servo, limitedPos);
+
+	return limiter.settled(pos) || !limiter.limited();
 }
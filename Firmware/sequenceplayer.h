@@ -23,8 +23,21 @@
 #define SEQUENCEPLAYER_H
 
 #include "sequencepoint.h"
+#include "ratelimiter.h"
 #include "AdafruitPWMServoDriver.h"
 
+/**
+ * \brief What to do with scheduled points that start late
+ */
+enum LatePointPolicy {
+	// Late points are played from where they would be now, so the sequence
+	// catches up with the schedule
+	CatchUpLatePoints = 0,
+	// Points that should already be over are skipped if a later point is in
+	// the buffer, the others catch up
+	DropLatePoints
+};
+
 /**
  * \brief The class controlling the servos
  *
@@ -37,7 +50,45 @@
  * at which servos must move to a new postition. The current position of servos
  * is stored in the buffer but it never cleared. After instantiating this class,
  * always call begin before starting to use the object. We internally use an
- * Adafruit_PWMServoDriver object to control the servos
+ * Adafruit_PWMServoDriver object to control the servos: the positions of all
+ * servos computed in a step are sent as a single frame, so that they change
+ * at the same time and only servos whose position changed are written
+ *
+ * The time used to play points can be paused and scaled. When paused, servos
+ * are kept in their current (interpolated) position and the time of the
+ * current point does not advance. The time scale is a fixed point value with 8
+ * fractional bits (256 means normal speed, 512 double speed, 128 half speed)
+ * that applies to all points in the buffer, so that the tempo of the sequence
+ * can be changed without sending points again
+ *
+ * The speed and acceleration of each servo can be limited (see RateLimiter).
+ * When a point requires a servo to move faster than allowed, the servo lags
+ * behind and catches up as soon as possible (also while the point position is
+ * kept for its duration). Each time the position of a servo is limited, the
+ * saturation count of the servo is incremented, so that sequences that are
+ * too fast for the robot can be detected
+ *
+ * Each servo follows its own segment: a movement from a start position to a
+ * target with its own time to target and profile. A point starts a new
+ * segment only for the channels it updates (see SequencePoint::channels),
+ * starting from the position the servo has at that moment; the other
+ * channels continue their segment across the point boundary. Partial points
+ * end after their duration even if their segments are still running (see
+ * SequencePoint). To avoid leaving servos halfway, the last point in the
+ * buffer does not end until all segments have reached their targets
+ *
+ * A point can be scheduled to start at a given value of millis() (see
+ * SequencePoint::scheduled), so that the host can keep the robot in sync
+ * with an external clock over long sequences. A scheduled point starts at its
+ * time regardless of when the previous point ends: servos keep the position
+ * if the previous point ends earlier, the previous point is cut short
+ * otherwise. If the point starts late (e.g. after the buffer ran empty) it is
+ * handled according to the LatePointPolicy. The time scale does not change
+ * start times, only how fast points are played
+ *
+ * Servos are distributed on as many PCA9685 boards as needed, each with its
+ * own I²C address: servo i is channel (i % channelsPerBoard) of board
+ * (i / channelsPerBoard)
  */
 class SequencePlayer
 {
@@ -45,7 +96,22 @@ public:
 	/**
 	 * \brief How many sequence points we can buffer
 	 */
-	static const int bufferDimension = 4;
+	static const int bufferDimension = 6;
+
+	/**
+	 * \brief The number of channels of each PWM board
+	 */
+	static const unsigned char channelsPerBoard = PCA9685_CHANNELS;
+
+	/**
+	 * \brief The number of PWM boards
+	 */
+	static const unsigned char numBoards = (SequencePoint::dim + channelsPerBoard - 1) / channelsPerBoard;
+
+	/**
+	 * \brief The time scale corresponding to normal speed
+	 */
+	static const unsigned int normalTimeScale = 256;
 
 public:
 	/**
@@ -55,8 +121,9 @@ public:
 	 *                 servos
 	 * \param servoMax the vector with the maximum valus of the PWM of
 	 *                 servos
+	 * \param boardAddresses the I²C addresses of the PWM boards
 	 */
-	SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim]);
+	SequencePlayer(const unsigned int servoMin[SequencePoint::dim], const unsigned int servoMax[SequencePoint::dim], const unsigned char boardAddresses[numBoards]);
 
 	/**
 	 * \brief Initializes servos
@@ -72,7 +139,10 @@ public:
 	 * \brief Returns a pointer to the next point in the buffer to fill
 	 *
 	 * This returns NULL if the buffer is full. This function keeps
-	 * returning the same point until the pointFilled() function is called
+	 * returning the same point until the pointFilled() function is called.
+	 * The coordinates of the returned point are those of the last point
+	 * that was filled, so that packets carrying only some coordinates can
+	 * be written directly into it
 	 * \return a pointer to the next point in the buffer to fill or NULL if
 	 *         the buffer is full
 	 */
@@ -105,6 +175,135 @@ public:
 	 */
 	bool step();
 
+	/**
+	 * \brief Pauses playing points
+	 *
+	 * Servos are kept in the position they have now until resume() is
+	 * called. If already paused, this does nothing
+	 */
+	void pause();
+
+	/**
+	 * \brief Resumes playing points after a call to pause()
+	 *
+	 * Scheduled points in the buffer are delayed by the time spent paused.
+	 * If not paused, this does nothing
+	 */
+	void resume();
+
+	/**
+	 * \brief Returns true if paused
+	 *
+	 * \return true if paused
+	 */
+	bool paused() const
+	{
+		return m_paused;
+	}
+
+	/**
+	 * \brief Sets the time scale
+	 *
+	 * This takes effect immediately, also for the point being played
+	 * \param scale the time scale as a fixed point value with 8 fractional
+	 *              bits (normalTimeScale is the normal speed)
+	 */
+	void setTimeScale(unsigned int scale);
+
+	/**
+	 * \brief Returns the time scale
+	 *
+	 * \return the time scale as a fixed point value with 8 fractional bits
+	 */
+	unsigned int timeScale() const
+	{
+		return m_timeScale;
+	}
+
+	/**
+	 * \brief Sets the speed and acceleration limits of a servo
+	 *
+	 * \param servo the index of the servo
+	 * \param maxSpeed the maximum speed in positions per second (0 means no
+	 *                 limit)
+	 * \param maxAcceleration the maximum acceleration in positions per
+	 *                        second squared (0 means no limit)
+	 */
+	void setLimits(int servo, unsigned int maxSpeed, unsigned int maxAcceleration);
+
+	/**
+	 * \brief Sets what to do with scheduled points that start late
+	 *
+	 * \param policy the policy for late points
+	 */
+	void setLatePointPolicy(LatePointPolicy policy)
+	{
+		m_latePointPolicy = policy;
+	}
+
+	/**
+	 * \brief Returns the number of scheduled points skipped because they
+	 *        were late
+	 *
+	 * The count is since the last call to clearBuffer() and stops at 255
+	 * \return the number of points skipped
+	 */
+	unsigned char droppedPoints() const
+	{
+		return m_droppedPoints;
+	}
+
+	/**
+	 * \brief Returns the number of servos moved by the last call to step()
+	 *
+	 * Servos waiting for the next point or already at their target are not
+	 * counted
+	 * \return the number of servos that are moving
+	 */
+	unsigned char movingServos() const
+	{
+		return m_movingServos;
+	}
+
+	/**
+	 * \brief Returns how many times the position of each servo was limited
+	 *
+	 * Counts are since the last call to resetSaturationCounts() and stop
+	 * at 65535
+	 * \return an array with the saturation count of each servo
+	 *         (SequencePoint::dim elements)
+	 */
+	const unsigned int* saturationCounts() const
+	{
+		return m_saturationCount;
+	}
+
+	/**
+	 * \brief Returns true if some saturation count changed since the last
+	 *        call to this function
+	 *
+	 * \return true if some saturation count changed
+	 */
+	bool saturationCountsChanged();
+
+	/**
+	 * \brief Resets the saturation count of all servos
+	 */
+	void resetSaturationCounts();
+
+	/**
+	 * \brief Tests the I²C bus at the current frequency
+	 *
+	 * This writes a register of the first PWM board numWrites times, reads it
+	 * back to check that the last value was received and then restores it.
+	 * Servos are not moved. Call this only when not playing a sequence: it
+	 * waits for all transactions to be transferred
+	 * \param numWrites the number of writes to time
+	 * \return the number of transactions per second or 0 if some
+	 *         transaction failed or the value read back is wrong
+	 */
+	unsigned long testBus(unsigned int numWrites);
+
 	/**
 	 * \brief Clears the buffer
 	 *
@@ -138,24 +337,81 @@ private:
 	 *        time
 	 *
 	 * \param servo the index of the servo to move
-	 * \param curTime the current step time. This MUST be lower than the
-	 *                timeToTarget of the current step
+	 * \param curTime the current step time
 	 * \return the position the servo should have
 	 */
-	unsigned char currentServoPos(int servo, unsigned long curTime);
+	unsigned int currentServoPos(int servo, unsigned long curTime);
+
+	/**
+	 * \brief Returns the step time at which the current point ends
+	 *
+	 * \return the step time at which the current point ends
+	 */
+	unsigned long pointEndTime() const;
+
+	/**
+	 * \brief Starts the segments of the channels updated by the current
+	 *        point
+	 *
+	 * This also computes m_movingUntil
+	 */
+	void startSegments();
+
+	/**
+	 * \brief Advances the time of segments when the current point ends
+	 *
+	 * \param curTime the step time at which the current point ended
+	 */
+	void advanceSegments(unsigned long curTime);
 
 	/**
 	 * \brief Moves one servo to specified position
 	 *
 	 * \param servo the index of the servo to move
-	 * \param pos the position to which the servo should be moved
+	 * \param pos the position to which the servo should be moved (with 8
+	 *            fractional bits, see SequencePoint)
+	 */
+	void moveServo(int servo, unsigned int pos);
+
+	/**
+	 * \brief Moves one servo towards the specified position respecting
+	 *        speed and acceleration limits
+	 *
+	 * \param servo the index of the servo to move
+	 * \param pos the position the servo should have
+	 * \param dt the time since the last movement in milliseconds
+	 * \return true if the servo has reached pos
+	 */
+	bool moveServoLimited(int servo, unsigned int pos, unsigned long dt);
+
+	/**
+	 * \brief Moves servos lagging behind because of limits towards the
+	 *        targets of their segments
+	 *
+	 * This updates m_servosSettled
+	 * \param curTime the current value of millis()
+	 */
+	void settleServos(unsigned long curTime);
+
+	/**
+	 * \brief Starts a frame on all PWM boards
+	 *
+	 * Positions of servos set until commitFrames() is called are sent
+	 * together (see Adafruit_PWMServoDriver::beginFrame())
+	 */
+	void beginFrames();
+
+	/**
+	 * \brief Sends the frames of all PWM boards
+	 *
+	 * There is one transaction for each board with changed positions
 	 */
-	void moveServo(int servo, unsigned char pos);
+	void commitFrames();
 
 	/**
-	 * \brief The driver of motors
+	 * \brief The drivers of motors, one per board
 	 */
-	Adafruit_PWMServoDriver m_pwm;
+	Adafruit_PWMServoDriver m_pwm[numBoards];
 
 	/**
 	 * \brief The buffer for sequence points
@@ -178,19 +434,120 @@ private:
 	int m_pointToFill;
 
 	/**
-	 * \brief The time the sequence point started in milliseconds
+	 * \brief The time elapsed since the sequence point started
 	 *
-	 * This is set using millis()
+	 * This is in 1/256 of milliseconds and is already scaled by the time
+	 * scale. It does not advance while paused
+	 */
+	unsigned long m_stepTime;
+
+	/**
+	 * \brief The value of millis() the last time m_stepTime was updated
+	 */
+	unsigned long m_lastTime;
+
+	/**
+	 * \brief The time scale
+	 *
+	 * See the class description
+	 */
+	unsigned int m_timeScale;
+
+	/**
+	 * \brief True if paused
+	 */
+	bool m_paused;
+
+	/**
+	 * \brief The value of millis() when pause() was called
+	 */
+	unsigned long m_pausedAt;
+
+	/**
+	 * \brief The value of millis() the last time servos were moved
 	 */
-	unsigned long m_stepStartTime;
+	unsigned long m_lastMoveTime;
+
+	/**
+	 * \brief False if some servo lags behind the position of the current
+	 *        point because of limits
+	 */
+	bool m_servosSettled;
+
+	/**
+	 * \brief The number of servos moved by the last step
+	 */
+	unsigned char m_movingServos;
+
+	/**
+	 * \brief The position of each servo when its segment started
+	 */
+	unsigned int m_segmentStart[SequencePoint::dim];
+
+	/**
+	 * \brief The target of the segment of each servo
+	 */
+	unsigned int m_segmentTarget[SequencePoint::dim];
+
+	/**
+	 * \brief The time to target of the segment of each servo
+	 */
+	unsigned int m_segmentTimeToTarget[SequencePoint::dim];
+
+	/**
+	 * \brief The interpolation profile of the segment of each servo
+	 */
+	unsigned char m_segmentProfile[SequencePoint::dim];
+
+	/**
+	 * \brief The time elapsed in the segment of each servo when the current
+	 *        point started
+	 *
+	 * This is in milliseconds and stops growing once past the time to
+	 * target of the segment
+	 */
+	unsigned int m_segmentTime[SequencePoint::dim];
+
+	/**
+	 * \brief The step time after which all segments have reached their
+	 *        target
+	 */
+	unsigned long m_movingUntil;
+
+	/**
+	 * \brief The objects limiting speed and acceleration of servos
+	 */
+	RateLimiter m_limiters[SequencePoint::dim];
+
+	/**
+	 * \brief How many times the position of each servo was limited
+	 */
+	unsigned int m_saturationCount[SequencePoint::dim];
+
+	/**
+	 * \brief True if some saturation count changed
+	 *
+	 * See saturationCountsChanged()
+	 */
+	bool m_saturationCountsChanged;
 
 	/**
 	 * \brief Set to true when starting a new sequence point
 	 *
-	 * This is needed to store the m_stepStartTime
+	 * This is needed to reset m_stepTime
 	 */
 	bool m_startingNewPoint;
 
+	/**
+	 * \brief What to do with scheduled points that start late
+	 */
+	LatePointPolicy m_latePointPolicy;
+
+	/**
+	 * \brief The number of scheduled points skipped because they were late
+	 */
+	unsigned char m_droppedPoints;
+
 	/**
 	 * \brief The minimum value for servos PWM
 	 */
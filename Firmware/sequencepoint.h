@@ -22,23 +22,62 @@
 #ifndef SEQUENCEPOINT_H
 #define SEQUENCEPOINT_H
 
+/**
+ * \brief The number of servos of the robot
+ *
+ * Change this (or define it when building) for robots with a different
+ * number of servos. Servos are driven by PCA9685 boards with 16 channels each
+ * (see SequencePlayer). The maximum is 127
+ */
+#ifndef NUM_SERVOS
+	#define NUM_SERVOS 16
+#endif
+
 /**
  * \brief A single point of the sequence
+ *
+ * A partial point only updates some of the channels (see channels) and does
+ * not wait for them to reach the target: it lasts duration milliseconds from
+ * its start, after which the next point starts. Channels keep moving towards
+ * the target of the last point that updated them, so that independent parts
+ * of the robot can move with different timings without splitting movements
+ * into several points
  */
 struct SequencePoint
 {
 	/**
 	 * \brief The dimension of points
 	 */
-	static const unsigned char dim = 16;
+	static const unsigned char dim = NUM_SERVOS;
+
+	/**
+	 * \brief The number of bytes of the channel mask
+	 */
+	static const unsigned char channelsBytes = (dim + 7) / 8;
+
+	/**
+	 * \brief The maximum value of coordinates
+	 *
+	 * This corresponds to 255 in the 8 bit positions of the wire format
+	 */
+	static const unsigned int maxPosition = 255u << 8;
 
 	/**
 	 * \brief The point coordinates
+	 *
+	 * Coordinates have 8 fractional bits, so that positions received with
+	 * 16 bits are not truncated and movements are interpolated with a
+	 * resolution higher than that of the servo drivers. They go from 0 to
+	 * maxPosition
 	 */
-	unsigned char point[dim];
+	unsigned int point[dim];
 
 	/**
 	 * \brief The duration of the point in milliseconds
+	 *
+	 * This is the time the target is kept after being reached or, for
+	 * partial points, the time from the beginning of the point to the
+	 * beginning of the next one
 	 */
 	unsigned int duration;
 
@@ -46,6 +85,53 @@ struct SequencePoint
 	 * \brief The time to reach this point in milliseconds
 	 */
 	unsigned int timeToTarget;
+
+	/**
+	 * \brief How to move towards this point
+	 *
+	 * This is one of the values of InterpolationProfile (see
+	 * interpolation.h)
+	 */
+	unsigned char profile;
+
+	/**
+	 * \brief True if this is a partial point
+	 */
+	bool partial;
+
+	/**
+	 * \brief The mask of channels updated by this point
+	 *
+	 * Bit (i % 8) of byte (i / 8) is set if channel i is updated. The
+	 * coordinates of channels that are not updated are ignored. All bits
+	 * are set if the point is not partial
+	 */
+	unsigned char channels[channelsBytes];
+
+	/**
+	 * \brief True if the point must start at startTime
+	 *
+	 * Points that are not scheduled start when the previous one ends
+	 */
+	bool scheduled;
+
+	/**
+	 * \brief The value of millis() at which the point starts
+	 *
+	 * This is only used for scheduled points (see SequencePlayer)
+	 */
+	unsigned long startTime;
+
+	/**
+	 * \brief Returns true if the channel is updated by this point
+	 *
+	 * \param i the index of the channel
+	 * \return true if the channel is updated by this point
+	 */
+	bool updatesChannel(int i) const
+	{
+		return (channels[i / 8] & (1 << (i % 8))) != 0;
+	}
 };
 
 #endif
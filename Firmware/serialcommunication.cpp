@@ -28,8 +28,20 @@ SerialCommunication::SerialCommunication()
 	: m_pointToFill(NULL)
 	, m_receivedCommand(0)
 	, m_receivedPacketBytes(0)
+	, m_receivedPointLength(SequencePoint::dim + 5)
+	, m_receivedHeaderLength(5)
+	, m_nextMaskedChannel(0)
+	, m_positionBytes(1)
 	, m_receivedPointDim(0)
+	, m_receivedTimeScale(0)
+	, m_receivedLimitsServo(0)
+	, m_receivedMaxSpeed(0)
+	, m_receivedMaxAcceleration(0)
+	, m_receivedFaceExpression(0)
+	, m_receivedFaceTextLength(0)
 {
+	m_receivedFaceText[0] = '\0';
+	memset(m_receivedPingTimestamp, 0, sizeof(m_receivedPingTimestamp));
 }
 
 void SerialCommunication::begin(long baudRate)
@@ -50,43 +62,171 @@ bool SerialCommunication::commandReceived()
 			m_receivedPacketBytes = 0;
 
 			// Setting the received command to the byte we just read and checking if the
-			// command if finished here (the only command that ends in one byte is 'H')
+			// command if finished here (the commands that end in one byte are 'H', 'Z'
+			// and 'R')
 			m_receivedCommand = (char) v;
-			if (m_receivedCommand == 'H') {
+			if ((m_receivedCommand == 'H') || (m_receivedCommand == 'Z') || (m_receivedCommand == 'R')) {
 				retVal = true;
 				break;
 			}
 		} else if ((m_receivedCommand == 'S') || (m_receivedCommand == 'I')) {
 			++m_receivedPacketBytes;
 
-			// The byte we received is the point dimension, storing and returning true
-			m_receivedPointDim = (unsigned char) v;
+			// The byte we received is the point dimension, storing and returning true.
+			// The highest bit tells whether positions in sequence points are 16 bits
+			m_receivedPointDim = ((unsigned char) v) & ~widePositionsFlag;
+			m_positionBytes = ((((unsigned char) v) & widePositionsFlag) != 0) ? 2 : 1;
 			retVal = true;
 			break;
+		} else if (m_receivedCommand == 'T') {
+			++m_receivedPacketBytes;
+
+			// Two bytes of time scale, most significant byte first
+			if (m_receivedPacketBytes == 1) {
+				m_receivedTimeScale = ((unsigned char) v) << 8;
+			} else {
+				m_receivedTimeScale += (unsigned char) v;
+				retVal = true;
+				break;
+			}
+		} else if (m_receivedCommand == 'L') {
+			++m_receivedPacketBytes;
+
+			// Servo index, then maximum speed and acceleration (two bytes each,
+			// most significant byte first)
+			switch (m_receivedPacketBytes) {
+				case 1:
+					m_receivedLimitsServo = (unsigned char) v;
+					break;
+				case 2:
+					m_receivedMaxSpeed = ((unsigned char) v) << 8;
+					break;
+				case 3:
+					m_receivedMaxSpeed += (unsigned char) v;
+					break;
+				case 4:
+					m_receivedMaxAcceleration = ((unsigned char) v) << 8;
+					break;
+				case 5:
+					m_receivedMaxAcceleration += (unsigned char) v;
+					break;
+			}
+
+			if (m_receivedPacketBytes == 5) {
+				retVal = true;
+				break;
+			}
+		} else if (m_receivedCommand == 'X') {
+			++m_receivedPacketBytes;
+
+			// The byte we received is the expression
+			m_receivedFaceExpression = (unsigned char) v;
+			retVal = true;
+			break;
+		} else if (m_receivedCommand == 'U') {
+			++m_receivedPacketBytes;
+
+			// The length, then the characters. Those that don't fit are
+			// discarded
+			if (m_receivedPacketBytes == 1) {
+				m_receivedFaceTextLength = (unsigned char) v;
+			} else if (m_receivedPacketBytes <= (TextScroller::maxTextLength + 1)) {
+				m_receivedFaceText[m_receivedPacketBytes - 2] = (char) v;
+			}
+
+			if (m_receivedPacketBytes == (m_receivedFaceTextLength + 1)) {
+				m_receivedFaceText[min(m_receivedFaceTextLength, TextScroller::maxTextLength)] = '\0';
+				retVal = true;
+				break;
+			}
+		} else if (m_receivedCommand == 'G') {
+			++m_receivedPacketBytes;
+
+			// Four bytes of timestamp, only stored to echo them back
+			m_receivedPingTimestamp[m_receivedPacketBytes - 1] = (unsigned char) v;
+
+			if (m_receivedPacketBytes == sizeof(m_receivedPingTimestamp)) {
+				retVal = true;
+				break;
+			}
 		} else if (m_receivedCommand == 'P') {
 			++m_receivedPacketBytes;
 
-			if (m_pointToFill != NULL) {
-				switch (m_receivedPacketBytes) {
-					case 1:
-						m_pointToFill->duration = ((unsigned char) v) << 8;
-						break;
-					case 2:
-						m_pointToFill->duration += (unsigned char) v;
-						break;
-					case 3:
-						m_pointToFill->timeToTarget = ((unsigned char) v) << 8;
-						break;
-					case 4:
-						m_pointToFill->timeToTarget += (unsigned char) v;
-						break;
-					default:
-						m_pointToFill->point[m_receivedPacketBytes - 5] = (unsigned char) v;
-						break;
+			if (m_receivedPacketBytes <= m_receivedHeaderLength) {
+				receivePointHeader((unsigned char) v);
+			} else if (m_pointToFill != NULL) {
+				const unsigned char firstPositionByte = m_receivedPointLength - (SequencePoint::dim * m_positionBytes) + 1;
+				if (m_receivedPacketBytes < firstPositionByte) {
+					m_pointToFill->channels[m_receivedPacketBytes - m_receivedHeaderLength - 1] = (unsigned char) v;
+				} else {
+					const unsigned char k = m_receivedPacketBytes - firstPositionByte;
+					receivePositionByte(k / m_positionBytes, k % m_positionBytes, (unsigned char) v);
+				}
+			}
+
+			// The packet is longer if the options byte says a start time or a
+			// channel mask follows
+			if (m_receivedPacketBytes == 5) {
+				m_receivedHeaderLength = ((((unsigned char) v) & scheduledOption) != 0) ? 9 : 5;
+				m_receivedPointLength = (SequencePoint::dim * m_positionBytes) + m_receivedHeaderLength;
+				if ((((unsigned char) v) & channelMaskOption) != 0) {
+					m_receivedPointLength += SequencePoint::channelsBytes;
+				}
+			}
+
+			if (m_receivedPacketBytes == m_receivedPointLength) {
+				retVal = true;
+				break;
+			}
+		} else if (m_receivedCommand == 'M') {
+			++m_receivedPacketBytes;
+
+			if (m_receivedPacketBytes <= m_receivedHeaderLength) {
+				receivePointHeader((unsigned char) v);
+
+				// The length is only known when the whole bitmap has been
+				// received, here we only count the header and the bitmap
+				if (m_receivedPacketBytes == 5) {
+					m_receivedHeaderLength = ((((unsigned char) v) & scheduledOption) != 0) ? 9 : 5;
+				}
+				m_receivedPointLength = SequencePoint::channelsBytes + m_receivedHeaderLength;
+				m_nextMaskedChannel = 0;
+			} else if (m_receivedPacketBytes <= (SequencePoint::channelsBytes + m_receivedHeaderLength)) {
+				// A byte of the bitmap of channels whose value is in the packet.
+				// Bits past the point dimension are ignored
+				const unsigned char i = m_receivedPacketBytes - m_receivedHeaderLength - 1;
+				unsigned char mask = (unsigned char) v;
+				if ((i == (SequencePoint::channelsBytes - 1)) && ((SequencePoint::dim % 8) != 0)) {
+					mask &= (1 << (SequencePoint::dim % 8)) - 1;
+				}
+				m_receivedValuesMask[i] = mask;
+
+				// One more position for each bit set
+				for (; mask != 0; mask &= mask - 1) {
+					m_receivedPointLength += m_positionBytes;
+				}
+
+				// For partial points, the channels with a value are the
+				// updated ones
+				if ((m_pointToFill != NULL) && m_pointToFill->partial) {
+					m_pointToFill->channels[i] = m_receivedValuesMask[i];
+				}
+			} else {
+				// A byte of the position of the next channel in the bitmap. The
+				// others keep the value they have in the previous point
+				const unsigned char byteIndex = (m_receivedPacketBytes - SequencePoint::channelsBytes - m_receivedHeaderLength - 1) % m_positionBytes;
+				if (byteIndex == 0) {
+					while ((m_receivedValuesMask[m_nextMaskedChannel / 8] & (1 << (m_nextMaskedChannel % 8))) == 0) {
+						++m_nextMaskedChannel;
+					}
+				}
+				receivePositionByte(m_nextMaskedChannel, byteIndex, (unsigned char) v);
+				if (byteIndex == (m_positionBytes - 1)) {
+					++m_nextMaskedChannel;
 				}
 			}
 
-			if (m_receivedPacketBytes == (SequencePoint::dim + 4)) {
+			if (m_receivedPacketBytes == m_receivedPointLength) {
 				retVal = true;
 				break;
 			}
@@ -101,11 +241,82 @@ bool SerialCommunication::commandReceived()
 	return retVal;
 }
 
+void SerialCommunication::receivePointHeader(unsigned char v)
+{
+	if (m_pointToFill == NULL) {
+		return;
+	}
+
+	switch (m_receivedPacketBytes) {
+		case 1:
+			m_pointToFill->duration = v << 8;
+			break;
+		case 2:
+			m_pointToFill->duration += v;
+			break;
+		case 3:
+			m_pointToFill->timeToTarget = v << 8;
+			break;
+		case 4:
+			m_pointToFill->timeToTarget += v;
+			break;
+		case 5:
+			// The lowest three bits of the options byte are the profile
+			m_pointToFill->profile = v & 0x07;
+			// Points with a channel mask are partial. If there is no channel
+			// mask, all channels are updated
+			m_pointToFill->partial = ((v & channelMaskOption) != 0);
+			memset(m_pointToFill->channels, 0xFF, SequencePoint::channelsBytes);
+			// Points with a start time have 4 more bytes
+			m_pointToFill->scheduled = ((v & scheduledOption) != 0);
+			break;
+		case 6:
+			m_pointToFill->startTime = v;
+			break;
+		case 7:
+		case 8:
+		case 9:
+			m_pointToFill->startTime = (m_pointToFill->startTime << 8) + v;
+			break;
+	}
+}
+
+void SerialCommunication::receivePositionByte(unsigned char channel, unsigned char byteIndex, unsigned char v)
+{
+	if (m_pointToFill == NULL) {
+		return;
+	}
+
+	// 8 bit positions become the integer part of coordinates. 16 bit ones are
+	// sent most significant byte first
+	if (byteIndex == 0) {
+		m_pointToFill->point[channel] = ((unsigned int) v) << 8;
+	} else {
+		m_pointToFill->point[channel] += v;
+	}
+
+	// The value can go past the maximum only with 16 bit positions
+	if (m_pointToFill->point[channel] > SequencePoint::maxPosition) {
+		m_pointToFill->point[channel] = SequencePoint::maxPosition;
+	}
+}
+
 void SerialCommunication::setNextSequencePointToFill(SequencePoint* p)
 {
 	m_pointToFill = p;
 }
 
+void SerialCommunication::sendPong()
+{
+	const unsigned long curTime = millis();
+
+	Serial.write('Q');
+	Serial.write(m_receivedPingTimestamp, sizeof(m_receivedPingTimestamp));
+	for (int i = 3; i >= 0; --i) {
+		Serial.write((curTime >> (8 * i)) & 0xFF);
+	}
+}
+
 void SerialCommunication::sendBufferNotFull()
 {
 	Serial.write('N');
@@ -121,6 +332,7 @@ void SerialCommunication::sendSequenceFinished()
 	Serial.write('E');
 }
 
+#ifdef DEBUG_PACKETS
 void SerialCommunication::sendDebugPacket(const char* msg)
 {
 	const unsigned int msgLen = min(strlen(msg), 255);
@@ -131,6 +343,15 @@ void SerialCommunication::sendDebugPacket(const char* msg)
 		Serial.write(msg[i]);
 	}
 }
+#endif
+
+void SerialCommunication::sendEvent(unsigned char code, unsigned char arg0, unsigned char arg1)
+{
+	Serial.write('V');
+	Serial.write(code);
+	Serial.write(arg0);
+	Serial.write(arg1);
+}
 
 void SerialCommunication::sendBatteryCharge(unsigned char v)
 {
@@ -138,10 +359,71 @@ void SerialCommunication::sendBatteryCharge(unsigned char v)
 	Serial.write(v);
 }
 
+void SerialCommunication::sendSaturationCounts(const unsigned int* counts)
+{
+	Serial.write('C');
+	Serial.write(SequencePoint::dim);
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		Serial.write((counts[i] >> 8) & 0xFF);
+		Serial.write(counts[i] & 0xFF);
+	}
+}
+
+void SerialCommunication::sendPointDimension()
+{
+	Serial.write('K');
+	Serial.write(SequencePoint::dim);
+}
+
+void SerialCommunication::sendBusStatistics(unsigned char maxQueued, unsigned int completed, unsigned int failed, unsigned int stalls)
+{
+	Serial.write('W');
+	Serial.write(maxQueued);
+	Serial.write((completed >> 8) & 0xFF);
+	Serial.write(completed & 0xFF);
+	Serial.write((failed >> 8) & 0xFF);
+	Serial.write(failed & 0xFF);
+	Serial.write((stalls >> 8) & 0xFF);
+	Serial.write(stalls & 0xFF);
+}
+
+void SerialCommunication::sendBusTestResult(unsigned int frequency, unsigned long transactionsPerSecond)
+{
+	const unsigned int t = min(transactionsPerSecond, 65535UL);
+
+	Serial.write('Y');
+	Serial.write((frequency >> 8) & 0xFF);
+	Serial.write(frequency & 0xFF);
+	Serial.write((t >> 8) & 0xFF);
+	Serial.write(t & 0xFF);
+}
+
+void SerialCommunication::sendUnderrun(unsigned int count, unsigned int point, unsigned long startTime, unsigned long duration)
+{
+	const unsigned int d = min(duration, 65535UL);
+
+	Serial.write('O');
+	Serial.write((count >> 8) & 0xFF);
+	Serial.write(count & 0xFF);
+	Serial.write((point >> 8) & 0xFF);
+	Serial.write(point & 0xFF);
+	for (int i = 3; i >= 0; --i) {
+		Serial.write((startTime >> (8 * i)) & 0xFF);
+	}
+	Serial.write((d >> 8) & 0xFF);
+	Serial.write(d & 0xFF);
+}
+
 bool SerialCommunication::previousCommandComplete() const
 {
 	return (m_receivedCommand == 0) ||
 	       (m_receivedCommand == 'H') ||
-	       ((m_receivedPacketBytes == 1) && ((m_receivedCommand == 'S') || (m_receivedCommand == 'I'))) ||
-	       ((m_receivedPacketBytes == (SequencePoint::dim + 4)) && (m_receivedCommand == 'P'));
+	       (m_receivedCommand == 'Z') ||
+	       (m_receivedCommand == 'R') ||
+	       ((m_receivedPacketBytes == 2) && (m_receivedCommand == 'T')) ||
+	       ((m_receivedPacketBytes == 5) && (m_receivedCommand == 'L')) ||
+	       ((m_receivedPacketBytes == sizeof(m_receivedPingTimestamp)) && (m_receivedCommand == 'G')) ||
+	       ((m_receivedPacketBytes == (m_receivedFaceTextLength + 1)) && (m_receivedCommand == 'U')) ||
+	       ((m_receivedPacketBytes == 1) && ((m_receivedCommand == 'S') || (m_receivedCommand == 'I') || (m_receivedCommand == 'X'))) ||
+	       ((m_receivedPacketBytes == m_receivedPointLength) && ((m_receivedCommand == 'P') || (m_receivedCommand == 'M')));
 }
@@ -23,6 +23,13 @@
 #define SERIALCOMMUNICATION_H
 
 #include "sequencepoint.h"
+#include "textscroller.h"
+
+// Uncomment to be able to send debug packets with strings (see
+// SerialCommunication::sendDebugPacket()). Strings take RAM and bandwidth,
+// use events (see SerialCommunication::sendEvent()) for anything that is not
+// temporary debugging code
+//#define DEBUG_PACKETS
 
 /**
  * \brief The class handling the serial communication with the PC
@@ -37,10 +44,36 @@
  *
  * NOTE: we read the point dimension from start packages, but we always expect
  *       points to have a dimension equal to SequencePoint::dim. Check
- *       externally that this is true when a start package is received
+ *       externally that this is true when a start package is received. The
+ *       PC knows the dimension from the point dimension packet
  */
 class SerialCommunication
 {
+public:
+	/**
+	 * \brief The bit of the options byte of sequence points set when a
+	 *        channel mask follows (i.e. the point is partial)
+	 */
+	static const unsigned char channelMaskOption = 0x08;
+
+	/**
+	 * \brief The bit of the point dimension in start packets set when
+	 *        positions in sequence points are 16 bits
+	 *
+	 * 16 bit positions have 8 fractional bits (see SequencePoint::point),
+	 * 8 bit positions only have the integer part
+	 */
+	static const unsigned char widePositionsFlag = 0x80;
+
+	/**
+	 * \brief The bit of the options byte of sequence points set when the
+	 *        point has a start time
+	 *
+	 * The start time (4 bytes, a value of millis(), most significant byte
+	 * first) follows the options byte
+	 */
+	static const unsigned char scheduledOption = 0x10;
+
 public:
 	/**
 	 * \brief Constructor
@@ -72,11 +105,15 @@ public:
 	/**
 	 * \brief Returns true if we received a sequence point
 	 *
+	 * Points can either be full ('P' packets) or masked ('M' packets).
+	 * Masked packets only carry the coordinates of some channels, the
+	 * others are those already in the point to fill (see
+	 * SequencePlayer::pointToFill())
 	 * \return true if we received a sequence point
 	 */
 	bool isSequencePoint() const
 	{
-		return (m_receivedCommand == 'P');
+		return (m_receivedCommand == 'P') || (m_receivedCommand == 'M');
 	}
 
 	/**
@@ -109,6 +146,78 @@ public:
 		return (m_receivedCommand == 'H');
 	}
 
+	/**
+	 * \brief Returns true if we received a pause command
+	 *
+	 * \return true if we received a pause command
+	 */
+	bool isPause() const
+	{
+		return (m_receivedCommand == 'Z');
+	}
+
+	/**
+	 * \brief Returns true if we received a resume command
+	 *
+	 * \return true if we received a resume command
+	 */
+	bool isResume() const
+	{
+		return (m_receivedCommand == 'R');
+	}
+
+	/**
+	 * \brief Returns true if we received a time scale command
+	 *
+	 * \return true if we received a time scale command
+	 */
+	bool isTimeScale() const
+	{
+		return (m_receivedCommand == 'T');
+	}
+
+	/**
+	 * \brief Returns true if we received a servo limits command
+	 *
+	 * \return true if we received a servo limits command
+	 */
+	bool isServoLimits() const
+	{
+		return (m_receivedCommand == 'L');
+	}
+
+	/**
+	 * \brief Returns true if we received a face expression command
+	 *
+	 * \return true if we received a face expression command
+	 */
+	bool isFaceExpression() const
+	{
+		return (m_receivedCommand == 'X');
+	}
+
+	/**
+	 * \brief Returns true if we received a face text command
+	 *
+	 * \return true if we received a face text command
+	 */
+	bool isFaceText() const
+	{
+		return (m_receivedCommand == 'U');
+	}
+
+	/**
+	 * \brief Returns true if we received a ping command
+	 *
+	 * Answer with sendPong() as soon as possible, the PC uses it to measure
+	 * the round trip time
+	 * \return true if we received a ping command
+	 */
+	bool isPing() const
+	{
+		return (m_receivedCommand == 'G');
+	}
+
 	/**
 	 * \brief Returns the received command
 	 *
@@ -155,7 +264,8 @@ public:
 	/**
 	 * \brief Returns the received point dimension
 	 *
-	 * This is only valid after we received a start packet
+	 * This is only valid after we received a start packet. The bit telling
+	 * whether positions are 16 bits (widePositionsFlag) is not included
 	 * \return the received point dimension
 	 */
 	unsigned char pointDimension() const
@@ -163,6 +273,86 @@ public:
 		return m_receivedPointDim;
 	}
 
+	/**
+	 * \brief Returns the received time scale
+	 *
+	 * This is only valid after we received a time scale packet. The value
+	 * is a fixed point number with 8 fractional bits
+	 * \return the received time scale
+	 */
+	unsigned int timeScale() const
+	{
+		return m_receivedTimeScale;
+	}
+
+	/**
+	 * \brief Returns the servo of the received servo limits command
+	 *
+	 * This is only valid after we received a servo limits packet
+	 * \return the index of the servo
+	 */
+	unsigned char limitsServo() const
+	{
+		return m_receivedLimitsServo;
+	}
+
+	/**
+	 * \brief Returns the maximum speed of the received servo limits
+	 *        command
+	 *
+	 * This is only valid after we received a servo limits packet
+	 * \return the maximum speed in positions per second
+	 */
+	unsigned int maxSpeed() const
+	{
+		return m_receivedMaxSpeed;
+	}
+
+	/**
+	 * \brief Returns the maximum acceleration of the received servo limits
+	 *        command
+	 *
+	 * This is only valid after we received a servo limits packet
+	 * \return the maximum acceleration in positions per second squared
+	 */
+	unsigned int maxAcceleration() const
+	{
+		return m_receivedMaxAcceleration;
+	}
+
+	/**
+	 * \brief Returns the expression of the received face expression
+	 *        command
+	 *
+	 * This is only valid after we received a face expression packet
+	 * \return the expression (see FaceExpression)
+	 */
+	unsigned char faceExpression() const
+	{
+		return m_receivedFaceExpression;
+	}
+
+	/**
+	 * \brief Returns the text of the received face text command
+	 *
+	 * This is only valid after we received a face text packet. Characters
+	 * past TextScroller::maxTextLength are discarded
+	 * \return the text, terminated by '\0'
+	 */
+	const char* faceText() const
+	{
+		return m_receivedFaceText;
+	}
+
+	/**
+	 * \brief Sends a pong packet
+	 *
+	 * The packet carries the timestamp of the last ping command received,
+	 * unchanged, and the current value of millis(), so that the PC can
+	 * estimate the offset between its clock and ours
+	 */
+	void sendPong();
+
 	/**
 	 * \brief Sends a buffer not full package
 	 */
@@ -178,12 +368,24 @@ public:
 	 */
 	void sendSequenceFinished();
 
+#ifdef DEBUG_PACKETS
 	/**
 	 * \brief Sends a debug packet
 	 *
+	 * This is only available if DEBUG_PACKETS is defined
 	 * \param msg the message to send. This cannot be longer than 255 bytes
 	 */
 	void sendDebugPacket(const char* msg);
+#endif
+
+	/**
+	 * \brief Sends an event packet
+	 *
+	 * \param code the code of the event (see EventCode)
+	 * \param arg0 the first argument of the event
+	 * \param arg1 the second argument of the event
+	 */
+	void sendEvent(unsigned char code, unsigned char arg0 = 0, unsigned char arg1 = 0);
 
 	/**
 	 * \brief Sends a battery charge packet
@@ -193,6 +395,55 @@ public:
 	 */
 	void sendBatteryCharge(unsigned char v);
 
+	/**
+	 * \brief Sends a saturation counts packet
+	 *
+	 * \param counts the saturation count of each servo (SequencePoint::dim
+	 *               elements)
+	 */
+	void sendSaturationCounts(const unsigned int* counts);
+
+	/**
+	 * \brief Sends a point dimension packet
+	 *
+	 * The dimension is SequencePoint::dim
+	 */
+	void sendPointDimension();
+
+	/**
+	 * \brief Sends a bus statistics packet
+	 *
+	 * \param maxQueued the maximum number of bytes queued for the I²C bus
+	 *                  since the previous packet
+	 * \param completed the number of transactions completed
+	 * \param failed the number of transactions failed
+	 * \param stalls how many times the queue was full
+	 */
+	void sendBusStatistics(unsigned char maxQueued, unsigned int completed, unsigned int failed, unsigned int stalls);
+
+	/**
+	 * \brief Sends a bus test packet
+	 *
+	 * \param frequency the frequency of the bus in kHz
+	 * \param transactionsPerSecond the measured transactions per second, 0
+	 *                              if the test failed. Values larger than
+	 *                              65535 are sent as 65535
+	 */
+	void sendBusTestResult(unsigned int frequency, unsigned long transactionsPerSecond);
+
+	/**
+	 * \brief Sends an underrun packet
+	 *
+	 * \param count the number of underruns since startup, including this
+	 *              one
+	 * \param point the index of the point the robot waited for, counting
+	 *              the points received since the stream started
+	 * \param startTime the value of millis() when the buffer ran empty
+	 * \param duration how long the buffer was empty in milliseconds.
+	 *                 Values larger than 65535 are sent as 65535
+	 */
+	void sendUnderrun(unsigned int count, unsigned int point, unsigned long startTime, unsigned long duration);
+
 private:
 	/**
 	 * \brief Returns true if the previous command we received is complete
@@ -201,6 +452,27 @@ private:
 	 */
 	bool previousCommandComplete() const;
 
+	/**
+	 * \brief Stores a byte of the part of sequence points common to all
+	 *        packet types (duration, time to target, options and start
+	 *        time)
+	 *
+	 * m_receivedPacketBytes must be the index of the byte (from 1 to
+	 * m_receivedHeaderLength)
+	 * \param v the byte to store
+	 */
+	void receivePointHeader(unsigned char v);
+
+	/**
+	 * \brief Stores a byte of a position of the point being received
+	 *
+	 * \param channel the channel of the position
+	 * \param byteIndex the index of the byte in the position (0 for the
+	 *                  most significant one)
+	 * \param v the byte to store
+	 */
+	void receivePositionByte(unsigned char channel, unsigned char byteIndex, unsigned char v);
+
 	/**
 	 * \brief The pointer to the next SequencePoint object to fill
 	 */
@@ -223,11 +495,91 @@ private:
 	 */
 	unsigned char m_receivedPacketBytes;
 
+	/**
+	 * \brief The length of the sequence point being received
+	 *
+	 * This is the number of bytes after the command type and depends on
+	 * whether the point has a channel mask or not
+	 */
+	unsigned char m_receivedPointLength;
+
+	/**
+	 * \brief The length of the part of the sequence point being received
+	 *        common to all packet types
+	 *
+	 * This is 5 bytes, 9 for points with a start time. It is only valid
+	 * after the options byte has been received
+	 */
+	unsigned char m_receivedHeaderLength;
+
+	/**
+	 * \brief The bitmap of channels with a value in the masked sequence
+	 *        point being received
+	 */
+	unsigned char m_receivedValuesMask[SequencePoint::channelsBytes];
+
+	/**
+	 * \brief The channel from which to look for the next value of the
+	 *        masked sequence point being received
+	 */
+	unsigned char m_nextMaskedChannel;
+
+	/**
+	 * \brief The number of bytes of each position in sequence points
+	 *
+	 * This is set by start packets and is either 1 or 2
+	 */
+	unsigned char m_positionBytes;
+
 	/**
 	 * \brief The received point dimension
 	 */
 	unsigned char m_receivedPointDim;
 
+	/**
+	 * \brief The received time scale
+	 */
+	unsigned int m_receivedTimeScale;
+
+	/**
+	 * \brief The servo of the received servo limits command
+	 */
+	unsigned char m_receivedLimitsServo;
+
+	/**
+	 * \brief The maximum speed of the received servo limits command
+	 */
+	unsigned int m_receivedMaxSpeed;
+
+	/**
+	 * \brief The maximum acceleration of the received servo limits command
+	 */
+	unsigned int m_receivedMaxAcceleration;
+
+	/**
+	 * \brief The expression of the received face expression command
+	 */
+	unsigned char m_receivedFaceExpression;
+
+	/**
+	 * \brief The length of the text of the face text command being
+	 *        received
+	 */
+	unsigned char m_receivedFaceTextLength;
+
+	/**
+	 * \brief The text of the received face text command
+	 */
+	char m_receivedFaceText[TextScroller::maxTextLength + 1];
+
+	/**
+	 * \brief The timestamp of the received ping command
+	 *
+	 * This is kept as received, the firmware doesn't need to know its
+	 * meaning
+	 */
+	unsigned char m_receivedPingTimestamp[4];
+
 	/**
 	 * \brief Copy constructor is disabled
 	 */
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "textscroller.h"
+#include "AdafruitGFX.h"
+#include <string.h>
+#include <avr/pgmspace.h>
+
+namespace {
+	// The columns of each character in the font, including the spacing
+	const unsigned char columnsPerChar = 6;
+}
+
+TextScroller::TextScroller()
+	: m_charIndex(0)
+	, m_charColumn(0)
+	, m_trailingColumns(0)
+	, m_ringStart(0)
+	, m_scrolling(false)
+{
+	m_text[0] = '\0';
+	memset(m_ring, 0, sizeof(m_ring));
+}
+
+void TextScroller::start(const char* text)
+{
+	strncpy(m_text, text, maxTextLength);
+	m_text[maxTextLength] = '\0';
+
+	restart();
+}
+
+void TextScroller::start_P(const char* text)
+{
+	strncpy_P(m_text, text, maxTextLength);
+	m_text[maxTextLength] = '\0';
+
+	restart();
+}
+
+void TextScroller::stop()
+{
+	m_scrolling = false;
+}
+
+bool TextScroller::nextColumn()
+{
+	if (!m_scrolling) {
+		return false;
+	}
+
+	// After the end of the text, blank columns push it out of the display
+	if (m_text[m_charIndex] == '\0') {
+		if (m_trailingColumns == 0) {
+			m_scrolling = false;
+
+			return false;
+		}
+
+		--m_trailingColumns;
+	}
+
+	// The new column replaces the leftmost one, which becomes the rightmost
+	m_ring[m_ringStart] = renderColumn();
+	m_ringStart = (m_ringStart + 1) & (numColumns - 1);
+
+	return true;
+}
+
+void TextScroller::columns(unsigned char c[numColumns]) const
+{
+	for (unsigned char i = 0; i < numColumns; ++i) {
+		c[i] = m_ring[(m_ringStart + i) & (numColumns - 1)];
+	}
+}
+
+void TextScroller::restart()
+{
+	m_charIndex = 0;
+	m_charColumn = 0;
+	m_trailingColumns = numColumns;
+	m_ringStart = 0;
+	memset(m_ring, 0, sizeof(m_ring));
+	m_scrolling = true;
+}
+
+unsigned char TextScroller::renderColumn()
+{
+	if (m_text[m_charIndex] == '\0') {
+		return 0;
+	}
+
+	const unsigned char c = Adafruit_GFX::fontColumn(m_text[m_charIndex], m_charColumn);
+
+	++m_charColumn;
+	if (m_charColumn == columnsPerChar) {
+		m_charColumn = 0;
+		++m_charIndex;
+	}
+
+	return c;
+}
@@ -0,0 +1,163 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TEXTSCROLLER_H
+#define TEXTSCROLLER_H
+
+/**
+ * \brief Scrolls a text on an 8 pixels wide display one column at a time
+ *
+ * The text enters from the right and scrolls until it has completely left
+ * the display. Each call to nextColumn() renders the next column of the text
+ * from the font of Adafruit_GFX (5 columns per character plus one of
+ * spacing) into a ring with the visible columns, so the work is the same at
+ * each step regardless of the length of the text. Use columns() to get the
+ * visible columns in the format of Adafruit_8x8matrix::drawColumns()
+ */
+class TextScroller
+{
+public:
+	/**
+	 * \brief The maximum length of the text, longer texts are truncated
+	 */
+	static const unsigned char maxTextLength = 24;
+
+	/**
+	 * \brief The number of visible columns
+	 *
+	 * This must be a power of 2
+	 */
+	static const unsigned char numColumns = 8;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	TextScroller();
+
+	/**
+	 * \brief Starts scrolling a text
+	 *
+	 * The text is copied, the display starts blank
+	 * \param text the text to scroll
+	 */
+	void start(const char* text);
+
+	/**
+	 * \brief Starts scrolling a text stored in program memory
+	 *
+	 * \param text the text to scroll (e.g. from PSTR())
+	 */
+	void start_P(const char* text);
+
+	/**
+	 * \brief Stops scrolling
+	 */
+	void stop();
+
+	/**
+	 * \brief Returns true if the text is scrolling
+	 *
+	 * \return true if the text has not left the display yet
+	 */
+	bool scrolling() const
+	{
+		return m_scrolling;
+	}
+
+	/**
+	 * \brief Scrolls the text by one column
+	 *
+	 * \return false if the text has left the display (scrolling() is then
+	 *         false and the columns should no longer be drawn)
+	 */
+	bool nextColumn();
+
+	/**
+	 * \brief Returns the visible columns
+	 *
+	 * \param c the array filled with the columns from the left. The least
+	 *          significant bit is the top pixel
+	 */
+	void columns(unsigned char c[numColumns]) const;
+
+private:
+	/**
+	 * \brief Resets the columns and starts scrolling the text in m_text
+	 */
+	void restart();
+
+	/**
+	 * \brief Returns the next column of the text and moves past it
+	 *
+	 * \return the next column, blank past the end of the text
+	 */
+	unsigned char renderColumn();
+
+	/**
+	 * \brief The text to scroll
+	 */
+	char m_text[maxTextLength + 1];
+
+	/**
+	 * \brief The index of the character being rendered
+	 */
+	unsigned char m_charIndex;
+
+	/**
+	 * \brief The next column to render of the current character (0 to 5)
+	 */
+	unsigned char m_charColumn;
+
+	/**
+	 * \brief The blank columns still to scroll after the end of the text
+	 */
+	unsigned char m_trailingColumns;
+
+	/**
+	 * \brief The visible columns
+	 *
+	 * The leftmost one is at m_ringStart
+	 */
+	unsigned char m_ring[numColumns];
+
+	/**
+	 * \brief The index of the leftmost column in m_ring
+	 */
+	unsigned char m_ringStart;
+
+	/**
+	 * \brief True if the text is scrolling
+	 */
+	bool m_scrolling;
+
+	/**
+	 * \brief Copy constructor is disabled
+	 */
+	TextScroller(const TextScroller&);
+
+	/**
+	 * \brief Copy operator is disabled
+	 */
+	TextScroller& operator=(const TextScroller&);
+};
+
+#endif
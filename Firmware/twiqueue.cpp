@@ -0,0 +1,327 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "twiqueue.h"
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+namespace {
+	// The mask to wrap indices of the buffer
+	const unsigned char indexMask = TwiQueue::bufferSize - 1;
+
+	// The value of TWCR to continue the transfer, without start or stop
+	const unsigned char twcrContinue = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+
+	// The bit of the length in transaction headers set if the transaction
+	// ends with a stop
+	const unsigned char stopFlag = 0x80;
+}
+
+TwiQueue twiQueue;
+
+ISR(TWI_vect)
+{
+	twiQueue.handleInterrupt();
+}
+
+TwiQueue::TwiQueue()
+	: m_head(0)
+	, m_tail(0)
+	, m_writePos(0)
+	, m_pendingLength(0)
+	, m_busy(false)
+	, m_reading(false)
+	, m_stopAfter(true)
+	, m_remaining(0)
+	, m_received(0)
+	, m_readIndex(0)
+	, m_maxQueued(0)
+	, m_completed(0)
+	, m_failed(0)
+	, m_stalls(0)
+	, m_initialized(false)
+{
+}
+
+void TwiQueue::begin()
+{
+	if (m_initialized) {
+		return;
+	}
+
+	// Activating the internal pull-ups, as the Wire library does
+	digitalWrite(SDA, HIGH);
+	digitalWrite(SCL, HIGH);
+
+	// Setting the bus frequency (prescaler 1) and enabling the interface and
+	// its interrupt
+	TWSR = 0;
+	setClock(defaultFrequency);
+	TWCR = _BV(TWEN) | _BV(TWIE);
+
+	m_initialized = true;
+}
+
+void TwiQueue::setClock(unsigned long frequency)
+{
+	// Changing the frequency in the middle of a transfer would corrupt it
+	flush();
+	while (TWCR & _BV(TWSTO)) {
+	}
+
+	// The frequency is F_CPU / (16 + 2 * TWBR) with prescaler 1
+	const unsigned long ratio = F_CPU / frequency;
+	TWBR = (ratio > 16) ? ((ratio - 16) / 2) : 0;
+}
+
+void TwiQueue::beginTransmission(unsigned char address)
+{
+	queueHeader((address << 1) | TW_WRITE);
+}
+
+size_t TwiQueue::write(unsigned char data)
+{
+	if (m_pendingLength >= maxTransactionLength) {
+		return 0;
+	}
+
+	push(data);
+	++m_pendingLength;
+
+	return 1;
+}
+
+unsigned char TwiQueue::endTransmission(bool sendStop)
+{
+	commit(m_pendingLength, sendStop);
+
+	return 0;
+}
+
+unsigned char TwiQueue::requestFrom(unsigned char address, unsigned char quantity)
+{
+	if (quantity > receiveBufferSize) {
+		quantity = receiveBufferSize;
+	}
+
+	// The receive buffer can only be reset when no read is in progress
+	flush();
+	m_received = 0;
+	m_readIndex = 0;
+
+	if (quantity == 0) {
+		return 0;
+	}
+
+	queueHeader((address << 1) | TW_READ);
+	commit(quantity, true);
+	flush();
+
+	return m_received;
+}
+
+int TwiQueue::read()
+{
+	if (m_readIndex >= m_received) {
+		return -1;
+	}
+
+	return m_receiveBuffer[m_readIndex++];
+}
+
+void TwiQueue::flush()
+{
+	while (m_busy) {
+	}
+}
+
+unsigned char TwiQueue::queued() const
+{
+	return (m_tail - m_head) & indexMask;
+}
+
+void TwiQueue::resetMaxQueued()
+{
+	m_maxQueued = 0;
+}
+
+unsigned int TwiQueue::completedTransactions() const
+{
+	// Counters are changed by the interrupt, reading them atomically
+	noInterrupts();
+	const unsigned int c = m_completed;
+	interrupts();
+
+	return c;
+}
+
+unsigned int TwiQueue::failedTransactions() const
+{
+	noInterrupts();
+	const unsigned int f = m_failed;
+	interrupts();
+
+	return f;
+}
+
+void TwiQueue::handleInterrupt()
+{
+	switch (TW_STATUS) {
+		case TW_START:
+		case TW_REP_START:
+			{
+				// Sending the address of the transaction at the head of the queue
+				const unsigned char addressByte = m_buffer[m_head];
+				const unsigned char length = m_buffer[(m_head + 1) & indexMask];
+				m_remaining = length & ~stopFlag;
+				m_stopAfter = ((length & stopFlag) != 0);
+				m_head = (m_head + 2) & indexMask;
+				m_reading = ((addressByte & TW_READ) != 0);
+
+				TWDR = addressByte;
+				TWCR = twcrContinue;
+			}
+			break;
+		case TW_MT_SLA_ACK:
+		case TW_MT_DATA_ACK:
+			if (m_remaining == 0) {
+				nextTransaction(false);
+			} else {
+				TWDR = m_buffer[m_head];
+				m_head = (m_head + 1) & indexMask;
+				--m_remaining;
+
+				TWCR = twcrContinue;
+			}
+			break;
+		case TW_MR_SLA_ACK:
+			requestNextByte();
+			break;
+		case TW_MR_DATA_ACK:
+			storeReceivedByte();
+			requestNextByte();
+			break;
+		case TW_MR_DATA_NACK:
+			// This was the last byte
+			storeReceivedByte();
+			nextTransaction(false);
+			break;
+		default:
+			// Missing acknowledge, lost arbitration or bus error
+			nextTransaction(true);
+			break;
+	}
+}
+
+void TwiQueue::storeReceivedByte()
+{
+	if (m_received < receiveBufferSize) {
+		m_receiveBuffer[m_received] = TWDR;
+		++m_received;
+	}
+	--m_remaining;
+}
+
+void TwiQueue::requestNextByte()
+{
+	// Only acknowledging the next byte if others follow, the last one is not
+	// acknowledged to end the transfer
+	TWCR = twcrContinue | ((m_remaining > 1) ? _BV(TWEA) : 0);
+}
+
+void TwiQueue::push(unsigned char v)
+{
+	const unsigned char nextWritePos = (m_writePos + 1) & indexMask;
+
+	if (nextWritePos == m_head) {
+		// The buffer is full, waiting for the interrupt to transfer some bytes
+		++m_stalls;
+		while (nextWritePos == m_head) {
+		}
+	}
+
+	m_buffer[m_writePos] = v;
+	m_writePos = nextWritePos;
+}
+
+void TwiQueue::queueHeader(unsigned char addressByte)
+{
+	// A transaction not ended with endTransmission() is discarded
+	m_writePos = m_tail;
+	m_pendingLength = 0;
+
+	push(addressByte);
+	// The length is written when the transaction is committed
+	push(0);
+}
+
+void TwiQueue::commit(unsigned char length, bool sendStop)
+{
+	const unsigned char headerPos = m_tail;
+
+	m_buffer[(headerPos + 1) & indexMask] = length | (sendStop ? stopFlag : 0);
+
+	noInterrupts();
+	m_tail = m_writePos;
+	if (!m_busy) {
+		// The bus is idle, waiting for the last stop to be sent and starting
+		m_busy = true;
+		while (TWCR & _BV(TWSTO)) {
+		}
+		TWCR = twcrContinue | _BV(TWSTA);
+	}
+	interrupts();
+
+	const unsigned char q = queued();
+	if (q > m_maxQueued) {
+		m_maxQueued = q;
+	}
+}
+
+void TwiQueue::nextTransaction(bool failed)
+{
+	if (failed) {
+		++m_failed;
+
+		// Skipping the bytes of the transaction that were not transferred
+		if (!m_reading) {
+			m_head = (m_head + m_remaining) & indexMask;
+		}
+	} else {
+		++m_completed;
+	}
+	m_remaining = 0;
+
+	if (m_head == m_tail) {
+		// Nothing else to transfer, releasing the bus
+		m_busy = false;
+		TWCR = twcrContinue | _BV(TWSTO);
+	} else if (failed || m_stopAfter) {
+		// Releasing the bus before starting again (to recover from errors or
+		// because the transaction requires it)
+		TWCR = twcrContinue | _BV(TWSTO) | _BV(TWSTA);
+	} else {
+		// Repeated start, the bus is kept for the next transaction
+		TWCR = twcrContinue | _BV(TWSTA);
+	}
+}
@@ -0,0 +1,362 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TWIQUEUE_H
+#define TWIQUEUE_H
+
+#include <stddef.h>
+
+/**
+ * \brief An interrupt driven I²C (TWI) master with a queue of transactions
+ *
+ * Transactions are stored in a circular buffer and transferred one after the
+ * other by the TWI interrupt, so functions writing to I²C devices return as
+ * soon as the transaction is queued instead of waiting for the whole transfer.
+ * The functions have the same interface as those of the Wire library, so
+ * drivers written for Wire only need to use the twiQueue object instead of
+ * Wire. The Wire library cannot be used together with this class, because
+ * both handle the TWI interrupt.
+ *
+ * A transaction is queued by calling beginTransmission(), then write() for
+ * each byte and finally endTransmission(), which starts the transfer if the
+ * bus is idle. If the buffer is full, write() waits for the interrupt to free
+ * some space (this is counted in stalls()). As with Wire, a transaction ends
+ * with a stop unless endTransmission(false) is used: in that case the next
+ * queued transaction begins with a repeated start (if the queue is empty the
+ * bus is released anyway). Reads (requestFrom()) wait until all queued
+ * transactions and the read itself are completed, so they should only be
+ * used during initialization
+ */
+class TwiQueue
+{
+public:
+	/**
+	 * \brief The size of the buffer of queued transactions in bytes
+	 *
+	 * This must be a power of 2 not greater than 128. Each transaction takes
+	 * two bytes more than the data it transfers
+	 */
+	static const unsigned int bufferSize = 128;
+
+	/**
+	 * \brief The maximum number of data bytes in a transaction
+	 *
+	 * Bytes past this are discarded by write(). With this length a
+	 * transaction always fits in the buffer once the previous ones have been
+	 * transferred
+	 */
+	static const unsigned char maxTransactionLength = bufferSize - 3;
+
+	/**
+	 * \brief The maximum number of bytes requestFrom() can read
+	 */
+	static const unsigned char receiveBufferSize = 4;
+
+	/**
+	 * \brief The frequency of the bus clock in Hz set by begin()
+	 */
+	static const unsigned long defaultFrequency = 100000;
+
+public:
+	/**
+	 * \brief Constructor
+	 */
+	TwiQueue();
+
+	/**
+	 * \brief Initializes the TWI hardware
+	 *
+	 * This can be called more than once (e.g. by all drivers using the bus),
+	 * only the first call has effect
+	 */
+	void begin();
+
+	/**
+	 * \brief Changes the frequency of the bus clock
+	 *
+	 * This waits for all queued transactions to be transferred before
+	 * changing the frequency. The maximum frequency is F_CPU / 16
+	 * \param frequency the new frequency in Hz
+	 */
+	void setClock(unsigned long frequency);
+
+	/**
+	 * \brief Starts queueing a write transaction
+	 *
+	 * \param address the 7 bit address of the device
+	 */
+	void beginTransmission(unsigned char address);
+
+	/**
+	 * \brief Adds a byte to the transaction being queued
+	 *
+	 * This waits if the buffer is full
+	 * \param data the byte to add
+	 * \return the number of bytes added (0 if the transaction is already
+	 *         maxTransactionLength bytes long)
+	 */
+	size_t write(unsigned char data);
+
+	/**
+	 * \brief Ends queueing a write transaction
+	 *
+	 * The transaction is only queued, this does not wait for it to be
+	 * transferred. Errors are only counted in failedTransactions()
+	 * \param sendStop if true the transaction ends with a stop, otherwise
+	 *                 the next one starts with a repeated start
+	 * \return always 0 (success)
+	 */
+	unsigned char endTransmission(bool sendStop = true);
+
+	/**
+	 * \brief Reads bytes from a device
+	 *
+	 * This waits for all queued transactions to be transferred, then reads.
+	 * Use read() to get the bytes
+	 * \param address the 7 bit address of the device
+	 * \param quantity the number of bytes to read (at most
+	 *                 receiveBufferSize)
+	 * \return the number of bytes read
+	 */
+	unsigned char requestFrom(unsigned char address, unsigned char quantity);
+
+	/**
+	 * \brief Returns the next byte read by requestFrom()
+	 *
+	 * \return the next byte or -1 if all bytes have been returned
+	 */
+	int read();
+
+	/**
+	 * \brief Waits until all queued transactions have been transferred
+	 */
+	void flush();
+
+	/**
+	 * \brief Returns the number of bytes currently queued
+	 *
+	 * \return the number of bytes currently queued
+	 */
+	unsigned char queued() const;
+
+	/**
+	 * \brief Returns the maximum number of bytes that were queued since the
+	 *        last call to resetMaxQueued()
+	 *
+	 * \return the maximum number of bytes that were queued
+	 */
+	unsigned char maxQueued() const
+	{
+		return m_maxQueued;
+	}
+
+	/**
+	 * \brief Resets the maximum number of bytes that were queued
+	 */
+	void resetMaxQueued();
+
+	/**
+	 * \brief Returns the number of transactions successfully transferred
+	 *
+	 * This wraps around when it overflows
+	 * \return the number of transactions successfully transferred
+	 */
+	unsigned int completedTransactions() const;
+
+	/**
+	 * \brief Returns the number of transactions that failed
+	 *
+	 * A transaction fails if the device does not acknowledge a byte or for a
+	 * bus error. This wraps around when it overflows
+	 * \return the number of transactions that failed
+	 */
+	unsigned int failedTransactions() const;
+
+	/**
+	 * \brief Returns how many times write() had to wait because the buffer
+	 *        was full
+	 *
+	 * This wraps around when it overflows
+	 * \return how many times write() had to wait
+	 */
+	unsigned int stalls() const
+	{
+		return m_stalls;
+	}
+
+	/**
+	 * \brief Handles the TWI interrupt
+	 *
+	 * This is called by the interrupt service routine, never call it directly
+	 */
+	void handleInterrupt();
+
+private:
+	/**
+	 * \brief Adds a byte at the end of the buffer, waiting for space if
+	 *        needed
+	 *
+	 * \param v the byte to add
+	 */
+	void push(unsigned char v);
+
+	/**
+	 * \brief Adds the header of a transaction to the buffer
+	 *
+	 * \param addressByte the first byte of the transaction on the bus (the
+	 *                    address and the read/write bit)
+	 */
+	void queueHeader(unsigned char addressByte);
+
+	/**
+	 * \brief Makes the transaction being queued visible to the interrupt
+	 *        and starts the transfer if the bus is idle
+	 *
+	 * \param length the length to store in the header of the transaction
+	 * \param sendStop if true the transaction ends with a stop
+	 */
+	void commit(unsigned char length, bool sendStop);
+
+	/**
+	 * \brief Stores the byte just received by a read transaction
+	 *
+	 * This is only called by handleInterrupt()
+	 */
+	void storeReceivedByte();
+
+	/**
+	 * \brief Receives the next byte of a read transaction
+	 *
+	 * This is only called by handleInterrupt()
+	 */
+	void requestNextByte();
+
+	/**
+	 * \brief Ends the current transaction on the bus and starts the next
+	 *        one, if any
+	 *
+	 * This is only called by handleInterrupt()
+	 * \param failed true if the current transaction failed. In this case
+	 *               the remaining bytes of the transaction are skipped and the
+	 *               bus is released with a stop
+	 */
+	void nextTransaction(bool failed);
+
+	/**
+	 * \brief The circular buffer of queued transactions
+	 *
+	 * Each transaction has the address byte, the length and then the data
+	 * (no data for reads, the length is the number of bytes to read). The
+	 * highest bit of the length is set if the transaction ends with a stop
+	 */
+	unsigned char m_buffer[bufferSize];
+
+	/**
+	 * \brief The index of the next byte the interrupt will transfer
+	 */
+	volatile unsigned char m_head;
+
+	/**
+	 * \brief The index past the last byte of the transactions the interrupt
+	 *        can transfer
+	 */
+	volatile unsigned char m_tail;
+
+	/**
+	 * \brief The index where the next byte of the transaction being queued
+	 *        is written
+	 */
+	unsigned char m_writePos;
+
+	/**
+	 * \brief The number of data bytes of the transaction being queued
+	 */
+	unsigned char m_pendingLength;
+
+	/**
+	 * \brief True if the interrupt is transferring transactions
+	 */
+	volatile bool m_busy;
+
+	/**
+	 * \brief True if the transaction on the bus is a read
+	 */
+	volatile bool m_reading;
+
+	/**
+	 * \brief True if the transaction on the bus ends with a stop
+	 */
+	volatile bool m_stopAfter;
+
+	/**
+	 * \brief The bytes of the current transaction still to be transferred
+	 */
+	volatile unsigned char m_remaining;
+
+	/**
+	 * \brief The bytes read by the last read transaction
+	 */
+	volatile unsigned char m_receiveBuffer[receiveBufferSize];
+
+	/**
+	 * \brief The number of bytes in m_receiveBuffer
+	 */
+	volatile unsigned char m_received;
+
+	/**
+	 * \brief The index of the next byte read() returns
+	 */
+	unsigned char m_readIndex;
+
+	/**
+	 * \brief The maximum number of bytes queued since the last reset
+	 */
+	unsigned char m_maxQueued;
+
+	/**
+	 * \brief The number of transactions successfully transferred
+	 */
+	volatile unsigned int m_completed;
+
+	/**
+	 * \brief The number of failed transactions
+	 */
+	volatile unsigned int m_failed;
+
+	/**
+	 * \brief How many times write() had to wait for space
+	 */
+	unsigned int m_stalls;
+
+	/**
+	 * \brief True if begin() has already been called
+	 */
+	bool m_initialized;
+};
+
+/**
+ * \brief The object driving the TWI hardware
+ *
+ * There is only one TWI interface, so this is the only instance of TwiQueue
+ */
+extern TwiQueue twiQueue;
+
+#endif
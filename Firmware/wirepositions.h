@@ -0,0 +1,70 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef WIREPOSITIONS_H
+#define WIREPOSITIONS_H
+
+/**
+ * \file wirepositions.h
+ *
+ * The conversion of the coordinates of sequence points to the values sent to
+ * the firmware and to the positions the firmware has. The firmware only
+ * receives the converted values, these functions are here so that the GUI
+ * and the tests of the PC program compute positions in the same way (see
+ * also interpolation.h)
+ */
+
+/**
+ * \brief Returns the value of a coordinate as sent to the hardware
+ *
+ * With 16 bits the value is rounded to 8 fractional bits, with 8 bits it is
+ * truncated. Coordinates must be between 0 and 255
+ * \param v the value of the coordinate
+ * \param highResolution if true the value is for 16 bit positions
+ * \return the value sent to the hardware
+ */
+inline unsigned int wireValue(double v, bool highResolution)
+{
+	if (highResolution) {
+		const double w = v * 256.0 + 0.5;
+
+		return static_cast<unsigned int>((w < 0.0) ? 0.0 : ((w > (255.0 * 256.0)) ? (255.0 * 256.0) : w));
+	} else {
+		return static_cast<unsigned int>(v) & 0xFF;
+	}
+}
+
+/**
+ * \brief Returns the position the hardware has for a coordinate
+ *
+ * The hardware keeps positions with 8 fractional bits regardless of how many
+ * bits are sent
+ * \param v the value of the coordinate
+ * \param highResolution if true the value is sent with 16 bits
+ * \return the position of the hardware
+ */
+inline unsigned int hardwarePosition(double v, bool highResolution)
+{
+	return highResolution ? wireValue(v, true) : (wireValue(v, false) << 8);
+}
+
+#endif
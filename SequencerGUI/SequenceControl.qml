@@ -58,6 +58,27 @@ Item {
 			onClicked: serialCommunication.startStream(sequence, true);
 		}
 
+		RowLayout {
+			Layout.fillWidth: true
+
+			Button {
+				text: "Play sequence from time"
+				enabled: serialCommunication.isConnected && (!serialCommunication.isStreaming) && (sequence.numPoints > 0)
+
+				Layout.fillWidth: true
+
+				onClicked: serialCommunication.startStreamAt(sequence, startTime.value);
+			}
+
+			SpinBox {
+				id: startTime
+				minimumValue: 0
+				maximumValue: Math.max(0, sequence.totalTime - 1)
+				stepSize: 100
+				suffix: " ms"
+			}
+		}
+
 		Button {
 			text: serialCommunication.isPaused ? "Resume" : "Pause"
 			enabled: serialCommunication.isStreamMode
@@ -82,6 +103,100 @@ Item {
 			onClicked: serialCommunication.stop()
 		}
 
+		RowLayout {
+			Layout.fillWidth: true
+
+			Text {
+				text: "Playback speed"
+
+				Layout.fillWidth: true
+			}
+
+			SpinBox {
+				minimumValue: 0.1
+				maximumValue: 10.0
+				decimals: 2
+				stepSize: 0.1
+				value: serialCommunication.playbackSpeed
+				suffix: "x"
+
+				onValueChanged: serialCommunication.playbackSpeed = value
+			}
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+
+			Button {
+				text: "Set servo limits"
+				enabled: serialCommunication.isConnected
+
+				Layout.fillWidth: true
+
+				onClicked: serialCommunication.setServoLimits(limitServo.value, limitSpeed.value, limitAcceleration.value)
+			}
+
+			SpinBox {
+				id: limitServo
+				minimumValue: 0
+				maximumValue: Math.max(0, sequence.pointDim - 1)
+				prefix: "servo "
+			}
+
+			SpinBox {
+				id: limitSpeed
+				minimumValue: 0
+				maximumValue: 65535
+				stepSize: 10
+				suffix: " pos/s"
+			}
+
+			SpinBox {
+				id: limitAcceleration
+				minimumValue: 0
+				maximumValue: 65535
+				stepSize: 100
+				suffix: " pos/s²"
+			}
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+
+			Button {
+				text: "Set face expression"
+				enabled: serialCommunication.isConnected
+
+				Layout.fillWidth: true
+
+				onClicked: serialCommunication.setFaceExpression(faceExpression.currentIndex)
+			}
+
+			ComboBox {
+				id: faceExpression
+				model: ["Smile", "Blink", "Talk", "Sad", "Surprised", "Sleep"]
+			}
+		}
+
+		RowLayout {
+			Layout.fillWidth: true
+
+			Button {
+				text: "Show text on face"
+				enabled: serialCommunication.isConnected
+
+				onClicked: serialCommunication.showFaceText(faceText.text)
+			}
+
+			TextField {
+				id: faceText
+				maximumLength: 24
+				placeholderText: "Text"
+
+				Layout.fillWidth: true
+			}
+		}
+
 		CheckBox {
 			text: "Immediate mode"
 			enabled: serialCommunication.isConnected && (!serialCommunication.isStreamMode)
@@ -97,6 +212,41 @@ Item {
 			}
 		}
 
+		Button {
+			text: motionRecorder.isRecording ? ("Stop recording (" + motionRecorder.numPoses + " poses)") : "Record motion"
+			enabled: serialCommunication.isImmediateMode || motionRecorder.isRecording
+
+			Layout.fillWidth: true
+
+			onClicked: {
+				if (motionRecorder.isRecording) {
+					motionRecorder.stop(sequence);
+				} else {
+					motionRecorder.start();
+				}
+			}
+		}
+
+		CheckBox {
+			text: "High resolution positions"
+			enabled: !serialCommunication.isStreaming
+			checked: serialCommunication.highResolution
+
+			Layout.fillWidth: true
+
+			onCheckedChanged: serialCommunication.highResolution = checked
+		}
+
+		CheckBox {
+			text: "Scheduled stream"
+			enabled: !serialCommunication.isStreaming
+			checked: serialCommunication.scheduledStream
+
+			Layout.fillWidth: true
+
+			onCheckedChanged: serialCommunication.scheduledStream = checked
+		}
+
 		CheckBox {
 			text: "Continuous stream"
 			enabled: serialCommunication.isConnected && (!serialCommunication.isImmediateMode)
@@ -152,11 +302,93 @@ Item {
 			}
 		}
 
+		Text {
+			text: "No event from the robot"
+
+			Layout.fillWidth: true
+
+			Component.onCompleted: {
+				serialCommunication.hardwareEvent.connect(writeEvent)
+			}
+
+			function writeEvent(code, message)
+			{
+				text = "Last event: " + message
+			}
+		}
+
 		Text {
 			text: "Battery charge: " + ((serialCommunication.batteryCharge < 0) ? "unknown" : (serialCommunication.batteryCharge.toFixed(1) + "%"))
 
 			Layout.fillWidth: true
 		}
+
+		Text {
+			text: "Saturation counts: " + ((serialCommunication.saturationCounts.length == 0) ? "unknown" : serialCommunication.saturationCounts.join(" "))
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			property var stats: serialCommunication.busStatistics
+
+			text: "I²C queue: " + ((stats.completed === undefined) ? "unknown" : ("max " + stats.maxQueued + " bytes, " + stats.completed + " completed, " + stats.failed + " failed, " + stats.stalls + " stalls"))
+
+			Layout.fillWidth: true
+		}
+
+		Text {
+			text: "I²C bus test: " + ((serialCommunication.busTestResults.length == 0) ? "unknown" : serialCommunication.busTestResults.map(resultString).join(", "))
+
+			Layout.fillWidth: true
+
+			function resultString(result)
+			{
+				return result.frequency + " kHz " + ((result.transactionsPerSecond == 0) ? "failed" : (result.transactionsPerSecond + " transactions/s"))
+			}
+		}
+
+		GroupBox {
+			title: "Link diagnostics"
+
+			Layout.fillWidth: true
+
+			ColumnLayout {
+				property var stats: serialCommunication.linkStatistics
+
+				anchors.fill: parent
+
+				Text {
+					text: "Round trip time: " + ((parent.stats.rttMedian === undefined) ? "unknown" : ("median " + parent.stats.rttMedian.toFixed(1) + " ms, 95% " + parent.stats.rttP95.toFixed(1) + " ms, 99% " + parent.stats.rttP99.toFixed(1) + " ms (" + parent.stats.rttMin.toFixed(1) + " - " + parent.stats.rttMax.toFixed(1) + " ms)"))
+
+					Layout.fillWidth: true
+				}
+
+				Text {
+					text: "Received: " + ((parent.stats.receivedPacketsPerSecond === undefined) ? "unknown" : (parent.stats.receivedPacketsPerSecond.toFixed(0) + " packets/s, " + parent.stats.receivedBytesPerSecond.toFixed(0) + " bytes/s"))
+
+					Layout.fillWidth: true
+				}
+
+				Text {
+					text: "Sent: " + ((parent.stats.sentPacketsPerSecond === undefined) ? "unknown" : (parent.stats.sentPacketsPerSecond.toFixed(0) + " packets/s, " + parent.stats.sentBytesPerSecond.toFixed(0) + " bytes/s"))
+
+					Layout.fillWidth: true
+				}
+
+				Text {
+					text: "Clock: " + (parent.stats.clockSynchronized ? ("skew " + parent.stats.clockSkewPpm.toFixed(0) + " ppm, error " + parent.stats.clockError.toFixed(1) + " ms") : "unknown")
+
+					Layout.fillWidth: true
+				}
+
+				Text {
+					text: "Errors: " + ((parent.stats.lostPings === undefined) ? "unknown" : (parent.stats.lostPings + " lost pings, " + parent.stats.parseErrors + " parse errors, " + parent.stats.underruns + " buffer underruns"))
+
+					Layout.fillWidth: true
+				}
+			}
+		}
 	}
 }
 
@@ -0,0 +1,130 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// Qt 5.4
+//import QtQuick 2.4
+//import QtQuick.Controls 1.3
+//import QtQuick.Layouts 1.1
+
+// Qt 5.2
+import QtQuick 2.0
+import QtQuick.Controls 1.1
+import QtQuick.Layouts 1.1
+
+// A horizontal timeline with one block per step. The sequence is used directly
+// as the model of the list, so only visible steps are instantiated
+Item {
+	id: mainItem
+	implicitHeight: 60
+	implicitWidth: 200
+
+	// How many pixels per millisecond of sequence
+	property real pixelsPerMs: 0.05
+
+	// The minimum width of a step, so that very short steps can still be
+	// clicked
+	property real minStepWidth: 10
+
+	// Returns how many of the underruns were waiting for the step at index
+	function underrunsAt(index, underruns)
+	{
+		var n = 0
+		for (var i = 0; i < underruns.length; ++i) {
+			if (underruns[i].point == index) {
+				++n
+			}
+		}
+
+		return n
+	}
+
+	ListView {
+		id: timeline
+		anchors.fill: parent
+		anchors.margins: 5
+
+		orientation: ListView.Horizontal
+		clip: true
+		model: sequence
+		currentIndex: sequence.curPoint
+
+		delegate: Item {
+			// Partial steps do not wait for the target to be reached
+			width: Math.max(mainItem.minStepWidth, (model.partial ? model.duration : (model.timeToTarget + model.duration)) * mainItem.pixelsPerMs)
+			height: timeline.height
+
+			// The part of the step spent reaching the target...
+			Rectangle {
+				id: timeToTargetRect
+				anchors.left: parent.left
+				anchors.top: parent.top
+				anchors.bottom: parent.bottom
+				width: model.partial ? 0 : (parent.width * model.timeToTarget / Math.max(1, model.timeToTarget + model.duration))
+
+				color: "lightsteelblue"
+			}
+
+			// ... and the part spent keeping the position
+			Rectangle {
+				anchors.left: timeToTargetRect.right
+				anchors.right: parent.right
+				anchors.top: parent.top
+				anchors.bottom: parent.bottom
+
+				color: "steelblue"
+			}
+
+			Rectangle {
+				anchors.fill: parent
+
+				color: "transparent"
+				border.color: (index == sequence.curPoint) ? "red" : "white"
+				border.width: (index == sequence.curPoint) ? 2 : 1
+			}
+
+			Text {
+				anchors.centerIn: parent
+				text: index
+				visible: parent.width > width
+			}
+
+			// A mark at the beginning of steps the robot had to wait for
+			// because of a buffer underrun in the last stream
+			Rectangle {
+				property int numUnderruns: mainItem.underrunsAt(index, serialCommunication.underruns)
+
+				anchors.left: parent.left
+				anchors.top: parent.top
+				anchors.bottom: parent.bottom
+				width: 4
+				visible: numUnderruns > 0
+
+				color: "orange"
+			}
+
+			MouseArea {
+				anchors.fill: parent
+
+				onClicked: sequence.setCurPoint(index)
+			}
+		}
+	}
+}
@@ -6,11 +6,19 @@ QT += qml quick widgets serialport
 # QMAKE_CXXFLAGS += -std=c++14 -Wall -Wextra
 QMAKE_CXXFLAGS += -std=c++11 -Wall -Wextra
 
+# Some headers are shared with the firmware
+INCLUDEPATH += ../Firmware
+
 SOURCES += main.cpp \
+    clocksync.cpp \
+    motionrecorder.cpp \
+    robotgroup.cpp \
     sequencer.cpp \
     sequence.cpp \
     sequencepoint.cpp \
-    serialcommunication.cpp
+    serialcommunication.cpp \
+    timeindex.cpp \
+    trajectory.cpp
 
 RESOURCES += qml.qrc
 
@@ -21,8 +29,13 @@ QML_IMPORT_PATH =
 include(deployment.pri)
 
 HEADERS += \
+    clocksync.h \
+    motionrecorder.h \
+    robotgroup.h \
     sequencer.h \
     sequence.h \
     sequencepoint.h \
     utils.h \
-    serialcommunication.h
+    serialcommunication.h \
+    timeindex.h \
+    trajectory.h
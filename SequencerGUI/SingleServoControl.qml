@@ -34,7 +34,13 @@ Item {
 	id: mainItem
 
 	// Only enabled if there is a valid point
-	enabled: (sequence.curPoint >= 0)
+	enabled: (sequence.curPoint >= 0) && validServo
+
+	// Hidden if the robot has no such servo (the picture always has 16)
+	visible: validServo
+
+	// True if the servo exists in the sequence
+	readonly property bool validServo: (servoID >= 0) && (servoID < sequence.pointDim)
 
 	// The id of the servo controlled by this item. You MUST set this to a
 	// valid value (greater or equal to 0)
@@ -59,8 +65,8 @@ Item {
 		anchors.fill: parent
 
 		// Rows and columns depend on the orientatation
-		rows: (mainItem.orientation == Qt.Horizontal) ? 1 : 2
-		columns:  (mainItem.orientation == Qt.Horizontal) ? 2 : 1
+		rows: (mainItem.orientation == Qt.Horizontal) ? 1 : 3
+		columns:  (mainItem.orientation == Qt.Horizontal) ? 3 : 1
 
 		Slider {
 			id: slider
@@ -97,6 +103,20 @@ Item {
 				}
 			}
 		}
+
+		// Whether the current point updates this servo. Only shown for
+		// partial points, the others update all servos
+		CheckBox {
+			id: updatedCheckBox
+			text: "Updated"
+			visible: false
+
+			onClicked: {
+				if ((mainItem.servoID >= 0) && (mainItem.servoID < sequence.pointDim)) {
+					sequence.setChannelUpdated(servoID, checked)
+				}
+			}
+		}
 	}
 
 	Component.onCompleted: {
@@ -149,6 +169,10 @@ Item {
 		// Finally setting value. We only set the value of the slider,
 		// this will automatically change the value of the text field
 		slider.value = value;
+
+		// Also reading whether the point updates this servo
+		updatedCheckBox.visible = sequence.pointIsPartial();
+		updatedCheckBox.checked = sequence.pointUpdatesChannel(mainItem.servoID);
 	}
 }
 
@@ -158,6 +158,72 @@ Item {
 			}
 		}
 
+		RowLayout {
+			enabled: mainItem.stepsPresent
+
+			Text {
+				text: "Movement profile:"
+			}
+
+			ComboBox {
+				id: profileComboBox
+
+				Layout.fillWidth: true
+
+				// The order must be the same as in InterpolationProfile
+				model: ["Linear", "Cubic", "Minimum jerk", "Trapezoidal"]
+
+				onActivated: sequence.setProfile(index)
+
+				Component.onCompleted: {
+					// Getting value from sequence
+					readValue();
+
+					// Connecting the signal emitted on sequence change, cur point
+					// change and cur point values change to the function to
+					// re-read value for the sequence
+					onSequenceChanged.connect(readValue);
+					sequence.onCurPointChanged.connect(readValue);
+					sequence.onCurPointValuesChanged.connect(readValue)
+				}
+
+				// Sets the value to the one for the current point
+				function readValue()
+				{
+					profileComboBox.currentIndex = sequence.pointProfile();
+				}
+			}
+		}
+
+		CheckBox {
+			id: partialCheckBox
+			enabled: mainItem.stepsPresent
+
+			text: "Partial step (only updates some servos, next step starts after its duration)"
+
+			Layout.fillWidth: true
+
+			onClicked: sequence.setPartial(checked)
+
+			Component.onCompleted: {
+				// Getting value from sequence
+				readValue();
+
+				// Connecting the signal emitted on sequence change, cur point
+				// change and cur point values change to the function to
+				// re-read value for the sequence
+				onSequenceChanged.connect(readValue);
+				sequence.onCurPointChanged.connect(readValue);
+				sequence.onCurPointValuesChanged.connect(readValue)
+			}
+
+			// Sets the value to the one for the current point
+			function readValue()
+			{
+				partialCheckBox.checked = sequence.pointIsPartial();
+			}
+		}
+
 		Button {
 			text: "Insert step after current"
 
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "clocksync.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	/**
+	 * \brief Samples whose round trip time is longer than the minimum by
+	 *        more than this factor (plus slack) are not used
+	 */
+	const double maxRoundTripTimeFactor = 2.0;
+
+	/**
+	 * \brief The slack on the round trip time in milliseconds, so that
+	 *        very fast links do not discard almost all samples
+	 */
+	const double roundTripTimeSlack = 1.0;
+}
+
+ClockSync::ClockSync()
+	: m_samples()
+	, m_lastHardwareTime(0)
+	, m_offset(0.0)
+	, m_skew(1.0)
+	, m_referenceTime(0.0)
+	, m_maxError(0.0)
+{
+}
+
+void ClockSync::clear()
+{
+	m_samples.clear();
+	m_lastHardwareTime = 0;
+	m_offset = 0.0;
+	m_skew = 1.0;
+	m_referenceTime = 0.0;
+	m_maxError = 0.0;
+}
+
+void ClockSync::addSample(double sendTime, double receiveTime, quint32 hardwareTime)
+{
+	Sample s;
+	s.hostTime = (sendTime + receiveTime) / 2.0;
+	s.roundTripTime = receiveTime - sendTime;
+
+	// The difference with the previous value is correct even if the clock of
+	// the hardware wrapped around
+	if (m_samples.isEmpty()) {
+		s.hardwareTime = hardwareTime;
+	} else {
+		s.hardwareTime = m_samples.last().hardwareTime + static_cast<qint32>(hardwareTime - m_lastHardwareTime);
+	}
+	m_lastHardwareTime = hardwareTime;
+
+	m_samples.append(s);
+	if (m_samples.size() > maxSamples) {
+		m_samples.removeFirst();
+	}
+
+	estimate();
+}
+
+quint32 ClockSync::hardwareTime(double hostTime) const
+{
+	const double t = m_offset + m_skew * (hostTime - m_referenceTime);
+
+	// Going through a 64 bits integer so that the value wraps around as the
+	// clock of the hardware does
+	return static_cast<quint32>(static_cast<qint64>(std::floor(t + 0.5)));
+}
+
+void ClockSync::estimate()
+{
+	double minRoundTripTime = m_samples.first().roundTripTime;
+	for (const Sample& s: m_samples) {
+		minRoundTripTime = std::min(minRoundTripTime, s.roundTripTime);
+	}
+	const double maxRoundTripTime = minRoundTripTime * maxRoundTripTimeFactor + roundTripTimeSlack;
+
+	// Least squares with coordinates relative to the last sample, to keep
+	// numbers small. The sample with the minimum round trip time is always
+	// used, so there is at least one
+	m_referenceTime = m_samples.last().hostTime;
+	const double hardwareReference = m_samples.last().hardwareTime;
+	int n = 0;
+	double sumX = 0.0;
+	double sumY = 0.0;
+	double sumXX = 0.0;
+	double sumXY = 0.0;
+	double minX = 0.0;
+	for (const Sample& s: m_samples) {
+		if (s.roundTripTime > maxRoundTripTime) {
+			continue;
+		}
+
+		const double x = s.hostTime - m_referenceTime;
+		const double y = s.hardwareTime - hardwareReference;
+		++n;
+		sumX += x;
+		sumY += y;
+		sumXX += x * x;
+		sumXY += x * y;
+		minX = std::min(minX, x);
+	}
+
+	if (-minX < minSkewSpan) {
+		// Too short to estimate the skew, only the offset
+		m_skew = 1.0;
+		m_offset = hardwareReference + (sumY - sumX) / n;
+	} else {
+		m_skew = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+		m_offset = hardwareReference + (sumY - m_skew * sumX) / n;
+	}
+
+	m_maxError = 0.0;
+	for (const Sample& s: m_samples) {
+		if (s.roundTripTime > maxRoundTripTime) {
+			continue;
+		}
+
+		const double predicted = m_offset + m_skew * (s.hostTime - m_referenceTime);
+		m_maxError = std::max(m_maxError, std::abs(predicted - s.hardwareTime) + s.roundTripTime / 2.0);
+	}
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QList>
+#include <QtGlobal>
+
+/**
+ * \brief Estimates the clock of the hardware from ping/pong exchanges
+ *
+ * Each sample is a ping sent at host time t1, answered by the hardware with
+ * its clock h and received at host time t4. As in NTP, h is assumed to have
+ * been read at (t1 + t4) / 2, so the error of a sample is at most half the
+ * round trip time. The clock of the hardware (millis() on the Arduino) is
+ * driven by a resonator that can be off by some thousandths, so a line
+ * h = offset + skew * t is fitted with least squares on the last samples,
+ * discarding those with a round trip time much longer than the minimum (they
+ * waited in some buffer). The skew is only estimated when samples span long
+ * enough, otherwise it is taken as 1. Host times are in milliseconds of any
+ * monotonic clock, the same for all samples
+ */
+class ClockSync
+{
+public:
+	/**
+	 * \brief The number of samples used for the estimate
+	 */
+	static const int maxSamples = 60;
+
+	/**
+	 * \brief The number of samples needed before the estimate is used
+	 */
+	static const int minSamples = 3;
+
+	/**
+	 * \brief The minimum time spanned by samples to estimate the skew in
+	 *        milliseconds
+	 */
+	static const int minSkewSpan = 10000;
+
+public:
+	/**
+	 * \brief Constructor. Builds an object without samples
+	 */
+	ClockSync();
+
+	/**
+	 * \brief Removes all samples
+	 *
+	 * Call this when the hardware restarts
+	 */
+	void clear();
+
+	/**
+	 * \brief Adds a sample and updates the estimate
+	 *
+	 * \param sendTime the host time at which the ping was sent
+	 * \param receiveTime the host time at which the pong was received
+	 * \param hardwareTime the clock of the hardware in the pong (it wraps
+	 *                     around)
+	 */
+	void addSample(double sendTime, double receiveTime, quint32 hardwareTime);
+
+	/**
+	 * \brief Returns true if there are enough samples for the estimate
+	 *
+	 * \return true if the clock of the hardware can be estimated
+	 */
+	bool synchronized() const
+	{
+		return m_samples.size() >= minSamples;
+	}
+
+	/**
+	 * \brief Returns the clock of the hardware at the given host time
+	 *
+	 * This is only meaningful if synchronized() is true
+	 * \param hostTime the host time
+	 * \return the value the clock of the hardware has at hostTime
+	 */
+	quint32 hardwareTime(double hostTime) const;
+
+	/**
+	 * \brief Returns how much faster the clock of the hardware runs
+	 *
+	 * \return the estimated skew minus one in parts per million
+	 */
+	double skewPpm() const
+	{
+		return (m_skew - 1.0) * 1.0e6;
+	}
+
+	/**
+	 * \brief Returns the maximum error of the estimate
+	 *
+	 * \return the maximum difference between the estimate and the samples
+	 *         used for it, plus half of their round trip time, in
+	 *         milliseconds
+	 */
+	double maxError() const
+	{
+		return m_maxError;
+	}
+
+private:
+	/**
+	 * \brief A ping/pong exchange
+	 */
+	struct Sample
+	{
+		/**
+		 * \brief The host time in the middle of the exchange
+		 */
+		double hostTime;
+
+		/**
+		 * \brief The clock of the hardware without wrap arounds
+		 */
+		double hardwareTime;
+
+		/**
+		 * \brief The round trip time
+		 */
+		double roundTripTime;
+	};
+
+	/**
+	 * \brief Fits the line on the samples
+	 */
+	void estimate();
+
+	/**
+	 * \brief The last samples, the oldest first
+	 */
+	QList<Sample> m_samples;
+
+	/**
+	 * \brief The clock of the hardware in the last sample as received
+	 */
+	quint32 m_lastHardwareTime;
+
+	/**
+	 * \brief The clock of the hardware at m_referenceTime
+	 */
+	double m_offset;
+
+	/**
+	 * \brief The speed of the clock of the hardware relative to the host
+	 */
+	double m_skew;
+
+	/**
+	 * \brief The host time at which m_offset is computed
+	 *
+	 * This is the time of the last sample, so that offset and skew are
+	 * fitted close to where they are used
+	 */
+	double m_referenceTime;
+
+	/**
+	 * \brief The maximum error of the estimate
+	 */
+	double m_maxError;
+};
+
+#endif // CLOCKSYNC_H
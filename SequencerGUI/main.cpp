@@ -26,15 +26,19 @@
 #include "sequencer.h"
 #include "sequence.h"
 #include "serialcommunication.h"
+#include "robotgroup.h"
+#include "motionrecorder.h"
 
 int main(int argc, char *argv[])
 {
 	QApplication app(argc, argv);
 
-	// Registering the Sequence and SerialCommunication types to QML. It is not possible to create
+	// Registering the Sequence, SerialCommunication, RobotGroup and MotionRecorder types to QML. It is not possible to create
 	// these types directly from QML (but we don't need to)
 	qmlRegisterType<Sequence>();
 	qmlRegisterType<SerialCommunication>();
+	qmlRegisterType<RobotGroup>();
+	qmlRegisterType<MotionRecorder>();
 
 	// Creating the main class of the application
 	Sequencer sequencer;
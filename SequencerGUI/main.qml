@@ -136,6 +136,11 @@ ApplicationWindow {
 				id: sequenceControl
 				Layout.minimumHeight: implicitHeight
 			}
+
+			SequenceTimeline {
+				id: sequenceTimeline
+				Layout.minimumHeight: implicitHeight
+			}
 		}
 
 		ServoControl {
@@ -0,0 +1,232 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "motionrecorder.h"
+#include <QPair>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	// The tolerance of new recorders, in the units of coordinates
+	const double defaultTolerance = 1.0;
+
+	// The time without new poses after which the previous pose is considered
+	// held, in milliseconds. Dragging a slider sends poses more often than
+	// this
+	const quint32 holdTime = 50;
+
+	// Converts a coordinate to the stored value (8 fractional bits)
+	quint16 storedValue(double v)
+	{
+		return static_cast<quint16>(std::min(65535.0, std::max(0.0, std::round(v * 256.0))));
+	}
+}
+
+MotionRecorder::MotionRecorder(QObject* parent)
+	: QObject(parent)
+	, m_isRecording(false)
+	, m_tolerance(defaultTolerance)
+	, m_clock()
+	, m_dim(0)
+	, m_times()
+	, m_values()
+{
+}
+
+void MotionRecorder::setTolerance(double tolerance)
+{
+	tolerance = std::max(0.0, tolerance);
+
+	if (tolerance != m_tolerance) {
+		m_tolerance = tolerance;
+
+		emit toleranceChanged();
+	}
+}
+
+void MotionRecorder::start()
+{
+	if (m_isRecording) {
+		qDebug() << "MotionRecorder error: already recording";
+		return;
+	}
+
+	m_dim = 0;
+	m_times.clear();
+	m_values.clear();
+	m_clock.start();
+	m_isRecording = true;
+
+	emit numPosesChanged();
+	emit isRecordingChanged();
+}
+
+int MotionRecorder::stop(Sequence* sequence)
+{
+	if (!m_isRecording) {
+		qDebug() << "MotionRecorder error: not recording";
+		return 0;
+	}
+
+	// Checking the dimension before leaving the recording state, so that
+	// the poses are not lost and stop() can be called again with a suitable
+	// sequence
+	if (!m_times.isEmpty() && static_cast<int>(sequence->pointDim()) != m_dim) {
+		qDebug() << "MotionRecorder error: the sequence has dimension" << sequence->pointDim() << "the recorded poses" << m_dim;
+		return 0;
+	}
+
+	m_isRecording = false;
+	emit isRecordingChanged();
+
+	if (m_times.isEmpty()) {
+		return 0;
+	}
+
+	// Turning keyframes into points. The point is reached in the time from
+	// the end of the previous point minus the time it is kept (see
+	// pointPlayTime()). When the limits of the sequence make a point longer
+	// or shorter than that, the difference is carried into the next point,
+	// so that keyframes do not drift from the times they were recorded at
+	const QVector<int> poses = keyframes();
+	QList<SequencePoint> points;
+	qint64 playedTime = 0;
+	for (int pose: poses) {
+		const int dt = static_cast<int>(std::min<qint64>(std::numeric_limits<int>::max(), m_times[pose] - playedTime));
+
+		const int timeToTarget = std::max(sequence->minPointTimeToTarget(), std::min(sequence->maxPointTimeToTarget(), dt - sequence->minPointDuration() - 1));
+		const int duration = std::max(sequence->minPointDuration(), std::min(sequence->maxPointDuration(), dt - timeToTarget - 1));
+		playedTime += pointPlayTime(timeToTarget, duration);
+
+		QVector<double> p(m_dim);
+		for (int c = 0; c < m_dim; ++c) {
+			p[c] = value(pose, c) / 256.0;
+		}
+
+		points.append(SequencePoint(p, duration, timeToTarget, LinearProfile));
+	}
+
+	sequence->appendPoints(points);
+
+	return points.size();
+}
+
+void MotionRecorder::recordPoint(const SequencePoint& point)
+{
+	if (!m_isRecording) {
+		return;
+	}
+
+	if (m_times.isEmpty()) {
+		m_dim = point.point.size();
+	} else if (point.point.size() != m_dim) {
+		qDebug() << "MotionRecorder error: pose with dimension" << point.point.size() << "while recording poses with dimension" << m_dim;
+		return;
+	}
+
+	// Skipping poses equal to the last one, only the time of changes matters
+	const int last = m_times.size() - 1;
+	bool changed = (last < 0);
+	for (int c = 0; (c < m_dim) && !changed; ++c) {
+		changed = (storedValue(point.point[c]) != value(last, c));
+	}
+	if (!changed) {
+		return;
+	}
+
+	// In immediate mode the robot jumps to each pose, so after a hold the
+	// previous pose is kept until just before this one. Recording the end
+	// of the hold, otherwise the simplified motion would be a slow movement
+	// from the previous pose to this one
+	const quint32 time = static_cast<quint32>(m_clock.elapsed());
+	if ((last >= 0) && ((time - m_times[last]) > holdTime)) {
+		m_times.append(time - 1);
+		for (int c = 0; c < m_dim; ++c) {
+			m_values.append(value(last, c));
+		}
+	}
+
+	m_times.append(time);
+	for (int c = 0; c < m_dim; ++c) {
+		m_values.append(storedValue(point.point[c]));
+	}
+
+	emit numPosesChanged();
+}
+
+QVector<int> MotionRecorder::keyframes() const
+{
+	const int numPoses = m_times.size();
+	const double tolerance = m_tolerance * 256.0;
+
+	QVector<bool> keep(numPoses, false);
+	keep[0] = true;
+	keep[numPoses - 1] = true;
+
+	// The segments still to check, using a stack instead of recursion as
+	// recordings can be long
+	QVector<QPair<int, int>> segments;
+	if (numPoses > 2) {
+		segments.append(qMakePair(0, numPoses - 1));
+	}
+	while (!segments.isEmpty()) {
+		const QPair<int, int> s = segments.takeLast();
+		const double span = m_times[s.second] - m_times[s.first];
+
+		// Finding the pose farthest from the interpolation of the ends of
+		// the segment
+		int farthest = -1;
+		double maxDistance = tolerance;
+		for (int i = s.first + 1; i < s.second; ++i) {
+			const double alpha = (span == 0.0) ? 0.0 : ((m_times[i] - m_times[s.first]) / span);
+			for (int c = 0; c < m_dim; ++c) {
+				const double interpolated = value(s.first, c) + alpha * (value(s.second, c) - value(s.first, c));
+				const double distance = std::fabs(value(i, c) - interpolated);
+				if (distance > maxDistance) {
+					maxDistance = distance;
+					farthest = i;
+				}
+			}
+		}
+
+		if (farthest != -1) {
+			keep[farthest] = true;
+			if ((farthest - s.first) > 1) {
+				segments.append(qMakePair(s.first, farthest));
+			}
+			if ((s.second - farthest) > 1) {
+				segments.append(qMakePair(farthest, s.second));
+			}
+		}
+	}
+
+	QVector<int> indices;
+	for (int i = 0; i < numPoses; ++i) {
+		if (keep[i]) {
+			indices.append(i);
+		}
+	}
+
+	return indices;
+}
@@ -0,0 +1,248 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef MOTIONRECORDER_H
+#define MOTIONRECORDER_H
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QElapsedTimer>
+#include "sequence.h"
+#include "sequencepoint.h"
+
+/**
+ * \brief Records the poses sent to the robot in immediate mode and turns
+ *        them into sequence points
+ *
+ * While recording, each pose passed to recordPoint() (connected to
+ * SerialCommunication::immediatePointSent()) is stored with the time since
+ * recording started. Positions are stored with 16 bits (8 fractional bits,
+ * the resolution of the hardware) and poses equal to the previous one are
+ * skipped, so long recordings take little memory. As the robot jumps to each
+ * pose in immediate mode, the end of a hold is recorded as the previous pose
+ * just before the next one.
+ *
+ * When recording stops, the poses are reduced to keyframes with the
+ * Ramer-Douglas-Peucker algorithm: a pose is kept only if it is farther than
+ * the tolerance (on any channel) from the linear interpolation of the kept
+ * poses around it. Since points are played with a linear profile, the robot
+ * follows the recorded motion within the tolerance (up to the minimum
+ * duration of points, see stop())
+ */
+class MotionRecorder : public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(bool isRecording READ isRecording NOTIFY isRecordingChanged)
+	Q_PROPERTY(int numPoses READ numPoses NOTIFY numPosesChanged)
+	Q_PROPERTY(double tolerance READ tolerance WRITE setTolerance NOTIFY toleranceChanged)
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param parent the parent object
+	 */
+	explicit MotionRecorder(QObject* parent = nullptr);
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	MotionRecorder(const MotionRecorder& other) = delete;
+
+	/**
+	 * \brief Move constructor is deleted
+	 *
+	 * \param other the object to move into this
+	 */
+	MotionRecorder(MotionRecorder&& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	MotionRecorder& operator=(const MotionRecorder& other) = delete;
+
+	/**
+	 * \brief Move operator is deleted
+	 */
+	MotionRecorder& operator=(MotionRecorder&& other) = delete;
+
+	/**
+	 * \brief Destructor
+	 *
+	 * The default one is fine
+	 */
+	virtual ~MotionRecorder() = default;
+
+	/**
+	 * \brief Returns true if we are recording
+	 *
+	 * \return true if we are recording
+	 */
+	bool isRecording() const
+	{
+		return m_isRecording;
+	}
+
+	/**
+	 * \brief Returns the number of poses recorded so far
+	 *
+	 * \return the number of poses recorded so far
+	 */
+	int numPoses() const
+	{
+		return m_times.size();
+	}
+
+	/**
+	 * \brief Returns the maximum difference between the recorded motion
+	 *        and the simplified one
+	 *
+	 * \return the maximum difference between the recorded motion and the
+	 *         simplified one, in the units of coordinates
+	 */
+	double tolerance() const
+	{
+		return m_tolerance;
+	}
+
+	/**
+	 * \brief Sets the maximum difference between the recorded motion and
+	 *        the simplified one
+	 *
+	 * \param tolerance the maximum difference between the recorded motion
+	 *                  and the simplified one, in the units of coordinates.
+	 *                  Negative values are treated as 0
+	 */
+	void setTolerance(double tolerance);
+
+	/**
+	 * \brief Starts recording, discarding the poses of the previous
+	 *        recording
+	 */
+	Q_INVOKABLE void start();
+
+	/**
+	 * \brief Stops recording and appends the simplified motion to the
+	 *        sequence
+	 *
+	 * Each keyframe becomes a point reached with a linear profile at the
+	 * time it was recorded (relative to the start of recording), kept for
+	 * the minimum duration of points of the sequence. Times are clamped to
+	 * the limits of the sequence, the difference is recovered in the
+	 * following points
+	 * \param sequence the sequence where points are appended. If the
+	 *                 dimension is different from that of the recorded
+	 *                 poses nothing is appended and recording goes on, so
+	 *                 that stop() can be called again with another
+	 *                 sequence
+	 * \return the number of points appended
+	 */
+	Q_INVOKABLE int stop(Sequence* sequence);
+
+public slots:
+	/**
+	 * \brief Records a pose
+	 *
+	 * This does nothing if we are not recording. Only the coordinates of
+	 * the point are used
+	 * \param point the point with the pose
+	 */
+	void recordPoint(const SequencePoint& point);
+
+signals:
+	/**
+	 * \brief The signal emitted when recording starts or stops
+	 */
+	void isRecordingChanged();
+
+	/**
+	 * \brief The signal emitted when the number of poses changes
+	 */
+	void numPosesChanged();
+
+	/**
+	 * \brief The signal emitted when the tolerance changes
+	 */
+	void toleranceChanged();
+
+private:
+	/**
+	 * \brief Returns the indices of the poses to keep as keyframes
+	 *
+	 * \return the indices of the keyframes, in increasing order. The first
+	 *         and last poses are always included
+	 */
+	QVector<int> keyframes() const;
+
+	/**
+	 * \brief Returns the coordinate of a recorded pose
+	 *
+	 * \param pose the index of the pose
+	 * \param c the channel
+	 * \return the coordinate, with 8 fractional bits
+	 */
+	int value(int pose, int c) const
+	{
+		return m_values[pose * m_dim + c];
+	}
+
+	/**
+	 * \brief True if we are recording
+	 */
+	bool m_isRecording;
+
+	/**
+	 * \brief The maximum difference between the recorded motion and the
+	 *        simplified one
+	 */
+	double m_tolerance;
+
+	/**
+	 * \brief The clock for the times of poses
+	 */
+	QElapsedTimer m_clock;
+
+	/**
+	 * \brief The dimension of poses
+	 *
+	 * This is set by the first pose
+	 */
+	int m_dim;
+
+	/**
+	 * \brief The time of each pose in milliseconds since recording
+	 *        started
+	 */
+	QVector<quint32> m_times;
+
+	/**
+	 * \brief The coordinates of all poses, one pose after the other
+	 *
+	 * Coordinates have 8 fractional bits
+	 */
+	QVector<quint16> m_values;
+};
+
+#endif // MOTIONRECORDER_H
@@ -0,0 +1,268 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include "robotgroup.h"
+#include <QUrl>
+#include <QMutexLocker>
+#include <QDebug>
+
+RobotGroup::RobotGroup(QObject* parent)
+	: QObject(parent)
+	, m_ioThread()
+	, m_robots()
+	, m_statusMutex()
+{
+	// Needed to pass sequences to the objects in the I/O thread
+	qRegisterMetaType<Sequence*>("Sequence*");
+
+	m_ioThread.setObjectName("RobotGroup I/O");
+}
+
+RobotGroup::~RobotGroup()
+{
+	// The objects of robots are deleted when the thread finishes. Their
+	// destructors stop streams and close ports, we are no longer interested
+	// in their status
+	for (const Robot& robot: m_robots) {
+		disconnect(robot.serialCommunication, nullptr, this, nullptr);
+	}
+
+	m_ioThread.quit();
+	m_ioThread.wait();
+}
+
+QVariantList RobotGroup::robotStatus() const
+{
+	QVariantList list;
+
+	for (const Robot& robot: m_robots) {
+		const Status s = status(robot);
+
+		QVariantMap map;
+		map["serialPortName"] = robot.serialPortName;
+		map["isConnected"] = s.isConnected;
+		map["isStreaming"] = s.isStreaming;
+		map["numPoints"] = robot.numPoints;
+		map["linkStatistics"] = s.linkStatistics;
+
+		list.append(map);
+	}
+
+	return list;
+}
+
+int RobotGroup::addRobot(QString serialPortName, int baudRate)
+{
+	Robot robot;
+	robot.serialPortName = serialPortName;
+	robot.serialCommunication = new SerialCommunication();
+	robot.sequence = new Sequence();
+	robot.numPoints = 0;
+	robot.status = std::make_shared<Status>();
+
+	// Setting up the object before it is moved, afterwards it can only be
+	// used from the I/O thread
+	robot.serialCommunication->setSerialPortName(serialPortName);
+	robot.serialCommunication->setBaudRate(baudRate);
+	robot.serialCommunication->setScheduledStream(true);
+
+	// The status is updated in the I/O thread, where the object lives
+	SerialCommunication* const serialCommunication = robot.serialCommunication;
+	const std::shared_ptr<Status> status = robot.status;
+	auto updateStatus = [this, serialCommunication, status]() {
+		{
+			QMutexLocker locker(&m_statusMutex);
+
+			status->isConnected = serialCommunication->isConnected();
+			status->isStreaming = serialCommunication->isStreaming();
+			status->linkStatistics = serialCommunication->linkStatistics();
+		}
+
+		emit robotStatusChanged();
+	};
+	connect(serialCommunication, &SerialCommunication::isConnectedChanged, this, updateStatus, Qt::DirectConnection);
+	connect(serialCommunication, &SerialCommunication::isStreamingChanged, this, updateStatus, Qt::DirectConnection);
+	connect(serialCommunication, &SerialCommunication::linkStatisticsChanged, this, updateStatus, Qt::DirectConnection);
+	connect(serialCommunication, &SerialCommunication::streamError, this, [this, serialPortName](QString error) {
+		emit streamError(serialPortName, error);
+	}, Qt::DirectConnection);
+
+	// The thread is only needed once there are robots, most users of the
+	// GUI never stream to a group
+	if (!m_ioThread.isRunning()) {
+		m_ioThread.start();
+	}
+	moveToIOThread(robot.serialCommunication);
+	moveToIOThread(robot.sequence);
+
+	m_robots.append(robot);
+
+	emit numRobotsChanged();
+	emit robotStatusChanged();
+
+	return m_robots.size() - 1;
+}
+
+bool RobotGroup::removeRobot(int robot)
+{
+	if ((robot < 0) || (robot >= m_robots.size())) {
+		qDebug() << "RobotGroup error: invalid robot index" << robot;
+		return false;
+	}
+
+	deleteRobot(m_robots.takeAt(robot));
+
+	emit numRobotsChanged();
+	emit robotStatusChanged();
+
+	return true;
+}
+
+bool RobotGroup::loadSequence(int robot, QString filename)
+{
+	if ((robot < 0) || (robot >= m_robots.size())) {
+		qDebug() << "RobotGroup error: invalid robot index" << robot;
+		return false;
+	}
+	if (status(m_robots[robot]).isStreaming) {
+		qDebug() << "RobotGroup error: cannot change the sequence of a robot while streaming";
+		return false;
+	}
+
+	std::unique_ptr<Sequence> sequence = Sequence::load(QUrl(filename).toLocalFile());
+	if (!sequence->isValid()) {
+		return false;
+	}
+
+	// The old sequence is deleted in the I/O thread, where it lives
+	m_robots[robot].sequence->deleteLater();
+	m_robots[robot].sequence = sequence.release();
+	m_robots[robot].numPoints = m_robots[robot].sequence->numPoints();
+	moveToIOThread(m_robots[robot].sequence);
+
+	emit robotStatusChanged();
+
+	return true;
+}
+
+bool RobotGroup::openAll()
+{
+	bool allOpen = true;
+
+	for (const Robot& robot: m_robots) {
+		bool open = false;
+		QMetaObject::invokeMethod(robot.serialCommunication, "openSerial", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, open));
+
+		allOpen = allOpen && open;
+	}
+
+	return allOpen;
+}
+
+void RobotGroup::closeAll()
+{
+	for (const Robot& robot: m_robots) {
+		QMetaObject::invokeMethod(robot.serialCommunication, "closeSerial", Qt::BlockingQueuedConnection);
+	}
+}
+
+bool RobotGroup::startStreams(double maxStartSkew)
+{
+	// Checking all robots before starting any
+	const QString reason = notReadyReason(maxStartSkew);
+	if (!reason.isEmpty()) {
+		qDebug() << "RobotGroup error:" << reason;
+		return false;
+	}
+
+	// The lead time is for all robots, so it also covers the time to send
+	// the start to each of them
+	const double startTime = SerialCommunication::hostTime() + SerialCommunication::scheduleLeadTime;
+
+	for (const Robot& robot: m_robots) {
+		bool started = false;
+		QMetaObject::invokeMethod(robot.serialCommunication, "startStream", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, started), Q_ARG(Sequence*, robot.sequence), Q_ARG(bool, false), Q_ARG(double, startTime));
+
+		if (!started) {
+			qDebug() << "RobotGroup error: could not start the stream of robot" << robot.serialPortName;
+			stopStreams();
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RobotGroup::stopStreams()
+{
+	for (const Robot& robot: m_robots) {
+		QMetaObject::invokeMethod(robot.serialCommunication, "stop", Qt::BlockingQueuedConnection);
+	}
+}
+
+RobotGroup::Status RobotGroup::status(const Robot& robot) const
+{
+	QMutexLocker locker(&m_statusMutex);
+
+	return *(robot.status);
+}
+
+QString RobotGroup::notReadyReason(double maxStartSkew) const
+{
+	if (m_robots.isEmpty()) {
+		return "no robot to start";
+	}
+
+	// The first points of two robots start within the sum of the errors of
+	// their clock estimates
+	for (const Robot& robot: m_robots) {
+		const Status s = status(robot);
+
+		if (!s.isConnected || s.isStreaming) {
+			return QString("robot %1 is not connected or is already streaming").arg(robot.serialPortName);
+		}
+		if (robot.numPoints == 0) {
+			return QString("robot %1 has an empty sequence").arg(robot.serialPortName);
+		}
+		if (!s.linkStatistics.value("clockSynchronized").toBool() || ((2.0 * s.linkStatistics.value("clockError").toDouble()) > maxStartSkew)) {
+			return QString("the clock of robot %1 is not known well enough to start within %2 ms").arg(robot.serialPortName).arg(maxStartSkew);
+		}
+	}
+
+	return QString();
+}
+
+void RobotGroup::moveToIOThread(QObject* object)
+{
+	object->moveToThread(&m_ioThread);
+	connect(&m_ioThread, &QThread::finished, object, &QObject::deleteLater);
+}
+
+void RobotGroup::deleteRobot(const Robot& robot)
+{
+	disconnect(robot.serialCommunication, nullptr, this, nullptr);
+
+	// The stream of the robot is stopped before the sequence is deleted
+	robot.serialCommunication->deleteLater();
+	robot.sequence->deleteLater();
+}
@@ -0,0 +1,306 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#ifndef ROBOTGROUP_H
+#define ROBOTGROUP_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QVariantList>
+#include <memory>
+#include "sequence.h"
+#include "serialcommunication.h"
+
+/**
+ * \brief Streams sequences to several robots at the same time
+ *
+ * Each robot has its own serial port and sequence. The SerialCommunication
+ * objects and the sequences live in a single thread for I/O owned by this
+ * object, so that the user interface does not delay the packets to any of
+ * the robots. All functions of this class must be called from the thread of
+ * this object, they forward the requests to the I/O thread.
+ *
+ * Robots always use scheduled streams (see
+ * SerialCommunication::setScheduledStream()). startStreams() starts all
+ * streams at the same time on the clock shared by all SerialCommunication
+ * objects (see SerialCommunication::hostTime()), each robot converting it
+ * to its own clock. The first points of two robots then start within the
+ * sum of the errors of their clock estimates, and startStreams() refuses to
+ * start if that could be more than the given bound. The robots keep in step
+ * after the start, since each point is scheduled on the same clock
+ */
+class RobotGroup : public QObject
+{
+	Q_OBJECT
+	Q_PROPERTY(int numRobots READ numRobots NOTIFY numRobotsChanged)
+	Q_PROPERTY(QVariantList robotStatus READ robotStatus NOTIFY robotStatusChanged)
+
+public:
+	/**
+	 * \brief The default maximum difference between the start of the
+	 *        streams of two robots in milliseconds
+	 */
+	static constexpr double defaultMaxStartSkew = 5.0;
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * The I/O thread is only started when the first robot is added (see
+	 * addRobot())
+	 * \param parent the parent object
+	 */
+	explicit RobotGroup(QObject* parent = nullptr);
+
+	/**
+	 * \brief Copy constructor is deleted
+	 *
+	 * \param other the object to copy
+	 */
+	RobotGroup(const RobotGroup& other) = delete;
+
+	/**
+	 * \brief Move constructor is deleted
+	 *
+	 * \param other the object to move into this
+	 */
+	RobotGroup(RobotGroup&& other) = delete;
+
+	/**
+	 * \brief Copy operator is deleted
+	 */
+	RobotGroup& operator=(const RobotGroup& other) = delete;
+
+	/**
+	 * \brief Move operator is deleted
+	 */
+	RobotGroup& operator=(RobotGroup&& other) = delete;
+
+	/**
+	 * \brief Destructor
+	 *
+	 * Stops all streams, closes all ports and waits for the I/O thread to
+	 * finish
+	 */
+	virtual ~RobotGroup();
+
+	/**
+	 * \brief Returns the number of robots
+	 *
+	 * \return the number of robots
+	 */
+	int numRobots() const
+	{
+		return m_robots.size();
+	}
+
+	/**
+	 * \brief Returns the status of all robots
+	 *
+	 * The list has one map per robot with the keys "serialPortName",
+	 * "isConnected", "isStreaming", "numPoints" (of the sequence of the
+	 * robot) and "linkStatistics" (see SerialCommunication::linkStatistics())
+	 * \return the status of all robots
+	 */
+	QVariantList robotStatus() const;
+
+	/**
+	 * \brief Adds a robot
+	 *
+	 * The robot starts with an empty sequence and the port is not opened.
+	 * This starts the I/O thread if it is not running yet
+	 * \param serialPortName the name of the serial port of the robot
+	 * \param baudRate the baud rate of the port
+	 * \return the index of the new robot
+	 */
+	Q_INVOKABLE int addRobot(QString serialPortName, int baudRate = 115200);
+
+	/**
+	 * \brief Removes a robot
+	 *
+	 * The stream of the robot is stopped and its port is closed. The
+	 * indices of the following robots decrease by one
+	 * \param robot the index of the robot
+	 * \return false if the index is not valid
+	 */
+	Q_INVOKABLE bool removeRobot(int robot);
+
+	/**
+	 * \brief Loads the sequence of a robot from file
+	 *
+	 * \param robot the index of the robot
+	 * \param filename the name of the file to load
+	 * \return false if the index is not valid, the robot is streaming or
+	 *         the file could not be loaded (the robot keeps its sequence)
+	 */
+	Q_INVOKABLE bool loadSequence(int robot, QString filename);
+
+	/**
+	 * \brief Opens the ports of all robots
+	 *
+	 * Streams can be started once the clocks of all robots have been
+	 * estimated, which takes a few seconds after the ports are opened
+	 * \return false if any port could not be opened (the others remain
+	 *         open)
+	 */
+	Q_INVOKABLE bool openAll();
+
+	/**
+	 * \brief Closes the ports of all robots
+	 */
+	Q_INVOKABLE void closeAll();
+
+	/**
+	 * \brief Returns true if startStreams() can start the streams
+	 *
+	 * \param maxStartSkew the maximum difference between the start of the
+	 *                     streams of two robots in milliseconds
+	 * \return true if there are robots, all of them are connected, are not
+	 *         streaming, have a sequence and have estimated their clock
+	 *         well enough
+	 */
+	Q_INVOKABLE bool readyToStart(double maxStartSkew = defaultMaxStartSkew) const
+	{
+		return notReadyReason(maxStartSkew).isEmpty();
+	}
+
+	/**
+	 * \brief Starts the streams of all robots at the same time
+	 *
+	 * All sequences start from the beginning,
+	 * SerialCommunication::scheduleLeadTime milliseconds from now
+	 * \param maxStartSkew the maximum difference between the start of the
+	 *                     streams of two robots in milliseconds
+	 * \return false if the streams could not be started. This happens if
+	 *         any robot is not connected, is already streaming, has not
+	 *         estimated its clock well enough or cannot stream its
+	 *         sequence. No stream is started in this case
+	 */
+	Q_INVOKABLE bool startStreams(double maxStartSkew = defaultMaxStartSkew);
+
+	/**
+	 * \brief Stops the streams of all robots
+	 */
+	Q_INVOKABLE void stopStreams();
+
+signals:
+	/**
+	 * \brief The signal emitted when robots are added or removed
+	 */
+	void numRobotsChanged();
+
+	/**
+	 * \brief The signal emitted when the status of any robot changes
+	 *
+	 * This is also emitted from the I/O thread
+	 */
+	void robotStatusChanged();
+
+	/**
+	 * \brief The signal emitted when there is an error streaming to a
+	 *        robot
+	 *
+	 * This is also emitted from the I/O thread
+	 * \param robot the serial port name of the robot
+	 * \param message the error message
+	 */
+	void streamError(QString robot, QString message);
+
+private:
+	/**
+	 * \brief The status of a robot
+	 *
+	 * This is updated in the I/O thread and protected by m_statusMutex
+	 */
+	struct Status
+	{
+		bool isConnected = false;
+		bool isStreaming = false;
+		QVariantMap linkStatistics;
+	};
+
+	/**
+	 * \brief A robot
+	 *
+	 * The objects live in the I/O thread and are deleted there
+	 */
+	struct Robot
+	{
+		QString serialPortName;
+		SerialCommunication* serialCommunication;
+		Sequence* sequence;
+		int numPoints;
+		std::shared_ptr<Status> status;
+	};
+
+	/**
+	 * \brief Returns a copy of the status of a robot
+	 *
+	 * \param robot the robot
+	 * \return the status of the robot
+	 */
+	Status status(const Robot& robot) const;
+
+	/**
+	 * \brief Returns why the streams cannot be started
+	 *
+	 * \param maxStartSkew the maximum difference between the start of the
+	 *                     streams of two robots in milliseconds
+	 * \return the reason why the streams cannot be started or an empty
+	 *         string if they can
+	 */
+	QString notReadyReason(double maxStartSkew) const;
+
+	/**
+	 * \brief Moves an object to the I/O thread and schedules its deletion
+	 *        there when the thread finishes
+	 *
+	 * \param object the object to move
+	 */
+	void moveToIOThread(QObject* object);
+
+	/**
+	 * \brief Deletes the objects of a robot in the I/O thread
+	 *
+	 * \param robot the robot to delete
+	 */
+	void deleteRobot(const Robot& robot);
+
+	/**
+	 * \brief The thread where all serial communication happens
+	 */
+	QThread m_ioThread;
+
+	/**
+	 * \brief The robots
+	 */
+	QList<Robot> m_robots;
+
+	/**
+	 * \brief The mutex protecting the status of robots
+	 */
+	mutable QMutex m_statusMutex;
+};
+
+#endif // ROBOTGROUP_H
@@ -22,6 +22,7 @@
 #include "sequence.h"
 #include <QFile>
 #include <QJsonArray>
+#include "interpolation.h"
 
 namespace {
 	/**
@@ -35,6 +36,7 @@ namespace {
 		SequencePoint p;
 
 		p.duration = (sequence.max().duration + sequence.min().duration) / 2;
+		p.profile = LinearProfile;
 		p.point.resize(sequence.pointDim());
 		for (unsigned int i = 0; i < sequence.pointDim(); ++i) {
 			p.point[i] = (sequence.max().point[i] + sequence.min().point[i]) / 2.0;
@@ -42,19 +44,46 @@ namespace {
 
 		return p;
 	}
+
+	/**
+	 * \brief Returns how long a point is played by the robot
+	 *
+	 * \param p the point
+	 * \return the time in milliseconds the point is played
+	 */
+	qint64 playTime(const SequencePoint& p)
+	{
+		// Partial points do not wait for their channels to reach the target
+		return p.isPartial() ? pointPlayTime(0, p.duration) : pointPlayTime(p.timeToTarget, p.duration);
+	}
 }
 
 Sequence::Sequence(unsigned int pointDim, SequencePoint minVals, SequencePoint maxVals, QObject* parent)
-	: QObject(parent)
+	: QAbstractListModel(parent)
 	, m_pointDim(pointDim)
 	, m_min(validatePoint(minVals, true))
 	, m_max(validatePoint(maxVals, true))
 	, m_sequence()
 	, m_curPoint(-1)
+	, m_timeIndex()
 	, m_isModified(false)
 {
 }
 
+int Sequence::pointStartTime(int pos) const
+{
+	return m_timeIndex.prefixSum(pos);
+}
+
+int Sequence::pointAtTime(int t) const
+{
+	if (m_sequence.isEmpty()) {
+		return -1;
+	}
+
+	return std::min(m_timeIndex.find(t), m_sequence.length() - 1);
+}
+
 void Sequence::setCurPoint(int p)
 {
 	if (m_sequence.isEmpty()) {
@@ -142,6 +171,7 @@ std::unique_ptr<Sequence> Sequence::load(const QJsonDocument& json)
 	// Inserting one element at a time to be able to validate them
 	for (auto sp: list) {
 		s->m_sequence.append(s->validatePoint(sp));
+		s->m_timeIndex.append(playTime(s->m_sequence.last()));
 	}
 	if (!list.isEmpty()) {
 		s->m_curPoint = 0;
@@ -209,13 +239,17 @@ void Sequence::insertAfterCurrent()
 		return;
 	}
 
+	beginInsertRows(QModelIndex(), m_curPoint + 1, m_curPoint + 1);
 	if (m_curPoint == -1) {
 		m_sequence.append(validatePoint(defaultSequencePoint(*this)));
 	} else {
 		m_sequence.insert(m_curPoint + 1, validatePoint(m_sequence[m_curPoint]));
 	}
+	m_timeIndex.insert(m_curPoint + 1, playTime(m_sequence[m_curPoint + 1]));
+	endInsertRows();
 
 	emit numPointsChanged();
+	emit totalTimeChanged();
 
 	++m_curPoint;
 	emit curPointChanged();
@@ -231,15 +265,22 @@ void Sequence::insertBeforeCurrent()
 	}
 
 	if (m_curPoint == -1) {
+		beginInsertRows(QModelIndex(), 0, 0);
 		m_sequence.append(validatePoint(defaultSequencePoint(*this)));
+		m_timeIndex.append(playTime(m_sequence.last()));
+		endInsertRows();
 
 		m_curPoint = 0;
 		emit curPointChanged();
 	} else {
+		beginInsertRows(QModelIndex(), m_curPoint, m_curPoint);
 		m_sequence.insert(m_curPoint, validatePoint(m_sequence[m_curPoint]));
+		m_timeIndex.insert(m_curPoint, playTime(m_sequence[m_curPoint]));
+		endInsertRows();
 	}
 
 	emit numPointsChanged();
+	emit totalTimeChanged();
 
 	// Here we emit the curPointValuesChanged() signal even if the values
 	// are the same because conceptually the index of the current point
@@ -257,9 +298,13 @@ void Sequence::append()
 	}
 
 	SequencePoint p = (m_curPoint == -1) ? defaultSequencePoint(*this) : m_sequence[m_curPoint];
+	beginInsertRows(QModelIndex(), m_sequence.length(), m_sequence.length());
 	m_sequence.append(validatePoint(p));
+	m_timeIndex.append(playTime(m_sequence.last()));
+	endInsertRows();
 
 	emit numPointsChanged();
+	emit totalTimeChanged();
 
 	m_curPoint = m_sequence.length() - 1;
 	emit curPointChanged();
@@ -268,15 +313,39 @@ void Sequence::append()
 	sequenceModified();
 }
 
+void Sequence::appendPoints(const QList<SequencePoint>& points)
+{
+	if (!isValid() || points.isEmpty()) {
+		return;
+	}
+
+	beginInsertRows(QModelIndex(), m_sequence.length(), m_sequence.length() + points.size() - 1);
+	for (const SequencePoint& p: points) {
+		m_sequence.append(validatePoint(p));
+		m_timeIndex.append(playTime(m_sequence.last()));
+	}
+	endInsertRows();
+
+	emit numPointsChanged();
+	emit totalTimeChanged();
+
+	// The sequence has been modified
+	sequenceModified();
+}
+
 void Sequence::removeCurrent()
 {
 	if (!isValid() || (m_curPoint == -1)) {
 		return;
 	}
 
+	beginRemoveRows(QModelIndex(), m_curPoint, m_curPoint);
 	m_sequence.removeAt(m_curPoint);
+	m_timeIndex.remove(m_curPoint);
+	endRemoveRows();
 
 	emit numPointsChanged();
+	emit totalTimeChanged();
 
 	if (m_curPoint >= m_sequence.length()) {
 		// This will set cur point to -1 if the sequence is empty
@@ -300,9 +369,13 @@ void Sequence::clear()
 	}
 
 	if (!m_sequence.isEmpty()) {
+		beginResetModel();
 		m_sequence.clear();
+		m_timeIndex.clear();
+		endResetModel();
 
 		emit numPointsChanged();
+		emit totalTimeChanged();
 
 		m_curPoint = -1;
 		emit curPointChanged();
@@ -404,6 +477,48 @@ int Sequence::pointTimeToTarget() const
 	return pointTimeToTarget(m_curPoint);
 }
 
+int Sequence::pointProfile(int pos) const
+{
+	return m_sequence[pos].profile;
+}
+
+int Sequence::pointProfile() const
+{
+	if (m_curPoint < 0) {
+		return LinearProfile;
+	}
+
+	return pointProfile(m_curPoint);
+}
+
+bool Sequence::pointIsPartial(int pos) const
+{
+	return m_sequence[pos].isPartial();
+}
+
+bool Sequence::pointIsPartial() const
+{
+	if (m_curPoint < 0) {
+		return false;
+	}
+
+	return pointIsPartial(m_curPoint);
+}
+
+bool Sequence::pointUpdatesChannel(int pos, int c) const
+{
+	return m_sequence[pos].updatesChannel(c);
+}
+
+bool Sequence::pointUpdatesChannel(int c) const
+{
+	if (m_curPoint < 0) {
+		return false;
+	}
+
+	return pointUpdatesChannel(m_curPoint, c);
+}
+
 void Sequence::setPoint(int pos, SequencePoint p)
 {
 	if (!isValid()) {
@@ -419,16 +534,8 @@ void Sequence::setPoint(int pos, SequencePoint p)
 		return;
 	}
 
-	emit pointValuesChanged(pos);
-
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
-
-	// The sequence has been modified
-	sequenceModified();
+	updatePointTime(pos);
+	emitPointChanged(pos, QVector<int>());
 }
 
 void Sequence::setPoint(SequencePoint p)
@@ -454,16 +561,7 @@ void Sequence::setPointCoordinate(int pos, int c, double v)
 		return;
 	}
 
-	emit pointValuesChanged(pos);
-
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
-
-	// The sequence has been modified
-	sequenceModified();
+	emitPointChanged(pos, QVector<int>{FirstChannelRole + c});
 }
 
 void Sequence::setPointCoordinate(int c, double v)
@@ -489,16 +587,8 @@ void Sequence::setDuration(int pos, int d)
 		return;
 	}
 
-	emit pointValuesChanged(pos);
-
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
-	}
-
-	// The sequence has been modified
-	sequenceModified();
+	updatePointTime(pos);
+	emitPointChanged(pos, QVector<int>{DurationRole});
 }
 
 void Sequence::setDuration(int d)
@@ -524,25 +614,146 @@ void Sequence::setTimeToTarget(int pos, int t)
 		return;
 	}
 
-	emit pointValuesChanged(pos);
+	updatePointTime(pos);
+	emitPointChanged(pos, QVector<int>{TimeToTargetRole});
+}
 
-	// Also checking if we have to emit the signal for changes in the
-	// current point
-	if (pos == m_curPoint) {
-		emit curPointValuesChanged();
+void Sequence::setTimeToTarget(int t)
+{
+	if (m_curPoint < 0) {
+		return;
 	}
 
-	// The sequence has been modified
-	sequenceModified();
+	setTimeToTarget(m_curPoint, t);
 }
 
-void Sequence::setTimeToTarget(int t)
+void Sequence::setProfile(int pos, int pr)
+{
+	if (!isValid()) {
+		return;
+	}
+
+	const int old = m_sequence[pos].profile;
+	m_sequence[pos].profile = ((pr >= 0) && (pr < NumInterpolationProfiles)) ? pr : LinearProfile;
+
+	// If the point didn't actually changed, not emitting signals
+	if (old == m_sequence[pos].profile) {
+		return;
+	}
+
+	emitPointChanged(pos, QVector<int>{ProfileRole});
+}
+
+void Sequence::setProfile(int pr)
 {
 	if (m_curPoint < 0) {
 		return;
 	}
 
-	setTimeToTarget(m_curPoint, t);
+	setProfile(m_curPoint, pr);
+}
+
+void Sequence::setPartial(int pos, bool partial)
+{
+	if (!isValid()) {
+		return;
+	}
+
+	// If the point didn't actually changed, not emitting signals
+	if (m_sequence[pos].isPartial() == partial) {
+		return;
+	}
+
+	if (partial) {
+		m_sequence[pos].channels.fill(true, m_pointDim);
+	} else {
+		m_sequence[pos].channels.clear();
+	}
+
+	updatePointTime(pos);
+	emitPointChanged(pos, QVector<int>{PartialRole});
+}
+
+void Sequence::setPartial(bool partial)
+{
+	if (m_curPoint < 0) {
+		return;
+	}
+
+	setPartial(m_curPoint, partial);
+}
+
+void Sequence::setChannelUpdated(int pos, int c, bool updated)
+{
+	if (!isValid() || !m_sequence[pos].isPartial() || (c < 0) || (c >= int(m_pointDim))) {
+		return;
+	}
+
+	// If the point didn't actually changed, not emitting signals
+	if (m_sequence[pos].channels[c] == updated) {
+		return;
+	}
+
+	m_sequence[pos].channels[c] = updated;
+
+	emitPointChanged(pos, QVector<int>());
+}
+
+void Sequence::setChannelUpdated(int c, bool updated)
+{
+	if (m_curPoint < 0) {
+		return;
+	}
+
+	setChannelUpdated(m_curPoint, c, updated);
+}
+
+int Sequence::rowCount(const QModelIndex& parent) const
+{
+	// This is a list, only the root item has children
+	if (parent.isValid()) {
+		return 0;
+	}
+
+	return m_sequence.length();
+}
+
+QVariant Sequence::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid() || (index.row() >= m_sequence.length())) {
+		return QVariant();
+	}
+
+	const SequencePoint& p = m_sequence[index.row()];
+
+	if (role == DurationRole) {
+		return p.duration;
+	} else if (role == TimeToTargetRole) {
+		return p.timeToTarget;
+	} else if (role == ProfileRole) {
+		return p.profile;
+	} else if (role == PartialRole) {
+		return p.isPartial();
+	} else if ((role >= FirstChannelRole) && (role < (FirstChannelRole + p.point.length()))) {
+		return p.point[role - FirstChannelRole];
+	}
+
+	return QVariant();
+}
+
+QHash<int, QByteArray> Sequence::roleNames() const
+{
+	QHash<int, QByteArray> names;
+
+	names[DurationRole] = "duration";
+	names[TimeToTargetRole] = "timeToTarget";
+	names[ProfileRole] = "profile";
+	names[PartialRole] = "partial";
+	for (unsigned int c = 0; c < m_pointDim; ++c) {
+		names[FirstChannelRole + c] = "channel" + QByteArray::number(c);
+	}
+
+	return names;
 }
 
 SequencePoint Sequence::validatePoint(SequencePoint p, bool skipLimits) const
@@ -557,6 +768,15 @@ SequencePoint Sequence::validatePoint(SequencePoint p, bool skipLimits) const
 		p.point.resize(m_pointDim);
 	}
 
+	// Partial points have one flag per dimension, missing ones are not
+	// updated
+	if (p.isPartial()) {
+		while (p.channels.length() < int(m_pointDim)) {
+			p.channels.append(false);
+		}
+		p.channels.resize(m_pointDim);
+	}
+
 	if (skipLimits) {
 		return p;
 	}
@@ -567,6 +787,9 @@ SequencePoint Sequence::validatePoint(SequencePoint p, bool skipLimits) const
 	}
 	p.duration = std::min(m_max.duration, std::max(m_min.duration, p.duration));
 	p.timeToTarget = std::min(m_max.timeToTarget, std::max(m_min.timeToTarget, p.timeToTarget));
+	if ((p.profile < 0) || (p.profile >= NumInterpolationProfiles)) {
+		p.profile = LinearProfile;
+	}
 
 	return p;
 }
@@ -579,3 +802,32 @@ void Sequence::sequenceModified()
 		emit isModifiedChanged();
 	}
 }
+
+void Sequence::emitPointChanged(int pos, const QVector<int>& roles)
+{
+	emit pointValuesChanged(pos);
+
+	// Only telling views about the roles that actually changed
+	const QModelIndex i = index(pos);
+	emit dataChanged(i, i, roles);
+
+	// Also checking if we have to emit the signal for changes in the
+	// current point
+	if (pos == m_curPoint) {
+		emit curPointValuesChanged();
+	}
+
+	// The sequence has been modified
+	sequenceModified();
+}
+
+void Sequence::updatePointTime(int pos)
+{
+	const qint64 t = playTime(m_sequence[pos]);
+
+	if (t != m_timeIndex.value(pos)) {
+		m_timeIndex.set(pos, t);
+
+		emit totalTimeChanged();
+	}
+}
@@ -22,11 +22,12 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
-#include <QObject>
+#include <QAbstractListModel>
 #include <QList>
 #include <QJsonDocument>
 #include "utils.h"
 #include "sequencepoint.h"
+#include "timeindex.h"
 
 /**
  * \brief The class modelling a sequence of points
@@ -50,8 +51,20 @@
  *       automatically changed when needed if the sequence is modified (e.g. if
  *       the current point is the last point and it is removed, the current
  *       point is set to the last element after removal)
+ *
+ * The sequence is also a list model with one row per point, so that QML views
+ * can show it without querying points one at a time. Each row has the duration,
+ * the time to target, the interpolation profile, whether the point is partial
+ * and one role per coordinate (named channel0, channel1, ...). When a single
+ * value of a point changes, dataChanged() is only emitted for the role of that
+ * value.
+ *
+ * The sequence also keeps track of the time at which each point starts when
+ * played by the robot (see pointPlayTime() in the firmware), so that going from
+ * a time to a point and viceversa, as well as computing the total time of the
+ * sequence, is O(log n).
  */
-class Sequence : public QObject
+class Sequence : public QAbstractListModel
 {
 	Q_OBJECT
 	Q_PROPERTY(bool isValid READ isValid)
@@ -59,6 +72,21 @@ class Sequence : public QObject
 	Q_PROPERTY(int numPoints READ numPoints NOTIFY numPointsChanged)
 	Q_PROPERTY(int curPoint READ curPoint WRITE setCurPoint NOTIFY curPointChanged)
 	Q_PROPERTY(bool isModified READ isModified NOTIFY isModifiedChanged)
+	Q_PROPERTY(int totalTime READ totalTime NOTIFY totalTimeChanged)
+
+public:
+	/**
+	 * \brief The roles of the model
+	 *
+	 * The role of the coordinate c of points is FirstChannelRole + c
+	 */
+	enum Roles {
+		DurationRole = Qt::UserRole + 1,
+		TimeToTargetRole,
+		ProfileRole,
+		PartialRole,
+		FirstChannelRole
+	};
 
 public:
 	/**
@@ -149,6 +177,37 @@ public:
 		return m_isModified;
 	}
 
+	/**
+	 * \brief Returns the time needed to play the whole sequence
+	 *
+	 * \return the time in milliseconds needed to play the whole sequence
+	 */
+	int totalTime() const
+	{
+		return m_timeIndex.total();
+	}
+
+	/**
+	 * \brief Returns the time at which a point starts when playing the
+	 *        sequence
+	 *
+	 * \param pos the position in the sequence of the point. If equal to
+	 *            numPoints(), the total time is returned
+	 * \return the time in milliseconds from the beginning of the sequence
+	 *         at which the point starts
+	 */
+	Q_INVOKABLE int pointStartTime(int pos) const;
+
+	/**
+	 * \brief Returns the point played at the given time
+	 *
+	 * \param t the time in milliseconds from the beginning of the sequence
+	 * \return the position of the point played at time t. If t is negative
+	 *         0 is returned, if it is past the end of the sequence the last
+	 *         point is returned. If the sequence is empty, returns -1
+	 */
+	Q_INVOKABLE int pointAtTime(int t) const;
+
 	/**
 	 * \brief Sets the current point
 	 *
@@ -221,6 +280,14 @@ public:
 	 */
 	Q_INVOKABLE void append();
 
+	/**
+	 * \brief Inserts the given points at the end of the sequence
+	 *
+	 * The points are validated, the current point does not change
+	 * \param points the points to insert
+	 */
+	void appendPoints(const QList<SequencePoint>& points);
+
 	/**
 	 * \brief Removes the point at the curret position
 	 */
@@ -355,6 +422,55 @@ public:
 	 */
 	Q_INVOKABLE int pointTimeToTarget() const;
 
+	/**
+	 * \brief Returns the interpolation profile of the point
+	 *
+	 * \param pos the position in the sequence of the point
+	 * \return the interpolation profile of the point (one of
+	 *         InterpolationProfile)
+	 */
+	Q_INVOKABLE int pointProfile(int pos) const;
+
+	/**
+	 * \brief Returns the interpolation profile of the current point
+	 *
+	 * \return the interpolation profile of the current point
+	 */
+	Q_INVOKABLE int pointProfile() const;
+
+	/**
+	 * \brief Returns true if the point is partial
+	 *
+	 * See SequencePoint::isPartial()
+	 * \param pos the position in the sequence of the point
+	 * \return true if the point is partial
+	 */
+	Q_INVOKABLE bool pointIsPartial(int pos) const;
+
+	/**
+	 * \brief Returns true if the current point is partial
+	 *
+	 * \return true if the current point is partial
+	 */
+	Q_INVOKABLE bool pointIsPartial() const;
+
+	/**
+	 * \brief Returns true if the point updates the given channel
+	 *
+	 * \param pos the position in the sequence of the point
+	 * \param c the index of the channel
+	 * \return true if the point updates the channel
+	 */
+	Q_INVOKABLE bool pointUpdatesChannel(int pos, int c) const;
+
+	/**
+	 * \brief Returns true if the current point updates the given channel
+	 *
+	 * \param c the index of the channel
+	 * \return true if the current point updates the channel
+	 */
+	Q_INVOKABLE bool pointUpdatesChannel(int c) const;
+
 	/**
 	 * \brief Sets the point at the given position
 	 *
@@ -417,6 +533,82 @@ public:
 	 */
 	Q_INVOKABLE void setTimeToTarget(int t);
 
+	/**
+	 * \brief Sets the interpolation profile of a point
+	 *
+	 * \param pos the position in the sequence of the point to change
+	 * \param pr the new profile (one of InterpolationProfile). Invalid
+	 *           values are replaced by LinearProfile
+	 */
+	Q_INVOKABLE void setProfile(int pos, int pr);
+
+	/**
+	 * \brief Sets the interpolation profile of the current point
+	 *
+	 * \param pr the new profile (one of InterpolationProfile)
+	 */
+	Q_INVOKABLE void setProfile(int pr);
+
+	/**
+	 * \brief Makes a point partial or not
+	 *
+	 * A point that becomes partial initially updates all channels
+	 * \param pos the position in the sequence of the point to change
+	 * \param partial whether the point should be partial
+	 */
+	Q_INVOKABLE void setPartial(int pos, bool partial);
+
+	/**
+	 * \brief Makes the current point partial or not
+	 *
+	 * \param partial whether the point should be partial
+	 */
+	Q_INVOKABLE void setPartial(bool partial);
+
+	/**
+	 * \brief Sets whether a partial point updates a channel
+	 *
+	 * This does nothing if the point is not partial
+	 * \param pos the position in the sequence of the point to change
+	 * \param c the index of the channel
+	 * \param updated whether the point should update the channel
+	 */
+	Q_INVOKABLE void setChannelUpdated(int pos, int c, bool updated);
+
+	/**
+	 * \brief Sets whether the current point updates a channel
+	 *
+	 * This does nothing if the point is not partial
+	 * \param c the index of the channel
+	 * \param updated whether the point should update the channel
+	 */
+	Q_INVOKABLE void setChannelUpdated(int c, bool updated);
+
+	/**
+	 * \brief Returns the number of rows of the model
+	 *
+	 * \param parent the parent index. Only the root index has children
+	 * \return the number of points in the sequence
+	 */
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+	/**
+	 * \brief Returns the data for the given index and role
+	 *
+	 * \param index the index of the point
+	 * \param role one of the values in Roles
+	 * \return the requested value or an invalid QVariant if index or role
+	 *         are not valid
+	 */
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+	/**
+	 * \brief Returns the names of roles, as used in QML delegates
+	 *
+	 * \return the names of roles
+	 */
+	QHash<int, QByteArray> roleNames() const override;
+
 signals:
 	/**
 	 * \brief The signal emitted when the number of points in the sequence
@@ -453,6 +645,12 @@ signals:
 	 */
 	void isModifiedChanged();
 
+	/**
+	 * \brief The signal emitted when the time needed to play the sequence
+	 *        changes
+	 */
+	void totalTimeChanged();
+
 private:
 	/**
 	 * \brief Validates a point eventually changing it so that it has the
@@ -471,6 +669,22 @@ private:
 	 */
 	void sequenceModified();
 
+	/**
+	 * \brief Emits the signals telling that a value of a point changed
+	 *
+	 * \param pos the position in the sequence of the point that changed
+	 * \param roles the roles of the model that changed. If empty, all
+	 *              roles are considered changed
+	 */
+	void emitPointChanged(int pos, const QVector<int>& roles);
+
+	/**
+	 * \brief Updates the time index after the timings of a point changed
+	 *
+	 * \param pos the position in the sequence of the point that changed
+	 */
+	void updatePointTime(int pos);
+
 	/**
 	 * \brief The dimensionality of points
 	 *
@@ -502,6 +716,14 @@ private:
 	 */
 	int m_curPoint;
 
+	/**
+	 * \brief The time each point is played, to quickly compute the time at
+	 *        which points start
+	 *
+	 * This has one element for each point in m_sequence
+	 */
+	TimeIndex m_timeIndex;
+
 	/**
 	 * \brief True if this sequence has been modified after construction or
 	 *        after the last time it was saved
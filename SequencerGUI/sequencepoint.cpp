@@ -22,10 +22,11 @@
 #include "sequencepoint.h"
 #include <QJsonArray>
 
-SequencePoint::SequencePoint(QVector<double> p, int d, int t)
+SequencePoint::SequencePoint(QVector<double> p, int d, int t, int pr)
 	: point(p)
 	, duration(d)
 	, timeToTarget(t)
+	, profile(pr)
 {
 }
 
@@ -34,6 +35,8 @@ bool SequencePoint::fromJson(const QJsonObject& json)
 	point.clear();
 	duration = -1;
 	timeToTarget = -1;
+	profile = LinearProfile;
+	channels.clear();
 
 	// Reading the three keys: point...
 	QJsonValue p = json["point"];
@@ -61,6 +64,29 @@ bool SequencePoint::fromJson(const QJsonObject& json)
 	}
 	timeToTarget = static_cast<int>(t.toDouble());
 
+	// The profile is optional
+	QJsonValue pr = json["profile"];
+	if (!pr.isUndefined()) {
+		if (!pr.isDouble()) {
+			return false;
+		}
+		profile = static_cast<int>(pr.toDouble());
+	}
+
+	// Channels are also optional
+	QJsonValue ch = json["channels"];
+	if (!ch.isUndefined()) {
+		if (!ch.isArray()) {
+			return false;
+		}
+		for (auto v: ch.toArray()) {
+			if (!v.isBool()) {
+				return false;
+			}
+			channels.append(v.toBool());
+		}
+	}
+
 	return true;
 }
 
@@ -81,6 +107,20 @@ QJsonObject SequencePoint::toJson() const
 	// and timeToTarget
 	o.insert("timeToTarget", timeToTarget);
 
+	// The profile is only saved if it is not the default one
+	if (profile != LinearProfile) {
+		o.insert("profile", profile);
+	}
+
+	// Channels are only saved for partial points
+	if (isPartial()) {
+		QJsonArray ch;
+		for (auto c: channels) {
+			ch.append(c);
+		}
+		o.insert("channels", ch);
+	}
+
 	return o;
 }
 
@@ -89,5 +129,7 @@ bool SequencePoint::operator==(const SequencePoint& other) const
 	// We check point last because it is the most expensive check
 	return (other.duration == duration) &&
 	       (other.timeToTarget == timeToTarget) &&
+	       (other.profile == profile) &&
+	       (other.channels == channels) &&
 	       (other.point == point);
 }
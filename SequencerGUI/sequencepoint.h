@@ -25,6 +25,7 @@
 #include <QVector>
 #include <QJsonObject>
 #include "utils.h"
+#include "interpolation.h"
 
 /**
  * \brief A single point in a sequence
@@ -44,12 +45,40 @@ struct SequencePoint
 	 * \param p the point
 	 * \param d the duration in milliseconds
 	 * \param t the time to reach this point in milliseconds
+	 * \param pr the interpolation profile used to reach this point
 	 */
-	SequencePoint(QVector<double> p, int d, int t);
+	SequencePoint(QVector<double> p, int d, int t, int pr = LinearProfile);
+
+	/**
+	 * \brief Returns true if this is a partial point
+	 *
+	 * A partial point only updates the channels set in channels and does
+	 * not wait for them to reach the target: the next point starts
+	 * duration milliseconds after the beginning of this one
+	 * \return true if this is a partial point
+	 */
+	bool isPartial() const
+	{
+		return !channels.isEmpty();
+	}
+
+	/**
+	 * \brief Returns true if this point updates the given channel
+	 *
+	 * \param c the index of the channel
+	 * \return true if this point updates the channel
+	 */
+	bool updatesChannel(int c) const
+	{
+		return channels.isEmpty() || channels.value(c);
+	}
 
 	/**
 	 * \brief Initializes this object from its JSON representation
 	 *
+	 * The profile and the channels are optional (defaults are LinearProfile
+	 * and all channels), so that files saved before they were introduced
+	 * can still be read
 	 * \param json the JSON object to read
 	 * \return false in case of error
 	 */
@@ -80,13 +109,30 @@ struct SequencePoint
 	 *
 	 * The point should not be changed for this amount of milliseconds
 	 */
-	int duration;
+	int duration = 0;
 
 	/**
 	 * \brief The time spent to reach this point from the previous position
 	 *        in milliseconds
 	 */
-	int timeToTarget;
+	int timeToTarget = 0;
+
+	/**
+	 * \brief How the robot moves from the previous position to this point
+	 *
+	 * This is one of the values of InterpolationProfile (see
+	 * interpolation.h in the firmware)
+	 */
+	int profile = LinearProfile;
+
+	/**
+	 * \brief Which channels are updated by this point
+	 *
+	 * If empty, all channels are updated and the point is not partial.
+	 * Otherwise this has one element per channel and the point is partial
+	 * (see isPartial())
+	 */
+	QVector<bool> channels;
 };
 
 #endif // SEQUENCEPOINT_H
@@ -24,23 +24,35 @@
 #include <QUrl>
 #include <QDebug>
 
-// ONLY FOR TESTING, CHANGE!!!
 namespace {
-	const unsigned int pointDim = 16;
-	const SequencePoint minPoint(QVector<double>(pointDim, 0), 3, 1);
-	const SequencePoint maxPoint(QVector<double>(pointDim, 255), 3000, 10000);
+	// The dimension of new sequences until the hardware tells us its own
+	const unsigned int defaultPointDim = 16;
+
+	// Returns a sequence with the given dimension and the default limits
+	std::unique_ptr<Sequence> createSequence(unsigned int pointDim)
+	{
+		const SequencePoint minPoint(QVector<double>(pointDim, 0), 3, 1);
+		const SequencePoint maxPoint(QVector<double>(pointDim, 255), 3000, 10000);
+
+		return std::make_unique<Sequence>(pointDim, minPoint, maxPoint);
+	}
 }
 
 Sequencer::Sequencer(QObject *parent)
 	: QObject(parent)
-	, m_sequence(std::make_unique<Sequence>(pointDim, minPoint, maxPoint))
+	, m_pointDim(defaultPointDim)
+	, m_sequence(createSequence(m_pointDim))
 	, m_serialCommunication(std::make_unique<SerialCommunication>())
+	, m_robotGroup(std::make_unique<RobotGroup>())
+	, m_motionRecorder(std::make_unique<MotionRecorder>())
 {
+	connect(m_serialCommunication.get(), &SerialCommunication::hardwarePointDimChanged, this, &Sequencer::hardwarePointDimChanged);
+	connect(m_serialCommunication.get(), &SerialCommunication::immediatePointSent, m_motionRecorder.get(), &MotionRecorder::recordPoint);
 }
 
 void Sequencer::newSequence()
 {
-	m_sequence = std::make_unique<Sequence>(pointDim, minPoint, maxPoint);
+	m_sequence = createSequence(m_pointDim);
 
 	emit sequenceChanged();
 }
@@ -58,3 +70,19 @@ bool Sequencer::loadSequence(QString filename)
 
 	return m_sequence->isValid();
 }
+
+void Sequencer::hardwarePointDimChanged()
+{
+	const int hardwarePointDim = m_serialCommunication->hardwarePointDim();
+	if ((hardwarePointDim <= 0) || (static_cast<unsigned int>(hardwarePointDim) == m_pointDim)) {
+		return;
+	}
+
+	m_pointDim = hardwarePointDim;
+
+	// An empty sequence is replaced right away, otherwise the new dimension is
+	// used for the next new sequence (the current one cannot be streamed)
+	if (m_sequence->numPoints() == 0) {
+		newSequence();
+	}
+}
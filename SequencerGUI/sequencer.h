@@ -26,20 +26,28 @@
 #include "utils.h"
 #include "sequence.h"
 #include "serialcommunication.h"
+#include "robotgroup.h"
+#include "motionrecorder.h"
 
 /**
  * \brief The main class of the applications
  *
  * This class is meant to be instantiated only once and to be used as the QML
  * context object. It contanins the instances of the current sequence and the
- * object used for serial communication (exposed as read-only properties). It
- * also has methods to load and save sequence files.
+ * object used for serial communication (exposed as read-only properties), as
+ * well as the group of robots used to stream to several robots at once and
+ * the recorder of poses sent in immediate mode (connected to the object for
+ * serial communication). It also has methods to load and save sequence files.
+ * New sequences have the dimension reported by the hardware (16 until the
+ * hardware reports it)
  */
 class Sequencer : public QObject
 {
 	Q_OBJECT
 	Q_PROPERTY(Sequence* sequence READ sequence NOTIFY sequenceChanged)
 	Q_PROPERTY(SerialCommunication* serialCommunication READ serialCommunication NOTIFY serialCommunicationChanged)
+	Q_PROPERTY(RobotGroup* robotGroup READ robotGroup NOTIFY robotGroupChanged)
+	Q_PROPERTY(MotionRecorder* motionRecorder READ motionRecorder NOTIFY motionRecorderChanged)
 
 public:
 	/**
@@ -100,6 +108,26 @@ public:
 		return m_serialCommunication.get();
 	}
 
+	/**
+	 * \brief Returns the group of robots
+	 *
+	 * \return the group of robots
+	 */
+	RobotGroup* robotGroup()
+	{
+		return m_robotGroup.get();
+	}
+
+	/**
+	 * \brief Returns the recorder of poses sent in immediate mode
+	 *
+	 * \return the recorder of poses sent in immediate mode
+	 */
+	MotionRecorder* motionRecorder()
+	{
+		return m_motionRecorder.get();
+	}
+
 signals:
 	/**
 	 * \brief The signal emitted when the sequence changes
@@ -115,6 +143,22 @@ signals:
 	 */
 	void serialCommunicationChanged();
 
+	/**
+	 * \brief The signal emitted when the group of robots changes
+	 *
+	 * This signal is never emitted, it is here for the same reason as
+	 * serialCommunicationChanged()
+	 */
+	void robotGroupChanged();
+
+	/**
+	 * \brief The signal emitted when the recorder of poses changes
+	 *
+	 * This signal is never emitted, it is here for the same reason as
+	 * serialCommunicationChanged()
+	 */
+	void motionRecorderChanged();
+
 public slots:
 	/**
 	 * \brief Creates a new sequence, discarding the old one
@@ -138,7 +182,19 @@ public slots:
 	 */
 	bool loadSequence(QString filename);
 
+private slots:
+	/**
+	 * \brief The slot called when the hardware reports the dimension of
+	 *        points
+	 */
+	void hardwarePointDimChanged();
+
 private:
+	/**
+	 * \brief The dimension of new sequences
+	 */
+	unsigned int m_pointDim;
+
 	/**
 	 * \brief The current sequence
 	 */
@@ -148,6 +204,16 @@ private:
 	 * \brief The object for serial communication
 	 */
 	std::unique_ptr<SerialCommunication> m_serialCommunication;
+
+	/**
+	 * \brief The group of robots
+	 */
+	std::unique_ptr<RobotGroup> m_robotGroup;
+
+	/**
+	 * \brief The recorder of poses sent in immediate mode
+	 */
+	std::unique_ptr<MotionRecorder> m_motionRecorder;
 };
 
 #endif // SEQUENCER_H
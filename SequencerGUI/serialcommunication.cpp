@@ -21,23 +21,168 @@
 
 #include "serialcommunication.h"
 #include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include "interpolation.h"
+#include "eventcodes.h"
+#include "wirepositions.h"
+#include "textscroller.h"
+#include "trajectory.h"
+
+namespace {
+	/**
+	 * \brief The bit of the options byte of sequence points set for partial
+	 *        points
+	 */
+	const char channelMaskOption = 0x08;
+
+	/**
+	 * \brief The bit of the point dimension in start packets set to use 16
+	 *        bit positions
+	 */
+	const unsigned char widePositionsFlag = 0x80;
+
+	/**
+	 * \brief The bit of the options byte of sequence points set when the
+	 *        start time follows
+	 */
+	const char scheduledOption = 0x10;
+
+	/**
+	 * \brief The interval between updates of the link statistics (and
+	 *        between pings) in milliseconds
+	 */
+	const int linkStatisticsInterval = 1000;
+
+	/**
+	 * \brief The number of round trip times on which percentiles are
+	 *        computed
+	 */
+	const int maxRoundTripTimes = 100;
+
+	/**
+	 * \brief The number of points sent in stream mode whose index in the
+	 *        sequence is kept to find the point of underruns
+	 *
+	 * This must be a power of 2, much larger than the buffer of the
+	 * hardware
+	 */
+	const int streamPointIndicesSize = 256;
+
+	/**
+	 * \brief Returns a percentile of sorted values
+	 *
+	 * This uses the nearest rank method
+	 * \param sorted the values, sorted in ascending order. This must not be
+	 *               empty
+	 * \param p the percentile (between 0 and 100)
+	 * \return the percentile
+	 */
+	double percentile(const QList<double>& sorted, double p)
+	{
+		const int rank = static_cast<int>(std::ceil(p / 100.0 * sorted.size()));
+
+		return sorted[std::max(0, std::min(sorted.size(), rank) - 1)];
+	}
+
+	/**
+	 * \brief Returns the name of a state of the firmware
+	 *
+	 * \param state the state (see FirmwareState)
+	 * \return the name of the state
+	 */
+	QString firmwareStateName(int state)
+	{
+		switch (state) {
+			case IdleState:
+				return "idle";
+			case StreamMode:
+				return "streaming";
+			case StreamModeStopping:
+				return "stopping";
+			case ImmediateMode:
+				return "immediate mode";
+			default:
+				return QString("unknown state %1").arg(state);
+		}
+	}
+
+	/**
+	 * \brief Returns the description of an event from the hardware
+	 *
+	 * \param code the code of the event (see EventCode)
+	 * \param arg0 the first argument of the event
+	 * \param arg1 the second argument of the event
+	 * \return the description of the event
+	 */
+	QString eventMessage(int code, int arg0, int arg1)
+	{
+		switch (code) {
+			case InvalidPointDimensionEvent:
+				return QString("Invalid point dimension %1 (the hardware has %2 servos)").arg(arg0).arg(arg1);
+			case UnexpectedCommandEvent:
+				return QString("Unexpected command %1 (hardware %2)").arg(QChar(arg0)).arg(firmwareStateName(arg1));
+			case PointBufferFullEvent:
+				return QString("Sequence point received but buffer full (%1 points)").arg(arg0);
+			case InvalidServoEvent:
+				return QString("Invalid servo index %1").arg(arg0);
+			case InvalidFaceExpressionEvent:
+				return QString("Invalid face expression %1").arg(arg0);
+			case LatePointsDroppedEvent:
+				return QString("%1 late points skipped").arg(arg0);
+			default:
+				return QString("Unknown event %1 (arguments %2 %3)").arg(code).arg(arg0).arg(arg1);
+		}
+	}
+}
 
 SerialCommunication::SerialCommunication(QObject* parent)
 	: QObject(parent)
 	, m_serialPortName("/dev/ttyUSB4")
 	, m_baudRate(115200)
 	, m_oneShotSequence(true)
-	, m_serialPort()
+	, m_serialPort(this)
 	, m_sequence(nullptr)
 	, m_isStreamMode(false)
 	, m_isImmediateMode(false)
-	, m_arduinoBoot()
+	, m_arduinoBoot(this)
 	, m_incomingData()
 	, m_indexToProcess(0)
 	, m_paused(false)
+	, m_playbackSpeed(1.0)
+	, m_highResolution(false)
 	, m_hardwareQueueFull(false)
 	, m_batteryCharge(-1.0)
+	, m_saturationCounts()
+	, m_busStatistics()
+	, m_busTestResults()
+	, m_hardwarePointDim(-1)
 	, m_stopping(false)
+	, m_pendingPoints()
+	, m_streamPointIndices(streamPointIndicesSize, -1)
+	, m_sentStreamPoints(0)
+	, m_underruns()
+	, m_hardwareUnderruns(0)
+	, m_lastSentValues()
+	, m_linkStatisticsTimer(this)
+	, m_linkClock()
+	, m_lastLinkStatisticsTime(0)
+	, m_pendingPingTimestamp(0)
+	, m_pendingPingHostTime(0.0)
+	, m_clockSync()
+	, m_scheduledStream(false)
+	, m_scheduleStart(0.0)
+	, m_scheduleElapsed(0)
+	, m_pauseHostTime(0.0)
+	, m_pingPending(false)
+	, m_roundTripTimes()
+	, m_receivedPackets(0)
+	, m_receivedBytes(0)
+	, m_sentPackets(0)
+	, m_sentBytes(0)
+	, m_lostPings(0)
+	, m_parseErrors(0)
+	, m_linkStatistics()
 {
 	// Connecting signals from the serial port
 	connect(&m_serialPort, &QSerialPort::readyRead, this, &SerialCommunication::handleReadyRead);
@@ -46,6 +191,10 @@ SerialCommunication::SerialCommunication(QObject* parent)
 	// Connecting the signal for the Arduino boot timer. Also setting the timer to be singleShot
 	m_arduinoBoot.setSingleShot(true);
 	connect(&m_arduinoBoot, &QTimer::timeout, this, &SerialCommunication::arduinoBootFinished);
+
+	// The timer for link statistics runs while the port is open
+	m_linkStatisticsTimer.setInterval(linkStatisticsInterval);
+	connect(&m_linkStatisticsTimer, &QTimer::timeout, this, &SerialCommunication::updateLinkStatistics);
 }
 
 SerialCommunication::~SerialCommunication()
@@ -81,6 +230,69 @@ void SerialCommunication::setOneShotSequence(bool oneShot)
 	}
 }
 
+void SerialCommunication::setPlaybackSpeed(double speed)
+{
+	if (isStreamMode() && m_scheduledStream) {
+		qDebug() << "SerialCommunication error: cannot change the playback speed of a scheduled stream";
+		return;
+	}
+
+	speed = std::min(255.0, std::max(0.0, speed));
+
+	if (speed != m_playbackSpeed) {
+		m_playbackSpeed = speed;
+
+		// The new speed is immediately used if we are streaming
+		if (isStreamMode()) {
+			sendTimeScale();
+		}
+
+		emit playbackSpeedChanged();
+	}
+}
+
+void SerialCommunication::setHighResolution(bool highResolution)
+{
+	if (isStreaming()) {
+		qDebug() << "SerialCommunication error: cannot change the resolution of positions while streaming";
+		return;
+	}
+
+	if (highResolution != m_highResolution) {
+		m_highResolution = highResolution;
+
+		emit highResolutionChanged();
+	}
+}
+
+void SerialCommunication::setScheduledStream(bool scheduled)
+{
+	if (isStreaming()) {
+		qDebug() << "SerialCommunication error: cannot change whether points are scheduled while streaming";
+		return;
+	}
+
+	if (scheduled != m_scheduledStream) {
+		m_scheduledStream = scheduled;
+
+		emit scheduledStreamChanged();
+	}
+}
+
+double SerialCommunication::hostTime()
+{
+	// Started the first time this is called, the same for all objects and
+	// threads
+	static const QElapsedTimer clock = []() {
+		QElapsedTimer c;
+		c.start();
+
+		return c;
+	}();
+
+	return clock.nsecsElapsed() / 1.0e6;
+}
+
 bool SerialCommunication::openSerial()
 {
 	if (isStreaming()) {
@@ -103,10 +315,25 @@ bool SerialCommunication::openSerial()
 	// Signalling that the port is open
 	emit isConnectedChanged();
 
+	// The board reboots, it will test the bus again. The hardware could also
+	// have changed
+	m_busTestResults.clear();
+	emit busTestResultsChanged();
+	if (m_hardwarePointDim != -1) {
+		m_hardwarePointDim = -1;
+		emit hardwarePointDimChanged();
+	}
+
 	// This is necessary to give time to Arduino to "boot" (the board reboots every time the serial port
 	// is opened, and then there are 0.5 seconds taken by the bootloader)
 	m_arduinoBoot.start(1000);
 
+	// Starting to collect link statistics from scratch
+	resetLinkStatistics();
+	m_linkClock.start();
+	m_lastLinkStatisticsTime = 0;
+	m_linkStatisticsTimer.start();
+
 	return true;
 }
 
@@ -127,47 +354,59 @@ bool SerialCommunication::closeSerial()
 
 		// Setting the battery charge to -1.0
 		setBatteryCharge(-1.0);
+
+		// There are no link statistics without a link
+		m_linkStatisticsTimer.stop();
+		resetLinkStatistics();
 	}
 
 	return true;
 }
 
-bool SerialCommunication::startStream(Sequence* sequence, bool startFromCurrent)
+bool SerialCommunication::startStream(Sequence* sequence, bool startFromCurrent, double startTime)
 {
-	if (!m_serialPort.isOpen()) {
-		qDebug() << "SerialCommunication error: cannot start streaming with a closed serial port";
+	if (!canStartStreaming(sequence)) {
 		return false;
 	}
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot start a new stream while a sequence is already being streamed";
-		return false;
+
+	// Resetting the current point if needed
+	if (!startFromCurrent) {
+		sequence->setCurPoint(0);
 	}
 
-	m_incomingData.clear();
-	m_indexToProcess = 0;
+	beginStream(sequence, QList<SequencePoint>(), startTime);
 
-	// Resetting the pause flag and setting the m_is*Mode flags
-	m_paused = false;
-	m_hardwareQueueFull = false;
-	m_stopping = false;
-	setIsStreamMode(true);
-	setIsImmediateMode(false);
+	return true;
+}
 
-	// Saving the sequence and resetting the current point if needed
-	m_sequence = sequence;
-	if (!startFromCurrent) {
-		m_sequence->setCurPoint(0);
+bool SerialCommunication::startStreamAt(Sequence* sequence, int time)
+{
+	if (!canStartStreaming(sequence)) {
+		return false;
+	}
+	if (sequence->numPoints() == 0) {
+		qDebug() << "SerialCommunication error: cannot start streaming an empty sequence";
+		return false;
 	}
 
-	// Emitting the signal telling that we started streaming
-	emit isStreamingChanged();
-
-	// If the m_arduinoBoot timer is running, we have to wait, otherwise we explicitly call
-	// the arduinoBootFinished() function to start sending the sequence
-	if (!m_arduinoBoot.isActive()) {
-		arduinoBootFinished();
+	// The points to send instead of the one being played at the given time
+	// are computed as the firmware would play the sequence. Their total
+	// time is the remaining time of the original point, unless it is too
+	// short for all of them
+	const Trajectory trajectory(*sequence, m_highResolution);
+	const int pos = trajectory.pointAt(time);
+	int delay = 0;
+	const QList<SequencePoint> firstPoints = trajectory.seekPoints(time, &delay);
+	if (delay > 0) {
+		const QString errorString = QString("Starting at %1 ms, the rest of the sequence is played %2 ms late").arg(time).arg(delay);
+		emit streamError(errorString);
+		qDebug() << "SerialCommunication warning:" << errorString;
 	}
 
+	sequence->setCurPoint(pos);
+
+	beginStream(sequence, firstPoints, -1.0);
+
 	return true;
 }
 
@@ -183,6 +422,10 @@ bool SerialCommunication::pauseStream()
 	}
 
 	m_paused = true;
+	m_pauseHostTime = hostTime();
+
+	// Telling the hardware to stop servos
+	sendData(QByteArray("Z"));
 
 	emit isPausedChanged();
 
@@ -200,8 +443,11 @@ bool SerialCommunication::resumeStream()
 		return false;
 	}
 
-	// Resuming streaming
+	// Resuming streaming. The schedule is delayed by the time spent paused,
+	// the hardware does the same for the points it already has
 	m_paused = false;
+	m_scheduleStart += hostTime() - m_pauseHostTime;
+	sendData(QByteArray("R"));
 
 	emit isPausedChanged();
 
@@ -213,12 +459,7 @@ bool SerialCommunication::resumeStream()
 
 bool SerialCommunication::startImmediate(Sequence* sequence)
 {
-	if (!m_serialPort.isOpen()) {
-		qDebug() << "SerialCommunication error: cannot start streaming with a closed serial port";
-		return false;
-	}
-	if (isStreaming()) {
-		qDebug() << "SerialCommunication error: cannot start a new stream while a sequence is already being streamed";
+	if (!canStartStreaming(sequence)) {
 		return false;
 	}
 
@@ -249,6 +490,77 @@ bool SerialCommunication::startImmediate(Sequence* sequence)
 	return true;
 }
 
+bool SerialCommunication::setServoLimits(int servo, int maxSpeed, int maxAcceleration)
+{
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "SerialCommunication error: cannot set servo limits with a closed serial port";
+		return false;
+	}
+	if ((servo < 0) || (servo > 255)) {
+		qDebug() << "SerialCommunication error: invalid servo index" << servo;
+		return false;
+	}
+
+	maxSpeed = std::min(0xFFFF, std::max(0, maxSpeed));
+	maxAcceleration = std::min(0xFFFF, std::max(0, maxAcceleration));
+
+	QByteArray pkt(6, 0);
+	pkt[0] = 'L';
+	pkt[1] = servo & 0xFF;
+	pkt[2] = (maxSpeed >> 8) & 0xFF;
+	pkt[3] = maxSpeed & 0xFF;
+	pkt[4] = (maxAcceleration >> 8) & 0xFF;
+	pkt[5] = maxAcceleration & 0xFF;
+
+	sendData(pkt);
+
+	return true;
+}
+
+bool SerialCommunication::setFaceExpression(int expression)
+{
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "SerialCommunication error: cannot set the face expression with a closed serial port";
+		return false;
+	}
+	if ((expression < 0) || (expression > 255)) {
+		qDebug() << "SerialCommunication error: invalid face expression" << expression;
+		return false;
+	}
+
+	QByteArray pkt(2, 0);
+	pkt[0] = 'X';
+	pkt[1] = expression & 0xFF;
+
+	sendData(pkt);
+
+	return true;
+}
+
+bool SerialCommunication::showFaceText(QString text)
+{
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "SerialCommunication error: cannot show a text on the face with a closed serial port";
+		return false;
+	}
+
+	// Longer texts would be truncated by the hardware anyway
+	QByteArray t = text.toLatin1();
+	if (t.size() > TextScroller::maxTextLength) {
+		qDebug() << "SerialCommunication warning: the text on the face is truncated to" << TextScroller::maxTextLength << "characters";
+		t = t.left(TextScroller::maxTextLength);
+	}
+
+	QByteArray pkt(2, 0);
+	pkt[0] = 'U';
+	pkt[1] = t.size() & 0xFF;
+	pkt.append(t);
+
+	sendData(pkt);
+
+	return true;
+}
+
 bool SerialCommunication::stop()
 {
 	if (!isStreaming()) {
@@ -259,6 +571,14 @@ bool SerialCommunication::stop()
 	// Setting the stopping flag
 	m_stopping = true;
 
+	// If paused, the hardware stops immediately. We must no longer be paused
+	// to process the sequence finished packet
+	if (m_paused) {
+		m_paused = false;
+
+		emit isPausedChanged();
+	}
+
 	// Sending packet to stop streaming
 	sendData(QByteArray("H"));
 
@@ -274,7 +594,9 @@ bool SerialCommunication::stop()
 void SerialCommunication::handleReadyRead()
 {
 	// Getting data and adding to the buffer
-	m_incomingData.append(m_serialPort.readAll());
+	const QByteArray data = m_serialPort.readAll();
+	m_receivedBytes += data.size();
+	m_incomingData.append(data);
 
 	// Processing received data
 	processReceivedPackets();
@@ -350,22 +672,131 @@ void SerialCommunication::arduinoBootFinished()
 		} else {
 			qFatal("Unknown mode, we should never get here");
 		}
-		// Adding the number of dimension of point to the start packet
-		startPacket.append(m_sequence->pointDim() & 0xFF);
+		// Adding the number of dimension of point to the start packet, together
+		// with the flag for 16 bit positions
+		startPacket.append((m_sequence->pointDim() & ~widePositionsFlag) | (m_highResolution ? widePositionsFlag : 0));
 		sendData(startPacket);
 
-		// Now sending the first sequence packet if present
-		if (m_sequence->curPoint() != -1) {
-			sendData(createSequencePacketForPoint(m_sequence->point()));
+		// We don't know which point the hardware has, the first one is sent
+		// in full
+		m_lastSentValues.clear();
+
+		// In stream mode also setting the playback speed
+		if (isStreamMode()) {
+			sendTimeScale();
 		}
 
-		// If we are in stream mode, we have to move the current point forward
+		// Now sending the first sequence packet if present. If we are in
+		// stream mode, we also have to move the current point forward
 		if (isStreamMode()) {
+			sendNextStreamPoint();
+		} else if (m_sequence->curPoint() != -1) {
+			sendData(createSequencePacketForPoint(m_sequence->point()));
+		}
+	}
+}
+
+bool SerialCommunication::canStartStreaming(const Sequence* sequence)
+{
+	if (!m_serialPort.isOpen()) {
+		qDebug() << "SerialCommunication error: cannot start streaming with a closed serial port";
+		return false;
+	}
+	if (isStreaming()) {
+		qDebug() << "SerialCommunication error: cannot start a new stream while a sequence is already being streamed";
+		return false;
+	}
+	if ((m_hardwarePointDim != -1) && (static_cast<int>(sequence->pointDim()) != m_hardwarePointDim)) {
+		const QString errorString = QString("The sequence has %1 servos, the robot has %2").arg(sequence->pointDim()).arg(m_hardwarePointDim);
+		emit streamError(errorString);
+		qDebug() << "SerialCommunication error:" << errorString;
+		return false;
+	}
+	if (m_scheduledStream && !m_clockSync.synchronized()) {
+		const QString errorString = "The clock of the robot has not been estimated yet, wait a few seconds";
+		emit streamError(errorString);
+		qDebug() << "SerialCommunication error:" << errorString;
+		return false;
+	}
+	if (m_scheduledStream && (m_playbackSpeed < (1.0 / 256.0))) {
+		qDebug() << "SerialCommunication error: cannot start a scheduled stream with zero playback speed";
+		return false;
+	}
+
+	return true;
+}
+
+void SerialCommunication::beginStream(Sequence* sequence, QList<SequencePoint> firstPoints, double startTime)
+{
+	m_incomingData.clear();
+	m_indexToProcess = 0;
+
+	// Resetting the pause flag and setting the m_is*Mode flags
+	m_paused = false;
+	m_hardwareQueueFull = false;
+	m_stopping = false;
+	setIsStreamMode(true);
+	setIsImmediateMode(false);
+
+	// Saving the sequence and the points to send first
+	m_sequence = sequence;
+	m_pendingPoints = firstPoints;
+
+	// The schedule starts with the first point
+	m_scheduleStart = (startTime < 0.0) ? (hostTime() + scheduleLeadTime) : startTime;
+	m_scheduleElapsed = 0;
+
+	// The hardware counts points from the beginning of the stream
+	m_sentStreamPoints = 0;
+	m_underruns.clear();
+	emit underrunsChanged();
+
+	// Emitting the signal telling that we started streaming
+	emit isStreamingChanged();
+
+	// If the m_arduinoBoot timer is running, we have to wait, otherwise we explicitly call
+	// the arduinoBootFinished() function to start sending the sequence
+	if (!m_arduinoBoot.isActive()) {
+		arduinoBootFinished();
+	}
+}
+
+void SerialCommunication::sendNextStreamPoint()
+{
+	if (!m_pendingPoints.isEmpty()) {
+		sendStreamPoint(m_pendingPoints.takeFirst());
+
+		// The current point has been completely sent when there are no
+		// more pending points
+		if (m_pendingPoints.isEmpty()) {
 			incrementCurPoint();
 		}
+	} else {
+		if (m_sequence->curPoint() != -1) {
+			sendStreamPoint(m_sequence->point());
+		}
+		incrementCurPoint();
 	}
 }
 
+void SerialCommunication::sendStreamPoint(const SequencePoint& p)
+{
+	// Remembering which point of the sequence this is, in case the hardware
+	// reports an underrun while waiting for it
+	m_streamPointIndices[m_sentStreamPoints % streamPointIndicesSize] = m_sequence->curPoint();
+	++m_sentStreamPoints;
+
+	// In scheduled streams the point starts when all the previous ones have
+	// been played, at the speed of the stream
+	qint64 startTime = -1;
+	if (m_scheduledStream) {
+		startTime = m_clockSync.hardwareTime(m_scheduleStart + m_scheduleElapsed / m_playbackSpeed);
+		m_scheduleElapsed += p.isPartial() ? pointPlayTime(0, p.duration) : pointPlayTime(p.timeToTarget, p.duration);
+	}
+
+	sendData(createSequencePacketForPoint(p, startTime));
+}
+
 void SerialCommunication::curPointChanged()
 {
 	// Safety check that we are in immediate mode (this slot is only connected in immediate mode)
@@ -378,15 +809,50 @@ void SerialCommunication::curPointChanged()
 	// Sending the current point if present
 	if (m_sequence->curPoint() != -1) {
 		sendData(createSequencePacketForPoint(m_sequence->point()));
+
+		emit immediatePointSent(m_sequence->point());
 	}
 }
 
-QByteArray SerialCommunication::createSequencePacketForPoint(const SequencePoint& p) const
+QByteArray SerialCommunication::createSequencePacketForPoint(const SequencePoint& p, qint64 startTime)
 {
-	QByteArray pkt(5 + p.point.size(), 0);
+	const int dim = p.point.size();
+	const int maskBytes = (dim + 7) / 8;
+	const int positionBytes = m_highResolution ? 2 : 1;
+	const int headerSize = (startTime < 0) ? 6 : 10;
+
+	// The values sent to the hardware
+	QVector<unsigned int> values(dim);
+	for (int c = 0; c < dim; ++c) {
+		values[c] = wireValue(p.point[c], m_highResolution);
+	}
+
+	// The channels whose value must be sent if we use a masked packet. For
+	// partial points these are the updated channels, otherwise the ones
+	// that changed since the last point we sent (all of them if we don't
+	// know what the hardware has)
+	const bool lastKnown = (m_lastSentValues.size() == dim);
+	QVector<bool> toSend(dim, true);
+	int numToSend = 0;
+	for (int c = 0; c < dim; ++c) {
+		if (p.isPartial()) {
+			toSend[c] = p.updatesChannel(c);
+		} else if (lastKnown) {
+			toSend[c] = (values[c] != m_lastSentValues[c]);
+		}
+		if (toSend[c]) {
+			++numToSend;
+		}
+	}
+
+	// Using the smallest packet. Full packets of partial points also have
+	// the channel mask
+	const bool masked = (lastKnown || p.isPartial()) && ((maskBytes + numToSend * positionBytes) < ((p.isPartial() ? maskBytes : 0) + dim * positionBytes));
+	const int maskSize = (masked || p.isPartial()) ? maskBytes : 0;
+	QByteArray pkt(headerSize + maskSize + (masked ? numToSend : dim) * positionBytes, 0);
 
 	// Packet type
-	pkt[0] = 'P';
+	pkt[0] = masked ? 'M' : 'P';
 
 	// Point duration
 	pkt[1] = (p.duration >> 8) & 0xFF;
@@ -396,9 +862,51 @@ QByteArray SerialCommunication::createSequencePacketForPoint(const SequencePoint
 	pkt[3] = (p.timeToTarget >> 8) & 0xFF;
 	pkt[4] = p.timeToTarget & 0xFF;
 
-	// Values
-	for (int c = 0; c < p.point.size(); ++c) {
-		pkt[5 + c] = static_cast<unsigned int>(p.point[c]) & 0xFF;
+	// Options (the interpolation profile, the channel mask and start time
+	// flags)
+	pkt[5] = (p.profile & 0x07) | (p.isPartial() ? channelMaskOption : 0) | ((startTime < 0) ? 0 : scheduledOption);
+
+	// Start time
+	if (startTime >= 0) {
+		for (int b = 0; b < 4; ++b) {
+			pkt[6 + b] = (startTime >> (8 * (3 - b))) & 0xFF;
+		}
+	}
+
+	// Channel mask (in masked packets it is the bitmap of values in the
+	// packet)
+	for (int c = 0; c < maskSize * 8; ++c) {
+		if ((c < dim) && (masked ? toSend[c] : p.updatesChannel(c))) {
+			pkt[headerSize + c / 8] = pkt[headerSize + c / 8] | (1 << (c % 8));
+		}
+	}
+
+	// Values. The hardware keeps the values of the previous point for the
+	// channels not in masked packets
+	int i = headerSize + maskSize;
+	for (int c = 0; c < dim; ++c) {
+		if (!masked || toSend[c]) {
+			if (m_highResolution) {
+				pkt[i++] = (values[c] >> 8) & 0xFF;
+			}
+			pkt[i++] = values[c] & 0xFF;
+		}
+	}
+
+	// Here we also update the values of the hardware. If the point was
+	// masked, values not sent are equal to the last ones (or the channel is
+	// not updated)
+	if (masked && !lastKnown) {
+		// Channels not updated by a partial point have unknown values
+		m_lastSentValues.clear();
+	} else if (masked) {
+		for (int c = 0; c < dim; ++c) {
+			if (toSend[c]) {
+				m_lastSentValues[c] = values[c];
+			}
+		}
+	} else {
+		m_lastSentValues = values;
 	}
 
 	return pkt;
@@ -414,6 +922,9 @@ void SerialCommunication::processReceivedPackets()
 	// If this is true, we only received part of a packet
 	bool partialPacket = false;
 	while ((m_indexToProcess < m_incomingData.size()) && (!partialPacket)) {
+		// Used to count processed packets: all of them are removed from the buffer
+		const int sizeBeforePacket = m_incomingData.size();
+
 		if ((m_incomingData[m_indexToProcess] == 'N') && isStreamMode()) {
 			if (m_paused || m_stopping) {
 				// Skipping this packet, we are paused or stopping
@@ -424,10 +935,7 @@ void SerialCommunication::processReceivedPackets()
 				// Buffer not full, we can send the current point in the sequence and move
 				// the current point forward
 				m_hardwareQueueFull = false;
-				if (m_sequence->curPoint() != -1) {
-					sendData(createSequencePacketForPoint(m_sequence->point()));
-				}
-				incrementCurPoint();
+				sendNextStreamPoint();
 
 				// Removing packet from buffer. The next index to process remains the current one
 				m_incomingData.remove(m_indexToProcess, 1);
@@ -480,6 +988,37 @@ void SerialCommunication::processReceivedPackets()
 					m_incomingData.remove(m_indexToProcess, 2 + msgLength);
 				}
 			}
+		} else if (m_incomingData[m_indexToProcess] == 'V') {
+			// Event packet, checking that the packet is finished and emitting the
+			// signal with the description of the event
+			if (m_incomingData.size() < (m_indexToProcess + 4)) {
+				partialPacket = true;
+			} else {
+				const int code = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
+				const int arg0 = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2]);
+				const int arg1 = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 3]);
+				const QString msg = eventMessage(code, arg0, arg1);
+
+				// The hardware dropped a point, so we no longer know its
+				// positions and the next packet must not be masked. In
+				// immediate mode the current point is sent again at once,
+				// otherwise the robot would only be corrected by the next
+				// change
+				if (code == PointBufferFullEvent) {
+					m_lastSentValues.clear();
+
+					if (isImmediateMode() && (m_sequence->curPoint() != -1)) {
+						sendData(createSequencePacketForPoint(m_sequence->point()));
+					}
+				}
+
+				emit hardwareEvent(code, msg);
+				qDebug() << "Event packet, code" << code << "-" << msg;
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 4);
+			}
 		} else if (m_incomingData[m_indexToProcess] == 'B') {
 			// Battery packet, checking that the packet is finished and updating the charge
 			if (m_incomingData.size() < (m_indexToProcess + 2)) {
@@ -495,6 +1034,163 @@ void SerialCommunication::processReceivedPackets()
 				// the current one
 				m_incomingData.remove(m_indexToProcess, 2);
 			}
+		} else if (m_incomingData[m_indexToProcess] == 'C') {
+			// Saturation counts packet, checking that the packet is finished and
+			// updating counts
+			if (m_incomingData.size() < (m_indexToProcess + 2)) {
+				partialPacket = true;
+			} else {
+				// Reading the number of counts
+				const int numCounts = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
+
+				// Checking we have the whole packet
+				if (m_incomingData.size() < (m_indexToProcess + 2 + 2 * numCounts)) {
+					partialPacket = true;
+				} else {
+					m_saturationCounts.clear();
+					for (int i = 0; i < numCounts; ++i) {
+						const int hi = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2 + 2 * i]);
+						const int lo = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 3 + 2 * i]);
+						m_saturationCounts.append((hi << 8) + lo);
+					}
+
+					emit saturationCountsChanged();
+
+					// Removing packet from our buffer. The next index to process
+					// remains the current one
+					m_incomingData.remove(m_indexToProcess, 2 + 2 * numCounts);
+				}
+			}
+		} else if (m_incomingData[m_indexToProcess] == 'W') {
+			// Bus statistics packet, checking that the packet is finished and
+			// updating statistics
+			if (m_incomingData.size() < (m_indexToProcess + 8)) {
+				partialPacket = true;
+			} else {
+				// Reading all values, 2 bytes values have the most significant byte first
+				int values[4];
+				values[0] = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
+				for (int i = 1; i < 4; ++i) {
+					const int hi = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2 * i]);
+					const int lo = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2 * i + 1]);
+					values[i] = (hi << 8) + lo;
+				}
+
+				m_busStatistics.clear();
+				m_busStatistics["maxQueued"] = values[0];
+				m_busStatistics["completed"] = values[1];
+				m_busStatistics["failed"] = values[2];
+				m_busStatistics["stalls"] = values[3];
+
+				emit busStatisticsChanged();
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 8);
+			}
+		} else if (m_incomingData[m_indexToProcess] == 'K') {
+			// Point dimension packet, checking that the packet is finished and
+			// updating the dimension
+			if (m_incomingData.size() < (m_indexToProcess + 2)) {
+				partialPacket = true;
+			} else {
+				const int pointDim = static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]);
+
+				if (pointDim != m_hardwarePointDim) {
+					m_hardwarePointDim = pointDim;
+					emit hardwarePointDimChanged();
+				}
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 2);
+			}
+		} else if (m_incomingData[m_indexToProcess] == 'Y') {
+			// Bus test packet, checking that the packet is finished and adding
+			// the result
+			if (m_incomingData.size() < (m_indexToProcess + 5)) {
+				partialPacket = true;
+			} else {
+				const int frequency = (static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]) << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2]);
+				const int transactionsPerSecond = (static_cast<unsigned char>(m_incomingData[m_indexToProcess + 3]) << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + 4]);
+
+				QVariantMap result;
+				result["frequency"] = frequency;
+				result["transactionsPerSecond"] = transactionsPerSecond;
+				m_busTestResults.append(result);
+
+				emit busTestResultsChanged();
+				qDebug() << "I2C bus test at" << frequency << "kHz:" << transactionsPerSecond << "transactions per second";
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 5);
+			}
+		} else if (m_incomingData[m_indexToProcess] == 'O') {
+			// Underrun packet, checking that the packet is finished and adding the
+			// underrun
+			if (m_incomingData.size() < (m_indexToProcess + 11)) {
+				partialPacket = true;
+			} else {
+				const int count = (static_cast<unsigned char>(m_incomingData[m_indexToProcess + 1]) << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + 2]);
+				const int point = (static_cast<unsigned char>(m_incomingData[m_indexToProcess + 3]) << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + 4]);
+				quint32 time = 0;
+				for (int i = 5; i < 9; ++i) {
+					time = (time << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + i]);
+				}
+				const int duration = (static_cast<unsigned char>(m_incomingData[m_indexToProcess + 9]) << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + 10]);
+
+				m_hardwareUnderruns = count;
+
+				// The point is only known if we are still streaming the
+				// sequence (the packet could arrive after the stream ended)
+				if (isStreamMode()) {
+					QVariantMap underrun;
+					underrun["point"] = m_streamPointIndices[point % streamPointIndicesSize];
+					underrun["time"] = time;
+					underrun["duration"] = duration;
+					m_underruns.append(underrun);
+
+					emit underrunsChanged();
+				}
+				qDebug() << "Buffer underrun at point" << point << "of the stream for" << duration << "ms";
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 11);
+			}
+		} else if (m_incomingData[m_indexToProcess] == 'Q') {
+			// Pong packet, checking that the packet is finished and storing the
+			// round trip time and the clock of the hardware if this is the
+			// answer to the last ping
+			if (m_incomingData.size() < (m_indexToProcess + 9)) {
+				partialPacket = true;
+			} else {
+				quint32 timestamp = 0;
+				quint32 hardwareTime = 0;
+				for (int i = 1; i < 5; ++i) {
+					timestamp = (timestamp << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + i]);
+					hardwareTime = (hardwareTime << 8) + static_cast<unsigned char>(m_incomingData[m_indexToProcess + i + 4]);
+				}
+
+				// Pongs arriving after the statistics update have already been
+				// counted as lost
+				if (m_pingPending && (timestamp == m_pendingPingTimestamp)) {
+					m_pingPending = false;
+
+					// The difference is correct even if the timestamp wrapped around
+					m_roundTripTimes.append((linkTimestamp() - timestamp) / 1000.0);
+					if (m_roundTripTimes.size() > maxRoundTripTimes) {
+						m_roundTripTimes.removeFirst();
+					}
+
+					m_clockSync.addSample(m_pendingPingHostTime, hostTime(), hardwareTime);
+				}
+
+				// Removing packet from our buffer. The next index to process
+				// remains the current one
+				m_incomingData.remove(m_indexToProcess, 9);
+			}
 		} else {
 			if ((m_incomingData[m_indexToProcess] == 'N') || (m_incomingData[m_indexToProcess] == 'F')) {
 				qDebug() << "Received spurious N or F packet";
@@ -502,11 +1198,17 @@ void SerialCommunication::processReceivedPackets()
 				const QString errorString = QString("Received unknown or invalid packet type %1 (ascii %2)").arg(static_cast<unsigned int>(m_incomingData[m_indexToProcess])).arg(m_incomingData[m_indexToProcess]);
 				emit streamError(errorString);
 				qDebug() << errorString;
+
+				++m_parseErrors;
 			}
 
 			// Removing the unknown character. The next index to process remains the current one
 			m_incomingData.remove(m_indexToProcess, 1);
 		}
+
+		if (m_incomingData.size() < sizeBeforePacket) {
+			++m_receivedPackets;
+		}
 	}
 }
 
@@ -525,6 +1227,7 @@ void SerialCommunication::sequenceStreamEnded()
 	m_paused = false;
 	m_hardwareQueueFull = false;
 	m_stopping = false;
+	m_pendingPoints.clear();
 	setIsStreamMode(false);
 	setIsImmediateMode(false);
 
@@ -572,6 +1275,11 @@ void SerialCommunication::sendData(const QByteArray& dataToSend)
 	} else if (bytesWritten != dataToSend.size()) {
 		qDebug() << "Cannot write all data";
 	}
+
+	if (bytesWritten > 0) {
+		++m_sentPackets;
+		m_sentBytes += bytesWritten;
+	}
 }
 
 void SerialCommunication::setIsStreamMode(bool v)
@@ -604,3 +1312,97 @@ void SerialCommunication::setBatteryCharge(float v)
 		emit batteryChargeChanged();
 	}
 }
+
+void SerialCommunication::sendTimeScale()
+{
+	// The speed is at most 255, so this always fits in two bytes
+	const unsigned int scale = static_cast<unsigned int>(m_playbackSpeed * 256.0 + 0.5);
+
+	QByteArray pkt(3, 0);
+	pkt[0] = 'T';
+	pkt[1] = (scale >> 8) & 0xFF;
+	pkt[2] = scale & 0xFF;
+
+	sendData(pkt);
+}
+
+void SerialCommunication::updateLinkStatistics()
+{
+	const qint64 now = m_linkClock.elapsed();
+	const double seconds = std::max<qint64>(1, now - m_lastLinkStatisticsTime) / 1000.0;
+	m_lastLinkStatisticsTime = now;
+
+	// The ping still pending was sent at the previous update, too long ago
+	if (m_pingPending) {
+		++m_lostPings;
+		m_pingPending = false;
+	}
+
+	m_linkStatistics.clear();
+	if (!m_roundTripTimes.isEmpty()) {
+		QList<double> sorted = m_roundTripTimes;
+		std::sort(sorted.begin(), sorted.end());
+
+		m_linkStatistics["rttMin"] = sorted.first();
+		m_linkStatistics["rttMedian"] = percentile(sorted, 50.0);
+		m_linkStatistics["rttP95"] = percentile(sorted, 95.0);
+		m_linkStatistics["rttP99"] = percentile(sorted, 99.0);
+		m_linkStatistics["rttMax"] = sorted.last();
+	}
+	m_linkStatistics["receivedPacketsPerSecond"] = m_receivedPackets / seconds;
+	m_linkStatistics["receivedBytesPerSecond"] = m_receivedBytes / seconds;
+	m_linkStatistics["sentPacketsPerSecond"] = m_sentPackets / seconds;
+	m_linkStatistics["sentBytesPerSecond"] = m_sentBytes / seconds;
+	m_linkStatistics["lostPings"] = m_lostPings;
+	m_linkStatistics["parseErrors"] = m_parseErrors;
+	m_linkStatistics["underruns"] = m_hardwareUnderruns;
+	m_linkStatistics["clockSynchronized"] = m_clockSync.synchronized();
+	if (m_clockSync.synchronized()) {
+		m_linkStatistics["clockSkewPpm"] = m_clockSync.skewPpm();
+		m_linkStatistics["clockError"] = m_clockSync.maxError();
+	}
+
+	m_receivedPackets = 0;
+	m_receivedBytes = 0;
+	m_sentPackets = 0;
+	m_sentBytes = 0;
+
+	emit linkStatisticsChanged();
+
+	// Pinging only after Arduino has booted, before it would not answer
+	if (!m_arduinoBoot.isActive()) {
+		m_pendingPingTimestamp = linkTimestamp();
+		m_pendingPingHostTime = hostTime();
+		m_pingPending = true;
+
+		QByteArray pkt(5, 0);
+		pkt[0] = 'G';
+		for (int i = 0; i < 4; ++i) {
+			pkt[i + 1] = (m_pendingPingTimestamp >> (8 * (3 - i))) & 0xFF;
+		}
+
+		sendData(pkt);
+	}
+}
+
+void SerialCommunication::resetLinkStatistics()
+{
+	m_pingPending = false;
+	m_roundTripTimes.clear();
+	m_receivedPackets = 0;
+	m_receivedBytes = 0;
+	m_sentPackets = 0;
+	m_sentBytes = 0;
+	m_lostPings = 0;
+	m_parseErrors = 0;
+	m_hardwareUnderruns = 0;
+	m_clockSync.clear();
+
+	m_linkStatistics.clear();
+	emit linkStatisticsChanged();
+}
+
+quint32 SerialCommunication::linkTimestamp() const
+{
+	return static_cast<quint32>(m_linkClock.nsecsElapsed() / 1000);
+}
@@ -26,8 +26,13 @@
 #include <QByteArray>
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVariantList>
+#include <QVariantMap>
 #include <memory>
 #include "sequence.h"
+#include "clocksync.h"
 
 /**
  * \brief The class handling the communication with Arduino through the serial
@@ -39,13 +44,16 @@
  * using the openSerial() function.
  *
  * This class has two functionining modalities: stream and immediate. In stream
- * mode it is possible to pause and resume the stream, though the buffering
- * performed by the Arduino board prevents a precise stop. The startStream()
+ * mode it is possible to pause and resume the stream (the hardware freezes
+ * servos where they are as soon as the pause packet is received) and to change
+ * the playback speed without sending points again. The startStream()
  * function starts the stream modality, which must be terminated using the
  * stop() function. It is possible to decide whether the sequence should be
  * played once (i.e. streaming stops as soon as the last point is reached) or
  * continuously (i.e. the sequnce is restarted from the beginning after the last
- * point is reached). The startImmediate() function starts the immediate
+ * point is reached). The startStreamAt() function also starts the stream
+ * modality, but begins playing the sequence at an arbitrary time, even in the
+ * middle of a movement between two points. The startImmediate() function starts the immediate
  * modality, which terminates when the stop() function is called. When in
  * immediate mode, this connects to the curPointChanged() signal of the stream,
  * thus sending a new command every time the current point in the sequence
@@ -59,16 +67,31 @@
  * following. The packets the PC may send to the hardware are the following
  * ones:
  *	- sequence packet
+ *	- masked sequence packet
  *	- start sequence
  *	- start immediate mode
  *	- stop
+ *	- pause
+ *	- resume
+ *	- time scale
+ *	- servo limits
+ *	- face expression
+ *	- face text
+ *	- ping
  *
  * The packes the hardware may send to the PC are the following ones:
  *	- sequence buffer not full
  *	- sequence buffer full
  *	- sequence finished
  *	- debug packet
+ *	- event packet
  *	- battery charge packet
+ *	- saturation counts packet
+ *	- bus statistics packet
+ *	- bus test packet
+ *	- point dimension packet
+ *	- pong
+ *	- underrun packet
  *
  * The "start sequence" and "start immediate mode" packets tell the hardware in
  * which modality it should work. The "start sequence" makes the hardware expect
@@ -92,16 +115,47 @@
  *
  * The debug packet is used by the hardware for debugging purpouse. It contains
  * a string of maximum length 255 bytes which is simply displayed (no other
- * action is performed). The battery charge packet is used to communicate the
- * current charge of batteries. It could be sent at any time.
+ * action is performed). The firmware only sends it when compiled with
+ * DEBUG_PACKETS: errors and other events are sent with event packets, which
+ * only carry a code (see eventcodes.h in the firmware) turned into a message
+ * here. The battery charge packet is used to communicate the
+ * current charge of batteries. It could be sent at any time, usually only
+ * when the charge changes (and at least once every few seconds).
  *
  * Here is the detailed description of every packet in the protocol.
  *
  * "sequence packet"
  * the character 'P' (1 byte) - step duration (2 bytes, milliseconds, most
  * significant byte first) - step time to target (2 bytes, milliseconds, most
- * significant byte first) - positions (numElements bytes, one byte per point
- * dimension)
+ * significant byte first) - options (1 byte, the lowest three bits are the
+ * interpolation profile as in InterpolationProfile, bit 3 is set for partial
+ * points, bit 4 for scheduled points, the others must be 0) - start time (only
+ * for scheduled points, 4 bytes, milliseconds of the clock of the hardware,
+ * most significant byte first) - channel mask (only for partial points,
+ * (numElements + 7) / 8 bytes, bit (i % 8) of byte (i / 8) is set if channel i
+ * is updated) - positions (numElements bytes, one byte per point dimension)
+ *
+ * A partial point only moves the channels in its mask and lasts "step
+ * duration" milliseconds from its beginning, without waiting for the channels
+ * to reach the target: channels keep moving while the following points are
+ * played, so that independent limbs can move with different timings
+ *
+ * A scheduled point starts at its start time instead of when the previous
+ * point ends (which is cut short or extended). Points that arrive late are
+ * caught up or skipped, depending on how the firmware is configured. The PC
+ * computes start times from the clock of the hardware it estimates with
+ * ping packets (see ClockSync)
+ *
+ * "masked sequence packet" (a sequence point with only some positions. The
+ * missing positions are those of the previous point sent. The PC uses it
+ * instead of the sequence packet when it is smaller)
+ * the character 'M' (1 byte) - step duration (2 bytes) - step time to target
+ * (2 bytes) - options (1 byte) - start time (only for scheduled points, 4
+ * bytes) - positions mask ((numElements + 7) / 8 bytes,
+ * bit (i % 8) of byte (i / 8) is set if the position of channel i is in the
+ * packet) - positions (1 byte for each bit set in the mask, in channel order).
+ * Duration, time to target and options are as in the sequence packet. Partial
+ * points update the channels whose position is in the packet
  *
  * "start sequence" (numElements is the dimension of each point of the sequence)
  * the character 'S' (1 byte) - numElements (1 byte)
@@ -110,9 +164,50 @@
  * sequence)
  * the character 'I' (1 byte) - numElements (1 byte)
  *
+ * In start packets the highest bit of numElements is set to use 16 bit
+ * positions in sequence packets: each position is then 2 bytes long, most
+ * significant byte first, with 8 fractional bits (i.e. 256 times the value in
+ * the sequence). Without the bit each position is 1 byte long
+ *
  * "stop"
  * the character 'H' (1 byte)
  *
+ * "pause" (servos are stopped in their current position and the time of the
+ * current point no longer advances. If a stop packet is received while paused,
+ * the sequence is immediately terminated)
+ * the character 'Z' (1 byte)
+ *
+ * "resume" (continues playing after a pause packet)
+ * the character 'R' (1 byte)
+ *
+ * "time scale" (the speed at which all points are played, including those
+ * already buffered. This is a fixed point number with 8 fractional bits, 256
+ * being the normal speed)
+ * the character 'T' (1 byte) - time scale (2 bytes, most significant byte
+ * first)
+ *
+ * "servo limits" (the maximum speed and acceleration of a servo, 0 means no
+ * limit. This can be sent at any time)
+ * the character 'L' (1 byte) - servo index (1 byte) - maximum speed (2 bytes,
+ * positions per second, most significant byte first) - maximum acceleration
+ * (2 bytes, positions per second squared, most significant byte first)
+ *
+ * "face expression" (starts the animation of an expression on the face: 0
+ * smile, 1 blink, 2 talk, 3 sad, 4 surprised, 5 sleep. This can be sent at any
+ * time)
+ * the character 'X' (1 byte) - expression (1 byte)
+ *
+ * "face text" (scrolls a text on the face, then the animation of the
+ * expression starts again. The hardware only keeps the first 24 characters,
+ * an empty text stops scrolling. This can be sent at any time)
+ * the character 'U' (1 byte) - length of text (1 byte, at most 254) - text
+ * (length of text bytes, ASCII)
+ *
+ * "ping" (the hardware answers with a pong packet as soon as possible. This
+ * can be sent at any time)
+ * the character 'G' (1 byte) - timestamp (4 bytes, opaque for the hardware,
+ * here microseconds since the port was opened, most significant byte first)
+ *
  * "sequence buffer not full"
  * the character 'N' (1 byte)
  *
@@ -126,9 +221,58 @@
  * the character 'D' (1 byte) - length of message (1 byte) - message (length of
  * message elements)
  *
+ * "event packet" (the meaning of the arguments depends on the code)
+ * the character 'V' (1 byte) - code (1 byte) - first argument (1 byte) -
+ * second argument (1 byte)
+ *
  * "battery charge packet" (battery charge is 0 to indicate depleted battery,
  * 255 for fully charged batteries)
  * the character 'B' (1 byte) - battery charge (1 byte)
+ *
+ * "saturation counts packet" (how many times the position of each servo was
+ * limited because of the servo limits since the beginning of the sequence.
+ * Sent periodically when counts change)
+ * the character 'C' (1 byte) - numElements (1 byte) - counts (2 bytes per
+ * element, most significant byte first)
+ *
+ * "bus statistics packet" (the state of the queue of transactions to the I²C
+ * devices, sent periodically. The maximum queue length is in bytes and refers
+ * to the time since the previous packet, the other values are counters that
+ * wrap around)
+ * the character 'W' (1 byte) - maximum queue length (1 byte) - completed
+ * transactions (2 bytes) - failed transactions (2 bytes) - stalls (2 bytes,
+ * how many times the queue was full). 2 bytes values have the most
+ * significant byte first
+ *
+ * "bus test packet" (sent at startup for each I²C bus frequency tested, from
+ * the fastest. The first frequency passing the test is used)
+ * the character 'Y' (1 byte) - frequency (2 bytes, kHz, most significant byte
+ * first) - transactions per second (2 bytes, most significant byte first, 0
+ * if the test failed)
+ *
+ * "point dimension packet" (the number of servos of the robot, i.e. the
+ * numElements the hardware expects in start packets. Sent periodically)
+ * the character 'K' (1 byte) - numElements (1 byte)
+ *
+ * "pong packet" (the answer to a ping packet)
+ * the character 'Q' (1 byte) - timestamp (4 bytes, those of the ping packet)
+ * - clock of the hardware (4 bytes, milliseconds since the hardware started,
+ * most significant byte first)
+ *
+ * "underrun packet" (the sequence buffer ran empty while streaming, so servos
+ * were frozen waiting for the next point. Sent when that point arrives, so the
+ * end of a stream is never reported as an underrun)
+ * the character 'O' (1 byte) - underruns since the hardware started (2 bytes)
+ * - index of the point the hardware waited for, counting from the first
+ * point of the stream (2 bytes) - time the buffer ran empty (4 bytes,
+ * milliseconds since the hardware started) - how long the buffer was empty
+ * (2 bytes, milliseconds). Values have the most significant byte first, the
+ * counters wrap around
+ *
+ * Pings are sent periodically while the port is open and are used together
+ * with the count of bytes and packets in both directions to compute the link
+ * statistics (see linkStatistics()) and to estimate the clock of the hardware
+ * for scheduled points
  */
 class SerialCommunication : public QObject
 {
@@ -141,7 +285,25 @@ class SerialCommunication : public QObject
 	Q_PROPERTY(bool isStreamMode READ isStreamMode NOTIFY isStreamModeChanged)
 	Q_PROPERTY(bool isImmediateMode READ isImmediateMode NOTIFY isImmediateModeChanged)
 	Q_PROPERTY(bool isPaused READ isPaused NOTIFY isPausedChanged)
+	Q_PROPERTY(double playbackSpeed READ playbackSpeed WRITE setPlaybackSpeed NOTIFY playbackSpeedChanged)
+	Q_PROPERTY(bool highResolution READ highResolution WRITE setHighResolution NOTIFY highResolutionChanged)
 	Q_PROPERTY(float batteryCharge READ batteryCharge NOTIFY batteryChargeChanged)
+	Q_PROPERTY(QVariantList saturationCounts READ saturationCounts NOTIFY saturationCountsChanged)
+	Q_PROPERTY(QVariantMap busStatistics READ busStatistics NOTIFY busStatisticsChanged)
+	Q_PROPERTY(QVariantList busTestResults READ busTestResults NOTIFY busTestResultsChanged)
+	Q_PROPERTY(int hardwarePointDim READ hardwarePointDim NOTIFY hardwarePointDimChanged)
+	Q_PROPERTY(QVariantMap linkStatistics READ linkStatistics NOTIFY linkStatisticsChanged)
+	Q_PROPERTY(QVariantList underruns READ underruns NOTIFY underrunsChanged)
+	Q_PROPERTY(bool scheduledStream READ scheduledStream WRITE setScheduledStream NOTIFY scheduledStreamChanged)
+
+public:
+	/**
+	 * \brief How long after the start of a scheduled stream the first point
+	 *        starts if no time is given, in milliseconds
+	 *
+	 * This leaves time to fill the buffer of the hardware
+	 */
+	static const int scheduleLeadTime = 300;
 
 public:
 	/**
@@ -233,6 +395,42 @@ public:
 	 */
 	void setOneShotSequence(bool oneShot);
 
+	/**
+	 * \brief Returns true if points are streamed with a start time
+	 *
+	 * \return true if points are streamed with a start time
+	 */
+	bool scheduledStream() const
+	{
+		return m_scheduledStream;
+	}
+
+	/**
+	 * \brief Sets whether points are streamed with a start time
+	 *
+	 * In scheduled streams each point is sent with the time it must start
+	 * on the clock of the hardware, computed from the start time of the
+	 * stream, the time each point is played and the playback speed. This
+	 * way errors don't accumulate over long sequences and several robots
+	 * can be kept in sync with each other or with other media. A scheduled
+	 * stream can only start once the clock of the hardware has been
+	 * estimated (a few seconds after the port is opened) and its playback
+	 * speed cannot be changed. After a pause, the robot catches up with the
+	 * schedule. This cannot be changed while streaming
+	 * \param scheduled if true points are streamed with a start time
+	 */
+	void setScheduledStream(bool scheduled);
+
+	/**
+	 * \brief Returns the current time of the clock used for the schedule
+	 *        of streams
+	 *
+	 * This is a monotonic clock shared by all objects of this class, so
+	 * that streams to different robots can be started at the same time
+	 * \return the time in milliseconds since an arbitrary reference
+	 */
+	static double hostTime();
+
 	/**
 	 * \brief Opens the serial port
 	 *
@@ -262,15 +460,88 @@ public:
 	 *                 stop() function is called or the sequence is finished
 	 * \param startFromCurrent if true the streaming starts from the current
 	 *                         point, otherwise starts from the beginning
+	 * \param startTime the time (see hostTime()) at which the first point
+	 *                  starts in scheduled streams. If negative, the first
+	 *                  point starts scheduleLeadTime milliseconds from now.
+	 *                  This is ignored if scheduledStream() is false
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool startStream(Sequence* sequence, bool startFromCurrent = false, double startTime = -1.0);
+
+	/**
+	 * \brief Starts streaming the sequence from the given time
+	 *
+	 * The point being played at the given time is replaced by the points
+	 * returned by Trajectory::seekPoints(), which compute the pose the
+	 * robot has at that time exactly as the firmware would and move the
+	 * servos whose segments are still running (also those started by
+	 * previous partial points) to their targets. Streaming then continues
+	 * from the next point as in startStream(). The pose before the
+	 * sequence is taken to be its first point, so seeking in the first
+	 * point moves the robot directly to its target. If what remains of the
+	 * point being played is too short for the replacing points, the rest
+	 * of the sequence is played late and streamError() is emitted (the
+	 * stream is started anyway). As for startStream(), the current point
+	 * of the sequence is updated as data is streamed
+	 * \param sequence the sequence to send. It must remain valid until the
+	 *                 stop() function is called or the sequence is finished
+	 * \param time the time in milliseconds from the beginning of the
+	 *             sequence at which playing should start (see
+	 *             Sequence::pointStartTime())
 	 * \return false in case of error
 	 */
-	Q_INVOKABLE bool startStream(Sequence* sequence, bool startFromCurrent = false);
+	Q_INVOKABLE bool startStreamAt(Sequence* sequence, int time);
+
+	/**
+	 * \brief Returns the speed at which the sequence is played
+	 *
+	 * \return the speed at which the sequence is played (1.0 is the normal
+	 *         speed)
+	 */
+	double playbackSpeed() const
+	{
+		return m_playbackSpeed;
+	}
+
+	/**
+	 * \brief Sets the speed at which the sequence is played
+	 *
+	 * If a sequence is being streamed, the new speed is immediately sent
+	 * to the hardware and applies to points already sent, too. The speed
+	 * is sent with a resolution of 1/256. It cannot be changed while a
+	 * scheduled stream is being streamed
+	 * \param speed the new speed (1.0 is the normal speed). This is
+	 *              clamped between 0 and 255
+	 */
+	void setPlaybackSpeed(double speed);
+
+	/**
+	 * \brief Returns true if positions are sent with 16 bits
+	 *
+	 * \return true if positions are sent with 16 bits
+	 */
+	bool highResolution() const
+	{
+		return m_highResolution;
+	}
+
+	/**
+	 * \brief Sets whether positions are sent with 16 bits
+	 *
+	 * With 16 bits the fractional part of positions is also sent (with a
+	 * resolution of 1/256), otherwise positions are truncated. This cannot
+	 * be changed while streaming
+	 * \param highResolution if true positions are sent with 16 bits
+	 */
+	void setHighResolution(bool highResolution);
 
 	/**
 	 * \brief Pauses streaming data
 	 *
-	 * This simply temporarily stops sending data. To restart and continue
-	 * from the point where sending was interrupted, call resumeStream()
+	 * This stops sending data and tells the hardware to stop servos where
+	 * they are. To restart and continue from the point where the sequence
+	 * was interrupted, call resumeStream(). In scheduled streams all
+	 * points are delayed by the time spent paused
 	 * \return false in case of error
 	 */
 	Q_INVOKABLE bool pauseStream();
@@ -295,6 +566,41 @@ public:
 	 */
 	Q_INVOKABLE bool startImmediate(Sequence* sequence);
 
+	/**
+	 * \brief Sets the maximum speed and acceleration of a servo
+	 *
+	 * The limits are kept by the hardware until it is reset. They can be
+	 * changed at any time, also while streaming
+	 * \param servo the index of the servo
+	 * \param maxSpeed the maximum speed in positions per second (0 means no
+	 *                 limit)
+	 * \param maxAcceleration the maximum acceleration in positions per
+	 *                        second squared (0 means no limit)
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool setServoLimits(int servo, int maxSpeed, int maxAcceleration);
+
+	/**
+	 * \brief Changes the expression of the face
+	 *
+	 * This can be called at any time, also while streaming
+	 * \param expression the expression (see the face expression packet)
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool setFaceExpression(int expression);
+
+	/**
+	 * \brief Scrolls a text on the face
+	 *
+	 * This can be called at any time, also while streaming. The hardware
+	 * keeps at most TextScroller::maxTextLength (24) characters, longer
+	 * texts are truncated here
+	 * \param text the text to show, in Latin-1. An empty text stops
+	 *             scrolling
+	 * \return false in case of error
+	 */
+	Q_INVOKABLE bool showFaceText(QString text);
+
 	/**
 	 * \brief Stops sending the sequence
 	 *
@@ -366,6 +672,98 @@ public:
 		return m_batteryCharge;
 	}
 
+	/**
+	 * \brief Returns how many times the position of each servo was limited
+	 *
+	 * These are the counts in the last saturation counts packet received
+	 * from the hardware (they refer to the last streamed sequence). The
+	 * list is empty if no packet has been received yet
+	 * \return the saturation count of each servo
+	 */
+	QVariantList saturationCounts() const
+	{
+		return m_saturationCounts;
+	}
+
+	/**
+	 * \brief Returns the statistics of the I²C queue of the hardware
+	 *
+	 * These are the values in the last bus statistics packet received, with
+	 * keys "maxQueued", "completed", "failed" and "stalls". The map is empty
+	 * if no packet has been received yet
+	 * \return the statistics of the I²C queue of the hardware
+	 */
+	QVariantMap busStatistics() const
+	{
+		return m_busStatistics;
+	}
+
+	/**
+	 * \brief Returns the results of the I²C bus tests done by the hardware
+	 *        at startup
+	 *
+	 * There is one element per bus test packet received since the serial
+	 * port was opened, each one a map with keys "frequency" (in kHz) and
+	 * "transactionsPerSecond" (0 if the test failed)
+	 * \return the results of the I²C bus tests
+	 */
+	QVariantList busTestResults() const
+	{
+		return m_busTestResults;
+	}
+
+	/**
+	 * \brief Returns the dimension of points the hardware expects
+	 *
+	 * Sequences with a different dimension cannot be streamed
+	 * \return the dimension of points reported by the hardware or -1 if we
+	 *         have not received it yet
+	 */
+	int hardwarePointDim() const
+	{
+		return m_hardwarePointDim;
+	}
+
+	/**
+	 * \brief Returns the statistics of the serial link
+	 *
+	 * The map is updated once per second while the port is open. Round trip
+	 * times are in milliseconds and are computed on the last pongs received
+	 * (keys "rttMin", "rttMedian", "rttP95", "rttP99", "rttMax", missing if
+	 * no pong has been received yet). The rates refer to the last second
+	 * (keys "receivedPacketsPerSecond", "receivedBytesPerSecond",
+	 * "sentPacketsPerSecond" and "sentBytesPerSecond"). The counters are
+	 * since the port was opened: "lostPings" is the number of pings without
+	 * a pong within a second, "parseErrors" the number of received bytes
+	 * that are not the start of a known packet and "underruns" the number
+	 * of buffer underruns of the hardware. "clockSynchronized" is true once
+	 * the clock of the hardware has been estimated: then "clockSkewPpm" is
+	 * how faster the clock of the hardware runs (in parts per million) and
+	 * "clockError" the maximum error of the estimate in milliseconds
+	 * \return the statistics of the serial link
+	 */
+	QVariantMap linkStatistics() const
+	{
+		return m_linkStatistics;
+	}
+
+	/**
+	 * \brief Returns the buffer underruns of the hardware during the last
+	 *        stream
+	 *
+	 * There is one element per underrun packet received, each one a map
+	 * with keys "point" (the index in the sequence of the point the
+	 * hardware waited for), "time" (when the buffer ran empty, in
+	 * milliseconds since the hardware started) and "duration" (how long
+	 * servos were frozen in milliseconds). The list is cleared when a new
+	 * stream starts
+	 * \return the buffer underruns of the last stream
+	 */
+	QVariantList underruns() const
+	{
+		return m_underruns;
+	}
+
 signals:
 	/**
 	 * \brief The signal emitted when the serial port name changes
@@ -407,6 +805,16 @@ signals:
 	 */
 	void isPausedChanged();
 
+	/**
+	 * \brief The signal emitted when the playback speed changes
+	 */
+	void playbackSpeedChanged();
+
+	/**
+	 * \brief The signal emitted when the highResolution property changes
+	 */
+	void highResolutionChanged();
+
 	/**
 	 * \brief The signal emitted if there is an error writing or reading
 	 *        from the serial port
@@ -423,11 +831,63 @@ signals:
 	 */
 	void debugMessage(QString msg);
 
+	/**
+	 * \brief The signal emitted when we receive an event from the hardware
+	 *
+	 * \param code the code of the event (see EventCode in eventcodes.h)
+	 * \param msg the description of the event
+	 */
+	void hardwareEvent(int code, QString msg);
+
 	/**
 	 * \brief The signal emitted when the battery charge changes
 	 */
 	void batteryChargeChanged();
 
+	/**
+	 * \brief The signal emitted when we receive new saturation counts
+	 */
+	void saturationCountsChanged();
+
+	/**
+	 * \brief The signal emitted when we receive new bus statistics
+	 */
+	void busStatisticsChanged();
+
+	/**
+	 * \brief The signal emitted when we receive a new bus test result
+	 */
+	void busTestResultsChanged();
+
+	/**
+	 * \brief The signal emitted when the dimension of points the hardware
+	 *        expects changes
+	 */
+	void hardwarePointDimChanged();
+
+	/**
+	 * \brief The signal emitted when the statistics of the serial link are
+	 *        updated
+	 */
+	void linkStatisticsChanged();
+
+	/**
+	 * \brief The signal emitted when the list of underruns changes
+	 */
+	void underrunsChanged();
+
+	/**
+	 * \brief The signal emitted when the scheduledStream property changes
+	 */
+	void scheduledStreamChanged();
+
+	/**
+	 * \brief The signal emitted when a point is sent in immediate mode
+	 *
+	 * \param point the point sent to the hardware
+	 */
+	void immediatePointSent(const SequencePoint& point);
+
 private slots:
 	/**
 	 * \brief The slot called when there is data ready to be read
@@ -464,18 +924,70 @@ private slots:
 	 */
 	void curPointChanged();
 
+	/**
+	 * \brief The slot called periodically while the port is open to update
+	 *        the statistics of the serial link
+	 *
+	 * This also sends the next ping packet
+	 */
+	void updateLinkStatistics();
+
 private:
+	/**
+	 * \brief Checks whether a new stream can be started
+	 *
+	 * \param sequence the sequence to stream
+	 * \return false if the serial port is closed, we are already streaming
+	 *         or the dimension of the sequence is not the one of the
+	 *         hardware
+	 */
+	bool canStartStreaming(const Sequence* sequence);
+
+	/**
+	 * \brief Starts the stream modality
+	 *
+	 * \param sequence the sequence to send
+	 * \param firstPoints the points to send in place of the current point
+	 *                    of the sequence (see m_pendingPoints)
+	 * \param startTime the host time at which the first point starts in
+	 *                  scheduled streams, scheduleLeadTime milliseconds
+	 *                  from now if negative
+	 */
+	void beginStream(Sequence* sequence, QList<SequencePoint> firstPoints, double startTime);
+
+	/**
+	 * \brief Sends the next point in stream mode and moves forward
+	 *
+	 * If there are pending points, the first one is sent, otherwise the
+	 * current point of the sequence is sent
+	 */
+	void sendNextStreamPoint();
+
+	/**
+	 * \brief Sends a point in stream mode
+	 *
+	 * This also computes the start time of the point in scheduled streams
+	 * \param p the point to send, either a pending point or the current
+	 *          point of the sequence
+	 */
+	void sendStreamPoint(const SequencePoint& p);
+
 	/**
 	 * \brief Returns a sequence packet for the given point
 	 *
 	 * This function doesn't check that p has the length that was used in
 	 * the start stream or start immediate package, ensure this externally
 	 * (this condition is fulfilled if the same sequence is used for the
-	 * start and this function, as it should be)
+	 * start and this function, as it should be). The packet is either a
+	 * full or a masked sequence packet, whichever is smaller, so the
+	 * returned packet must be sent: this function keeps track of the
+	 * values the hardware has
 	 * \param p the point for which to create a packet
+	 * \param startTime the start time of the point on the clock of the
+	 *                  hardware or -1 if the point is not scheduled
 	 * \return the packet for the point
 	 */
-	QByteArray createSequencePacketForPoint(const SequencePoint& p) const;
+	QByteArray createSequencePacketForPoint(const SequencePoint& p, qint64 startTime = -1);
 
 	/**
 	 * \brief Processes received packets
@@ -530,6 +1042,23 @@ private:
 	 */
 	void setBatteryCharge(float v);
 
+	/**
+	 * \brief Sends the time scale packet with the current playback speed
+	 */
+	void sendTimeScale();
+
+	/**
+	 * \brief Resets the statistics of the serial link
+	 */
+	void resetLinkStatistics();
+
+	/**
+	 * \brief Returns the timestamp to put in ping packets
+	 *
+	 * \return the microseconds since the port was opened (modulo 2^32)
+	 */
+	quint32 linkTimestamp() const;
+
 	/**
 	 * \brief The name of the serial port to open
 	 */
@@ -549,6 +1078,9 @@ private:
 
 	/**
 	 * \brief The serial communication port
+	 *
+	 * This and the timers are children of this object, so that they are
+	 * moved with it when it is moved to another thread (see RobotGroup)
 	 */
 	QSerialPort m_serialPort;
 
@@ -591,6 +1123,16 @@ private:
 	 */
 	bool m_paused;
 
+	/**
+	 * \brief The speed at which the sequence is played
+	 */
+	double m_playbackSpeed;
+
+	/**
+	 * \brief If true positions are sent with 16 bits
+	 */
+	bool m_highResolution;
+
 	/**
 	 * \brief True if we cannot send more sequence points because the queue
 	 *        of the hardware is full
@@ -602,11 +1144,183 @@ private:
 	 */
 	float m_batteryCharge;
 
+	/**
+	 * \brief The last saturation counts received from the hardware
+	 */
+	QVariantList m_saturationCounts;
+
+	/**
+	 * \brief The last bus statistics received from the hardware
+	 */
+	QVariantMap m_busStatistics;
+
+	/**
+	 * \brief The results of the bus tests received from the hardware
+	 */
+	QVariantList m_busTestResults;
+
+	/**
+	 * \brief The dimension of points reported by the hardware
+	 *
+	 * This is -1 until the hardware sends it
+	 */
+	int m_hardwarePointDim;
+
 	/**
 	 * \brief True if we have sent a stop sequence packet and are waiting
 	 *        for the end of the sequence
 	 */
 	bool m_stopping;
+
+	/**
+	 * \brief The points to send in place of the current point of the
+	 *        sequence
+	 *
+	 * This is used when starting the stream in the middle of a point: the
+	 * current point of the sequence is replaced by these points, and after
+	 * the last one has been sent the stream continues from the point after
+	 * the current one
+	 */
+	QList<SequencePoint> m_pendingPoints;
+
+	/**
+	 * \brief The index in the sequence of the last points sent in stream
+	 *        mode
+	 *
+	 * The index of the n-th point sent since the stream started is in
+	 * element n % streamPointIndicesSize. Underrun packets refer to points
+	 * by n, they can only be about recent points
+	 */
+	QVector<int> m_streamPointIndices;
+
+	/**
+	 * \brief The number of points sent since the stream started
+	 */
+	unsigned int m_sentStreamPoints;
+
+	/**
+	 * \brief The buffer underruns during the last stream
+	 */
+	QVariantList m_underruns;
+
+	/**
+	 * \brief The number of underruns in the last underrun packet
+	 */
+	int m_hardwareUnderruns;
+
+	/**
+	 * \brief The positions of the last point sent to the hardware
+	 *
+	 * This is used to only send changed positions in masked sequence
+	 * packets. It is empty when we don't know the positions the hardware
+	 * has
+	 */
+	QVector<unsigned int> m_lastSentValues;
+
+	/**
+	 * \brief The timer to update the statistics of the serial link
+	 */
+	QTimer m_linkStatisticsTimer;
+
+	/**
+	 * \brief The clock for ping timestamps and rates, started when the port
+	 *        is opened
+	 */
+	QElapsedTimer m_linkClock;
+
+	/**
+	 * \brief The time of m_linkClock at the last statistics update in
+	 *        milliseconds
+	 */
+	qint64 m_lastLinkStatisticsTime;
+
+	/**
+	 * \brief The timestamp of the ping waiting for a pong
+	 *
+	 * This is only valid if m_pingPending is true
+	 */
+	quint32 m_pendingPingTimestamp;
+
+	/**
+	 * \brief The host time (see hostTime()) at which the ping waiting for
+	 *        a pong was sent
+	 */
+	double m_pendingPingHostTime;
+
+	/**
+	 * \brief The estimate of the clock of the hardware
+	 */
+	ClockSync m_clockSync;
+
+	/**
+	 * \brief True if points are streamed with a start time
+	 */
+	bool m_scheduledStream;
+
+	/**
+	 * \brief The host time at which the first point of the scheduled
+	 *        stream starts
+	 */
+	double m_scheduleStart;
+
+	/**
+	 * \brief The time in milliseconds the points already sent in the
+	 *        scheduled stream are played at normal speed
+	 */
+	qint64 m_scheduleElapsed;
+
+	/**
+	 * \brief The host time (see hostTime()) at which the stream was paused
+	 *
+	 * This is only valid while paused
+	 */
+	double m_pauseHostTime;
+
+	/**
+	 * \brief True if we sent a ping and are waiting for its pong
+	 */
+	bool m_pingPending;
+
+	/**
+	 * \brief The last round trip times in milliseconds, the oldest first
+	 */
+	QList<double> m_roundTripTimes;
+
+	/**
+	 * \brief The packets received since the last statistics update
+	 */
+	int m_receivedPackets;
+
+	/**
+	 * \brief The bytes received since the last statistics update
+	 */
+	int m_receivedBytes;
+
+	/**
+	 * \brief The packets sent since the last statistics update
+	 */
+	int m_sentPackets;
+
+	/**
+	 * \brief The bytes sent since the last statistics update
+	 */
+	int m_sentBytes;
+
+	/**
+	 * \brief The pings without a pong since the port was opened
+	 */
+	int m_lostPings;
+
+	/**
+	 * \brief The received bytes that were not the start of a known packet
+	 *        since the port was opened
+	 */
+	int m_parseErrors;
+
+	/**
+	 * \brief The statistics of the serial link
+	 */
+	QVariantMap m_linkStatistics;
 };
 
 #endif // SERIALCOMMUNICATION_H
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "timeindex.h"
+
+namespace {
+	/**
+	 * \brief Returns the least significant bit of i set to 1
+	 *
+	 * \param i the number
+	 * \return the least significant bit of i set to 1
+	 */
+	inline int lowbit(int i)
+	{
+		return i & (-i);
+	}
+}
+
+TimeIndex::TimeIndex()
+	: m_values()
+	, m_tree(1, 0)
+{
+}
+
+void TimeIndex::clear()
+{
+	m_values.clear();
+	m_tree.fill(0, 1);
+}
+
+void TimeIndex::append(qint64 v)
+{
+	m_values.append(v);
+
+	// The new node covers the values from n - lowbit(n) to n - 1, i.e. the
+	// new value plus the ones already summed in the nodes n - 1, n - 2, n - 4...
+	// down to n - lowbit(n)
+	const int n = m_values.size();
+	qint64 sum = v;
+	for (int i = n - 1; i > (n - lowbit(n)); i -= lowbit(i)) {
+		sum += m_tree[i];
+	}
+	m_tree.append(sum);
+}
+
+void TimeIndex::insert(int pos, qint64 v)
+{
+	m_values.insert(pos, v);
+	m_tree.append(0);
+
+	rebuildFrom(pos);
+}
+
+void TimeIndex::remove(int pos)
+{
+	m_values.remove(pos);
+	m_tree.removeLast();
+
+	rebuildFrom(pos);
+}
+
+void TimeIndex::set(int pos, qint64 v)
+{
+	const qint64 delta = v - m_values[pos];
+	m_values[pos] = v;
+
+	for (int i = pos + 1; i < m_tree.size(); i += lowbit(i)) {
+		m_tree[i] += delta;
+	}
+}
+
+qint64 TimeIndex::prefixSum(int pos) const
+{
+	qint64 sum = 0;
+
+	for (int i = pos; i > 0; i -= lowbit(i)) {
+		sum += m_tree[i];
+	}
+
+	return sum;
+}
+
+int TimeIndex::find(qint64 t) const
+{
+	if (t < 0) {
+		return 0;
+	}
+
+	// Descending the tree from the highest power of two, looking for the
+	// largest pos such that prefixSum(pos) <= t
+	int step = 1;
+	while ((step * 2) < m_tree.size()) {
+		step *= 2;
+	}
+
+	int pos = 0;
+	qint64 remaining = t;
+	for (; step > 0; step /= 2) {
+		const int next = pos + step;
+		if ((next < m_tree.size()) && (m_tree[next] <= remaining)) {
+			pos = next;
+			remaining -= m_tree[next];
+		}
+	}
+
+	// Here prefixSum(pos) <= t < prefixSum(pos + 1) (when intervals have
+	// zero length, they are skipped)
+	return pos;
+}
+
+void TimeIndex::rebuildFrom(int pos)
+{
+	// Nodes up to pos only sum values before pos and are still valid. The
+	// others are rebuilt in linear time: first each node gets its own value,
+	// then every node is added to its parent (children always come before
+	// their parent, so they are complete when added)
+	const int n = m_values.size();
+	for (int i = pos + 1; i <= n; ++i) {
+		m_tree[i] = m_values[i - 1];
+	}
+	for (int i = 1; i <= n; ++i) {
+		const int parent = i + lowbit(i);
+		if ((parent <= n) && (parent > pos)) {
+			m_tree[parent] += m_tree[i];
+		}
+	}
+}
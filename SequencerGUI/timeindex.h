@@ -0,0 +1,158 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * \brief A list of time intervals with fast prefix sums
+ *
+ * This stores the length of consecutive time intervals (e.g. the time each
+ * point of a sequence is played) and allows to compute the time at which an
+ * interval starts and the interval containing a given time in O(log n). The
+ * length of an interval can also be changed in O(log n). Internally this is a
+ * Fenwick tree (binary indexed tree). Inserting or removing intervals in the
+ * middle of the list requires rebuilding part of the tree, which is O(n) (as
+ * is inserting into or removing from the QList storing points in Sequence)
+ */
+class TimeIndex
+{
+public:
+	/**
+	 * \brief Constructor. Builds an empty index
+	 */
+	TimeIndex();
+
+	/**
+	 * \brief Returns the number of intervals
+	 *
+	 * \return the number of intervals
+	 */
+	int size() const
+	{
+		return m_values.size();
+	}
+
+	/**
+	 * \brief Removes all intervals
+	 */
+	void clear();
+
+	/**
+	 * \brief Adds an interval at the end of the list
+	 *
+	 * This is O(log n)
+	 * \param v the length of the interval
+	 */
+	void append(qint64 v);
+
+	/**
+	 * \brief Inserts an interval in the list
+	 *
+	 * \param pos the position of the new interval
+	 * \param v the length of the interval
+	 */
+	void insert(int pos, qint64 v);
+
+	/**
+	 * \brief Removes an interval from the list
+	 *
+	 * \param pos the position of the interval to remove
+	 */
+	void remove(int pos);
+
+	/**
+	 * \brief Changes the length of an interval
+	 *
+	 * This is O(log n)
+	 * \param pos the position of the interval to change
+	 * \param v the new length of the interval
+	 */
+	void set(int pos, qint64 v);
+
+	/**
+	 * \brief Returns the length of an interval
+	 *
+	 * \param pos the position of the interval
+	 * \return the length of the interval
+	 */
+	qint64 value(int pos) const
+	{
+		return m_values[pos];
+	}
+
+	/**
+	 * \brief Returns the sum of the lengths of the first intervals
+	 *
+	 * This is the time at which interval pos starts. This is O(log n)
+	 * \param pos the number of intervals to sum (from 0 to size())
+	 * \return the sum of the length of intervals from 0 to pos - 1
+	 */
+	qint64 prefixSum(int pos) const;
+
+	/**
+	 * \brief Returns the sum of the lengths of all intervals
+	 *
+	 * \return the sum of the lengths of all intervals
+	 */
+	qint64 total() const
+	{
+		return prefixSum(m_values.size());
+	}
+
+	/**
+	 * \brief Returns the interval containing the given time
+	 *
+	 * This is O(log n)
+	 * \param t the time to look for
+	 * \return the position of the interval i such that prefixSum(i) <= t <
+	 *         prefixSum(i + 1). If t is negative 0 is returned, if it is
+	 *         not less than total(), size() is returned
+	 */
+	int find(qint64 t) const;
+
+private:
+	/**
+	 * \brief Rebuilds the tree from the given position in O(n)
+	 *
+	 * \param pos the first position whose value changed
+	 */
+	void rebuildFrom(int pos);
+
+	/**
+	 * \brief The length of intervals
+	 */
+	QVector<qint64> m_values;
+
+	/**
+	 * \brief The Fenwick tree
+	 *
+	 * Element i (1-based) is the sum of values from i - lowbit(i) to i - 1
+	 * (0-based), where lowbit(i) is the least significant bit of i set to
+	 * 1. Element 0 is not used
+	 */
+	QVector<qint64> m_tree;
+};
+
+#endif // TIMEINDEX_H
@@ -0,0 +1,277 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "trajectory.h"
+#include <algorithm>
+#include "sequence.h"
+#include "wirepositions.h"
+
+namespace {
+	/**
+	 * \brief Returns how long the point is played if it is not the last one
+	 *
+	 * \param p the point
+	 * \return the time in milliseconds after which the next point starts
+	 */
+	qint64 playTime(const SequencePoint& p)
+	{
+		return p.isPartial() ? pointPlayTime(0, p.duration) : pointPlayTime(p.timeToTarget, p.duration);
+	}
+}
+
+Trajectory::Trajectory(const Sequence& sequence, bool highResolution)
+	: Trajectory(sequence, (sequence.numPoints() == 0) ? QVector<unsigned int>(int(sequence.pointDim()), 0u) : quantize(sequence[0].point, highResolution), highResolution)
+{
+}
+
+Trajectory::Trajectory(const Sequence& sequence, const QVector<unsigned int>& startPose, bool highResolution)
+	: m_startPose(startPose)
+	, m_targets()
+	, m_segmentStarts()
+	, m_segmentPoints()
+	, m_timeToTarget()
+	, m_profiles()
+	, m_startTimes()
+	, m_totalTime(0)
+	, m_highResolution(highResolution)
+{
+	const int n = sequence.numPoints();
+	const int dim = pointDim();
+
+	m_targets.reserve(n * dim);
+	m_segmentStarts.resize(n * dim);
+	m_segmentPoints.resize(n * dim);
+	m_timeToTarget.reserve(n);
+	m_profiles.reserve(n);
+	m_startTimes.reserve(n + 1);
+
+	qint64 startTime = 0;
+	for (int i = 0; i < n; ++i) {
+		const SequencePoint& p = sequence[i];
+
+		m_targets += quantize(p.point, m_highResolution);
+		m_timeToTarget.append(p.timeToTarget);
+		m_profiles.append(p.profile);
+		m_startTimes.append(startTime);
+
+		// As in the firmware, the channels updated by the point start a new
+		// segment from where the servo is now, the others keep the segment
+		// they have
+		for (int c = 0; c < dim; ++c) {
+			const int j = i * dim + c;
+			if (p.updatesChannel(c)) {
+				m_segmentStarts[j] = positionOnSegment((i == 0) ? -1 : m_segmentPoints[j - dim], c, startTime);
+				m_segmentPoints[j] = i;
+			} else {
+				m_segmentPoints[j] = (i == 0) ? -1 : m_segmentPoints[j - dim];
+			}
+		}
+
+		startTime += playTime(p);
+	}
+
+	// The last point also waits for all segments to reach their targets
+	if (n != 0) {
+		const SequencePoint& last = sequence[n - 1];
+		const qint64 lastStart = m_startTimes.last();
+		qint64 endTime = lastStart + (last.isPartial() ? 0 : last.timeToTarget) + last.duration;
+		for (int c = 0; c < dim; ++c) {
+			const int j = m_segmentPoints[(n - 1) * dim + c];
+			if (j != -1) {
+				endTime = std::max(endTime, m_startTimes[j] + qint64(m_timeToTarget[j]));
+			}
+		}
+		m_totalTime = endTime + 1;
+	}
+	m_startTimes.append(m_totalTime);
+}
+
+QVector<unsigned int> Trajectory::quantize(const QVector<double>& p, bool highResolution)
+{
+	QVector<unsigned int> pose(p.size());
+
+	for (int c = 0; c < p.size(); ++c) {
+		pose[c] = hardwarePosition(std::max(0.0, std::min(p[c], 255.0)), highResolution);
+	}
+
+	return pose;
+}
+
+int Trajectory::pointAt(qint64 t) const
+{
+	if (numPoints() == 0) {
+		return -1;
+	}
+
+	// The first point starting after t (the end of the sequence is not a
+	// point, so the last point is returned if t is past the end)
+	const auto next = std::upper_bound(m_startTimes.constBegin(), m_startTimes.constEnd() - 1, t);
+
+	return std::max(0, int(next - m_startTimes.constBegin()) - 1);
+}
+
+QVector<unsigned int> Trajectory::poseAt(qint64 t) const
+{
+	const int i = pointAt(t);
+	if (i == -1) {
+		return m_startPose;
+	}
+
+	QVector<unsigned int> pose(pointDim());
+	poseInPoint(i, t, pose.data());
+
+	return pose;
+}
+
+unsigned int Trajectory::channelAt(int channel, qint64 t) const
+{
+	const int i = pointAt(t);
+
+	return positionOnSegment((i == -1) ? -1 : m_segmentPoints[i * pointDim() + channel], channel, t);
+}
+
+Trajectory::Segment Trajectory::segmentAt(int channel, qint64 t) const
+{
+	const int i = pointAt(t);
+	const int j = (i == -1) ? -1 : m_segmentPoints[i * pointDim() + channel];
+
+	Segment segment;
+	segment.point = j;
+	if (j == -1) {
+		segment.startTime = 0;
+		segment.start = m_startPose[channel];
+		segment.target = m_startPose[channel];
+		segment.timeToTarget = 0;
+		segment.profile = LinearProfile;
+	} else {
+		segment.startTime = m_startTimes[j];
+		segment.start = m_segmentStarts[j * pointDim() + channel];
+		segment.target = m_targets[j * pointDim() + channel];
+		segment.timeToTarget = m_timeToTarget[j];
+		segment.profile = m_profiles[j];
+	}
+
+	return segment;
+}
+
+QVector<unsigned int> Trajectory::render(qint64 period) const
+{
+	const int dim = pointDim();
+	const int numPoses = int(m_totalTime / period) + 1;
+
+	QVector<unsigned int> buffer(numPoses * dim);
+	int i = 0;
+	for (int k = 0; k < numPoses; ++k) {
+		// Times only grow, so there is no need to search for the point
+		const qint64 t = qint64(k) * period;
+		while ((i < numPoints() - 1) && (m_startTimes[i + 1] <= t)) {
+			++i;
+		}
+
+		if (numPoints() == 0) {
+			std::copy(m_startPose.constBegin(), m_startPose.constEnd(), buffer.begin() + k * dim);
+		} else {
+			poseInPoint(i, t, buffer.data() + k * dim);
+		}
+	}
+
+	return buffer;
+}
+
+QList<SequencePoint> Trajectory::seekPoints(qint64 t, int* delay) const
+{
+	QList<SequencePoint> points;
+	if (delay != nullptr) {
+		*delay = 0;
+	}
+	if (numPoints() == 0) {
+		return points;
+	}
+
+	t = std::max(qint64(0), std::min(t, m_totalTime - 1));
+	const int pos = pointAt(t);
+	const int dim = pointDim();
+	const QVector<unsigned int> pose = poseAt(t);
+
+	// First going where the robot would be at this time. The whole pose is
+	// sent, channels that are still moving are updated again below
+	QVector<double> p(dim);
+	for (int c = 0; c < dim; ++c) {
+		p[c] = pose[c] / 256.0;
+	}
+	points.append(SequencePoint(p, 0, 0));
+
+	// Then restarting segments that have not reached their target, grouping
+	// channels by the point that started them. Each point is played for 1
+	// millisecond, so the time to target is reduced to reach the target when
+	// the original segment would
+	QVector<bool> restarted(dim, false);
+	for (int c = 0; c < dim; ++c) {
+		const int j = m_segmentPoints[pos * dim + c];
+		if (restarted[c] || (j == -1) || ((m_startTimes[j] + m_timeToTarget[j]) <= t)) {
+			continue;
+		}
+
+		const qint64 remaining = m_startTimes[j] + m_timeToTarget[j] - t - points.size();
+		SequencePoint segment(p, 0, int(std::max(qint64(0), remaining)), m_profiles[j]);
+		segment.channels.fill(false, dim);
+		for (int k = c; k < dim; ++k) {
+			if (m_segmentPoints[pos * dim + k] == j) {
+				segment.channels[k] = true;
+				segment.point[k] = m_targets[j * dim + k] / 256.0;
+				restarted[k] = true;
+			}
+		}
+		points.append(segment);
+	}
+
+	// The last point lasts what remains of the point being played. If that
+	// is not enough, the rest of the sequence starts late
+	const qint64 remaining = m_startTimes[pos + 1] - t - points.size();
+	points.last().duration = int(std::max(qint64(0), remaining));
+	if ((remaining < 0) && (delay != nullptr)) {
+		*delay = int(-remaining);
+	}
+
+	return points;
+}
+
+unsigned int Trajectory::positionOnSegment(int point, int channel, qint64 t) const
+{
+	if (point == -1) {
+		return m_startPose[channel];
+	}
+
+	const int j = point * pointDim() + channel;
+	const qint64 localTime = t - m_startTimes[point];
+	if (localTime >= qint64(m_timeToTarget[point])) {
+		return m_targets[j];
+	}
+
+	return interpolatePosition(m_segmentStarts[j], m_targets[j], std::max(qint64(0), localTime), m_timeToTarget[point], m_profiles[point]);
+}
+
+void Trajectory::poseInPoint(int i, qint64 t, unsigned int* pose) const
+{
+	for (int c = 0; c < pointDim(); ++c) {
+		pose[c] = positionOnSegment(m_segmentPoints[i * pointDim() + c], c, t);
+	}
+}
@@ -0,0 +1,328 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <QList>
+#include <QVector>
+#include <QtGlobal>
+#include "sequencepoint.h"
+
+class Sequence;
+
+/**
+ * \brief Computes the positions servos have while a sequence is played
+ *
+ * This class reproduces what the firmware does when a sequence is streamed,
+ * so that positions can be computed at any time without the robot (e.g. for
+ * seeking, previews or to validate a sequence offline). Coordinates are
+ * converted to the values sent on the wire (with 8 or 16 bits, see
+ * wirepositions.h in the firmware) and positions are interpolated with 8
+ * fractional bits by the same functions used by the firmware (see
+ * interpolation.h), so poses are exactly those the firmware computes.
+ *
+ * As in SequencePlayer, each servo follows its own segment: a point starts a
+ * new segment only for the channels it updates, from the position the servo
+ * has when the point starts, while the other channels go on with the segment
+ * of the last point that updated them. Each point lasts as long as it does on
+ * the robot (see pointPlayTime()), except the last one, which also waits for
+ * all segments to reach their targets. Times are in milliseconds from the
+ * moment the first point starts to be played, at normal speed. The sequence is
+ * copied when the object is created, later modifications of the sequence are
+ * not seen by this object
+ */
+class Trajectory
+{
+public:
+	/**
+	 * \brief The segment followed by a servo
+	 */
+	struct Segment
+	{
+		/**
+		 * \brief The index of the point that started the segment
+		 *
+		 * This is -1 if no point updated the channel yet (the servo is
+		 * still in the start pose)
+		 */
+		int point;
+
+		/**
+		 * \brief The time at which the segment started
+		 */
+		qint64 startTime;
+
+		/**
+		 * \brief The position of the servo when the segment started
+		 */
+		unsigned int start;
+
+		/**
+		 * \brief The target of the segment
+		 */
+		unsigned int target;
+
+		/**
+		 * \brief The time to reach the target from startTime
+		 */
+		unsigned int timeToTarget;
+
+		/**
+		 * \brief The interpolation profile of the segment
+		 */
+		int profile;
+	};
+
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * The pose of the robot before the sequence starts is taken to be the
+	 * first point of the sequence
+	 * \param sequence the sequence to play
+	 * \param highResolution if true positions are sent to the robot with 16
+	 *                       bits, otherwise with 8
+	 */
+	explicit Trajectory(const Sequence& sequence, bool highResolution = false);
+
+	/**
+	 * \brief Constructor
+	 *
+	 * \param sequence the sequence to play
+	 * \param startPose the pose of the robot before the sequence starts,
+	 *                  with 8 fractional bits. Must have the dimension of
+	 *                  the sequence
+	 * \param highResolution if true positions are sent to the robot with 16
+	 *                       bits, otherwise with 8
+	 */
+	Trajectory(const Sequence& sequence, const QVector<unsigned int>& startPose, bool highResolution = false);
+
+	/**
+	 * \brief Converts a point to the pose the robot has when it receives it
+	 *
+	 * Coordinates are clamped between 0 and 255 and converted with
+	 * hardwarePosition()
+	 * \param p the coordinates of the point
+	 * \param highResolution if true positions are sent with 16 bits
+	 * \return the pose, with 8 fractional bits
+	 */
+	static QVector<unsigned int> quantize(const QVector<double>& p, bool highResolution = false);
+
+	/**
+	 * \brief Returns the dimension of poses
+	 *
+	 * \return the dimension of poses
+	 */
+	int pointDim() const
+	{
+		return m_startPose.size();
+	}
+
+	/**
+	 * \brief Returns the number of points
+	 *
+	 * \return the number of points of the sequence
+	 */
+	int numPoints() const
+	{
+		return m_timeToTarget.size();
+	}
+
+	/**
+	 * \brief Returns the time at which the sequence ends
+	 *
+	 * This is the time at which the robot finishes playing the last point,
+	 * after all segments have reached their targets
+	 * \return the time in milliseconds needed to play the whole sequence
+	 */
+	qint64 totalTime() const
+	{
+		return m_totalTime;
+	}
+
+	/**
+	 * \brief Returns the time at which a point starts
+	 *
+	 * \param i the index of the point
+	 * \return the time in milliseconds at which point i starts
+	 */
+	qint64 pointStartTime(int i) const
+	{
+		return m_startTimes[i];
+	}
+
+	/**
+	 * \brief Returns the index of the point being played at the given time
+	 *
+	 * \param t the time in milliseconds
+	 * \return the index of the point being played at time t, 0 if t is
+	 *         negative, the last point if t is past the end of the sequence
+	 *         or -1 if the sequence is empty
+	 */
+	int pointAt(qint64 t) const;
+
+	/**
+	 * \brief Returns the pose of the robot at the given time
+	 *
+	 * \param t the time in milliseconds
+	 * \return the pose of the robot at time t, with 8 fractional bits
+	 */
+	QVector<unsigned int> poseAt(qint64 t) const;
+
+	/**
+	 * \brief Returns the position of a single servo at the given time
+	 *
+	 * \param channel the index of the servo
+	 * \param t the time in milliseconds
+	 * \return the position of the servo at time t
+	 */
+	unsigned int channelAt(int channel, qint64 t) const;
+
+	/**
+	 * \brief Returns the segment a servo follows at the given time
+	 *
+	 * \param channel the index of the servo
+	 * \param t the time in milliseconds
+	 * \return the segment of the servo at time t
+	 */
+	Segment segmentAt(int channel, qint64 t) const;
+
+	/**
+	 * \brief Samples the whole sequence at a fixed rate
+	 *
+	 * Poses are stored one after the other in the returned buffer, so
+	 * channel c at time (k * period) is at position (k * pointDim() + c).
+	 * The first pose is at time 0, the last one at the end of the sequence
+	 * (i.e. there are totalTime() / period + 1 poses)
+	 * \param period the time between two poses in milliseconds. Must be
+	 *               greater than 0
+	 * \return the buffer with poses
+	 */
+	QVector<unsigned int> render(qint64 period) const;
+
+	/**
+	 * \brief Returns the points to stream instead of the one being played
+	 *        at the given time, to start playing from that time
+	 *
+	 * The first point brings the robot to poseAt(t). It is followed by one
+	 * partial point for each group of servos whose segment is still
+	 * running at time t, which moves them to the target of the segment by
+	 * the time they would reach it. The points last as long as what
+	 * remains of the point being played, so that the following points of
+	 * the sequence start when they would have. Segments restart from rest,
+	 * so with non-linear profiles the movement only approximates the
+	 * original one. Each of the points is played for at least one
+	 * millisecond: if what remains of the point is shorter than that, the
+	 * rest of the sequence starts late
+	 * \param t the time in milliseconds. It is clamped to the duration of
+	 *          the sequence
+	 * \param delay if not nullptr, set to how many milliseconds later the
+	 *              following points of the sequence start
+	 * \return the points to stream instead of point pointAt(t), or an
+	 *         empty list if the sequence is empty
+	 */
+	QList<SequencePoint> seekPoints(qint64 t, int* delay = nullptr) const;
+
+private:
+	/**
+	 * \brief Computes the position of a servo on the segment started by a
+	 *        point
+	 *
+	 * \param point the index of the point that started the segment, or -1
+	 *              for the start pose
+	 * \param channel the index of the servo
+	 * \param t the time in milliseconds (not before the point starts)
+	 * \return the position of the servo at time t
+	 */
+	unsigned int positionOnSegment(int point, int channel, qint64 t) const;
+
+	/**
+	 * \brief Computes the pose at the given time inside a point
+	 *
+	 * \param i the index of the point
+	 * \param t the time in milliseconds
+	 * \param pose the array where the pose is written. Must have pointDim()
+	 *             elements
+	 */
+	void poseInPoint(int i, qint64 t, unsigned int* pose) const;
+
+	/**
+	 * \brief The pose of the robot before the sequence starts
+	 */
+	QVector<unsigned int> m_startPose;
+
+	/**
+	 * \brief The targets of all points as received by the robot
+	 *
+	 * The target of channel c of point i is at position (i * pointDim() +
+	 * c)
+	 */
+	QVector<unsigned int> m_targets;
+
+	/**
+	 * \brief The position of servos when the segments started by each
+	 *        point begin
+	 *
+	 * This has the same layout as m_targets. Values of channels not
+	 * updated by a point are not used
+	 */
+	QVector<unsigned int> m_segmentStarts;
+
+	/**
+	 * \brief The point that started the segment of each servo while each
+	 *        point is played
+	 *
+	 * This has the same layout as m_targets. -1 means that the servo is
+	 * still in the start pose
+	 */
+	QVector<int> m_segmentPoints;
+
+	/**
+	 * \brief The time to target of all points
+	 */
+	QVector<unsigned int> m_timeToTarget;
+
+	/**
+	 * \brief The interpolation profile of all points
+	 */
+	QVector<int> m_profiles;
+
+	/**
+	 * \brief The time at which each point starts
+	 *
+	 * This has one element more than the number of points: the last one is
+	 * the time at which the sequence ends (the same as m_totalTime)
+	 */
+	QVector<qint64> m_startTimes;
+
+	/**
+	 * \brief The time at which the sequence ends
+	 */
+	qint64 m_totalTime;
+
+	/**
+	 * \brief Whether positions are sent with 16 bits
+	 */
+	bool m_highResolution;
+};
+
+#endif // TRAJECTORY_H
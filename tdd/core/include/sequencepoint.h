@@ -25,6 +25,7 @@
 #include <QVector>
 #include <QJsonObject>
 #include "utils.h"
+#include "interpolation.h"
 
 /**
  * \brief A single point in a sequence
@@ -56,12 +57,14 @@ struct SequencePoint
 	 * \param p the point
 	 * \param d the duration in milliseconds
 	 * \param t the time to reach this point in milliseconds
+	 * \param pr the interpolation profile used to reach this point
 	 */
-	SequencePoint(Array p, int d, int t);
+	SequencePoint(Array p, int d, int t, int pr = LinearProfile);
 
 	/**
 	 * \brief Creates a sequence point from a JSON representation
 	 *
+	 * The profile is optional and defaults to LinearProfile
 	 * \param json the JSON object to read
 	 * \return the new sequence point, which is invalid in case of errors
 	 */
@@ -117,6 +120,14 @@ struct SequencePoint
 	 *        in milliseconds
 	 */
 	int timeToTarget;
+
+	/**
+	 * \brief How the robot moves from the previous position to this point
+	 *
+	 * This is one of the values of InterpolationProfile (see
+	 * Firmware/interpolation.h)
+	 */
+	int profile;
 };
 
 // Expoting explicitly instantiated classes
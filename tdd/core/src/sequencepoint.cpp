@@ -27,14 +27,16 @@ SequencePoint<PointDimT>::SequencePoint()
 	: point()
 	, duration(0)
 	, timeToTarget(0)
+	, profile(LinearProfile)
 {
 }
 
 template <std::size_t PointDimT>
-SequencePoint<PointDimT>::SequencePoint(Array p, int d, int t)
+SequencePoint<PointDimT>::SequencePoint(Array p, int d, int t, int pr)
 	: point(p)
 	, duration(d)
 	, timeToTarget(t)
+	, profile(pr)
 {
 }
 
@@ -76,6 +78,19 @@ SequencePoint<PointDimT> SequencePoint<PointDimT>::fromJson(const QJsonObject& j
 	}
 	seqPoint.timeToTarget = static_cast<int>(t.toDouble());
 
+	// The profile is optional
+	QJsonValue pr = json["profile"];
+	if (pr.isUndefined()) {
+		return seqPoint;
+	}
+	if (!pr.isDouble()) {
+		seqPoint.duration = -1;
+		seqPoint.timeToTarget = -1;
+
+		return seqPoint;
+	}
+	seqPoint.profile = static_cast<int>(pr.toDouble());
+
 	return seqPoint;
 }
 
@@ -97,6 +112,11 @@ QJsonObject SequencePoint<PointDimT>::toJson() const
 	// and timeToTarget
 	o.insert("timeToTarget", timeToTarget);
 
+	// The profile is only saved if it is not the default one
+	if (profile != LinearProfile) {
+		o.insert("profile", profile);
+	}
+
 	return o;
 }
 
@@ -106,6 +126,7 @@ bool SequencePoint<PointDimT>::operator==(const SequencePoint& other) const
 	// We check point last because it is the most expensive check
 	return (other.duration == duration) &&
 	       (other.timeToTarget == timeToTarget) &&
+	       (other.profile == profile) &&
 	       (other.point == point);
 }
 
@@ -0,0 +1,288 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <csignal>
+#include "sequence.h"
+#include "serialcommunication.h"
+#include "robotgroup.h"
+
+// NOTES AND TODOS
+//
+// The player streams a sequence and exits when the sequence ends (never when
+// looping) or on SIGINT. On SIGINT the stream is stopped so that the robot
+// finishes the current point instead of freezing in the middle of it.
+//
+// With one or more --robot options the player streams to a group of robots
+// (see RobotGroup), each one with its own port and sequence. The streams
+// start together once the clocks of all robots are known well enough. Looping,
+// seeking and speed are not supported in this mode
+
+namespace {
+	// How often we check whether we have been interrupted in milliseconds
+	const int interruptCheckInterval = 100;
+
+	// How long we wait for the robot to stop after an interrupt in
+	// milliseconds
+	const int stopTimeout = 2000;
+
+	// How long we wait for the clocks of a group of robots to be estimated
+	// well enough to start in milliseconds
+	const int groupStartTimeout = 15000;
+
+	// Set by the SIGINT handler
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void interruptHandler(int)
+	{
+		interrupted = 1;
+	}
+
+	// Prints the statistics of the serial link
+	void printLinkStatistics(const QVariantMap& statistics)
+	{
+		QTextStream out(stdout);
+
+		out << "Link statistics:\n";
+		if (statistics.isEmpty()) {
+			out << "  none (the port was open for less than a second)\n";
+		}
+		for (auto it = statistics.constBegin(); it != statistics.constEnd(); ++it) {
+			out << "  " << it.key() << ": " << it.value().toString() << "\n";
+		}
+	}
+
+	// Streams to a group of robots. Each element of robots is port=sequence
+	int playGroup(QCoreApplication& app, const QStringList& robots, int baudRate)
+	{
+		QTextStream err(stderr);
+
+		RobotGroup group;
+		for (const QString& r: robots) {
+			const int separator = r.indexOf('=');
+			if (separator <= 0) {
+				err << "Invalid robot " << r << ", expected port=sequence\n";
+				return 1;
+			}
+
+			// RobotGroup takes URLs, as file names in the GUI come from QML
+			const int robot = group.addRobot(r.left(separator), baudRate);
+			if (!group.loadSequence(robot, QUrl::fromLocalFile(r.mid(separator + 1)).toString())) {
+				err << "Cannot load sequence " << r.mid(separator + 1) << "\n";
+				return 1;
+			}
+		}
+
+		// Exiting once all robots have finished their streams
+		int exitCode = 0;
+		bool started = false;
+		auto finish = [&]() {
+			for (const QVariant& s: group.robotStatus()) {
+				const QVariantMap status = s.toMap();
+
+				QTextStream(stdout) << "Robot " << status.value("serialPortName").toString() << "\n";
+				printLinkStatistics(status.value("linkStatistics").toMap());
+			}
+			app.exit(exitCode);
+		};
+		// The signals are emitted in the I/O thread of the group, the
+		// functions are called in this thread
+		QObject::connect(&group, &RobotGroup::robotStatusChanged, &app, [&]() {
+			if (!started) {
+				return;
+			}
+			for (const QVariant& s: group.robotStatus()) {
+				if (s.toMap().value("isStreaming").toBool()) {
+					return;
+				}
+			}
+			finish();
+		});
+		QObject::connect(&group, &RobotGroup::streamError, &app, [&](QString robot, QString error) {
+			err << robot << ": " << error << "\n";
+			err.flush();
+			exitCode = 1;
+		});
+
+		// Starting as soon as the clocks of all robots are known, stopping
+		// on SIGINT
+		QElapsedTimer startTime;
+		startTime.start();
+		QTimer timer;
+		QObject::connect(&timer, &QTimer::timeout, [&]() {
+			if (interrupted) {
+				timer.stop();
+				if (started) {
+					group.stopStreams();
+					QTimer::singleShot(stopTimeout, finish);
+				} else {
+					finish();
+				}
+			} else if (!started && group.readyToStart()) {
+				started = group.startStreams();
+				if (!started) {
+					timer.stop();
+					err << "Cannot stream the sequences to the robots\n";
+					exitCode = 1;
+					finish();
+				}
+			} else if (!started && (startTime.elapsed() > groupStartTimeout)) {
+				timer.stop();
+				err << "Cannot start the robots together, the clocks of the robots are not known well enough\n";
+				exitCode = 1;
+				finish();
+			}
+		});
+
+		if (!group.openAll()) {
+			err << "Cannot open the serial ports of all robots\n";
+			return 1;
+		}
+		timer.start(interruptCheckInterval);
+
+		return app.exec();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("sequencerPlayer");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Streams a sequence to the robot without the user interface");
+	parser.addHelpOption();
+	parser.addPositionalArgument("sequence", "The sequence file to play (not used with --robot)");
+	const QCommandLineOption portOption(QStringList() << "p" << "port", "The serial port of the robot", "port", "/dev/ttyUSB0");
+	parser.addOption(portOption);
+	const QCommandLineOption baudRateOption(QStringList() << "b" << "baud-rate", "The baud rate of the serial port", "rate", "115200");
+	parser.addOption(baudRateOption);
+	const QCommandLineOption loopOption(QStringList() << "l" << "loop", "Plays the sequence continuously until interrupted");
+	parser.addOption(loopOption);
+	const QCommandLineOption seekOption(QStringList() << "s" << "seek", "Starts from the given time of the sequence", "milliseconds", "0");
+	parser.addOption(seekOption);
+	const QCommandLineOption speedOption(QStringList() << "x" << "speed", "The playback speed (1 is the normal speed)", "factor", "1");
+	parser.addOption(speedOption);
+	const QCommandLineOption robotOption(QStringList() << "r" << "robot", "Streams to a group of robots starting together (repeat for each robot), instead of the sequence on --port", "port=sequence");
+	parser.addOption(robotOption);
+	parser.process(app);
+
+	QTextStream err(stderr);
+
+	std::signal(SIGINT, interruptHandler);
+
+	if (parser.isSet(robotOption)) {
+		bool baudRateOk = false;
+		const int baudRate = parser.value(baudRateOption).toInt(&baudRateOk);
+		if (!parser.positionalArguments().isEmpty() || parser.isSet(portOption) || parser.isSet(loopOption) || parser.isSet(seekOption) || parser.isSet(speedOption) || !baudRateOk) {
+			err << "Only --baud-rate can be used with --robot, see --help\n";
+			return 1;
+		}
+
+		return playGroup(app, parser.values(robotOption), baudRate);
+	}
+
+	if (parser.positionalArguments().size() != 1) {
+		err << "A sequence file is needed, see --help\n";
+		return 1;
+	}
+	bool baudRateOk = false;
+	bool seekOk = false;
+	bool speedOk = false;
+	const int baudRate = parser.value(baudRateOption).toInt(&baudRateOk);
+	const int seek = parser.value(seekOption).toInt(&seekOk);
+	const double speed = parser.value(speedOption).toDouble(&speedOk);
+	if (!baudRateOk || !seekOk || (seek < 0) || !speedOk || (speed <= 0.0)) {
+		err << "Invalid baud rate, seek time or speed, see --help\n";
+		return 1;
+	}
+
+	const std::unique_ptr<Sequence> sequence = Sequence::load(parser.positionalArguments()[0]);
+	if (!sequence->isValid() || (sequence->numPoints() == 0)) {
+		err << "Cannot load sequence " << parser.positionalArguments()[0] << " or it is empty\n";
+		return 1;
+	}
+
+	SerialCommunication serialCommunication;
+	serialCommunication.setSerialPortName(parser.value(portOption));
+	serialCommunication.setBaudRate(baudRate);
+	serialCommunication.setOneShotSequence(!parser.isSet(loopOption));
+	serialCommunication.setPlaybackSpeed(speed);
+
+	// Exiting once the robot has finished the stream. The port is closed by
+	// the destructor, this can be called while packets are processed
+	int exitCode = 0;
+	auto finish = [&]() {
+		printLinkStatistics(serialCommunication.linkStatistics());
+		app.exit(exitCode);
+	};
+	QObject::connect(&serialCommunication, &SerialCommunication::isStreamingChanged, [&]() {
+		if (!serialCommunication.isStreaming()) {
+			finish();
+		}
+	});
+	QObject::connect(&serialCommunication, &SerialCommunication::streamError, [&](QString error) {
+		err << error << "\n";
+		err.flush();
+		exitCode = 1;
+	});
+	QObject::connect(&serialCommunication, &SerialCommunication::hardwareEvent, [&](int, QString msg) {
+		err << "Robot: " << msg << "\n";
+		err.flush();
+	});
+
+	// Stopping the stream on SIGINT. If the robot does not confirm in time
+	// (or is not streaming), exiting anyway
+	QTimer interruptTimer;
+	QObject::connect(&interruptTimer, &QTimer::timeout, [&]() {
+		if (!interrupted) {
+			return;
+		}
+
+		interruptTimer.stop();
+		if (serialCommunication.isStreaming()) {
+			serialCommunication.stop();
+			QTimer::singleShot(stopTimeout, finish);
+		} else {
+			finish();
+		}
+	});
+	interruptTimer.start(interruptCheckInterval);
+
+	if (!serialCommunication.openSerial()) {
+		err << "Cannot open serial port " << parser.value(portOption) << "\n";
+		return 1;
+	}
+	const bool started = (seek == 0) ? serialCommunication.startStream(sequence.get()) : serialCommunication.startStreamAt(sequence.get(), seek);
+	if (!started) {
+		err << "Cannot stream the sequence to the robot\n";
+		finish();
+		return 1;
+	}
+
+	return app.exec();
+}
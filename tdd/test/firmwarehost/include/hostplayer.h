@@ -0,0 +1,128 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef HOSTPLAYER_H
+#define HOSTPLAYER_H
+
+#include <memory>
+#include <QVector>
+#include <QtGlobal>
+
+class SequencePlayer;
+
+/**
+ * \brief The SequencePlayer of the firmware running on the host
+ *
+ * This wraps the SequencePlayer class of the firmware, compiled for the host
+ * with stubs for the Arduino functions and for the PWM and I2C drivers. Time
+ * only passes when step() is called, and the position of each servo is the
+ * value last written to its PWM channel. Servos are mapped to the whole PWM
+ * range (i.e. servoMin is 0 and servoMax is the maximum position), so that the
+ * PWM value is the position of the servo with 8 fractional bits, as computed
+ * by the firmware. Only one object of this class can exist at a time, because
+ * the stubs are global like the hardware they replace
+ */
+class HostPlayer
+{
+public:
+	/**
+	 * \brief Constructor
+	 *
+	 * \param startPose the pose of the robot when the player starts, with 8
+	 *                  fractional bits. Must have numServos() elements
+	 */
+	explicit HostPlayer(const QVector<unsigned int>& startPose);
+
+	/**
+	 * \brief Destructor
+	 */
+	~HostPlayer();
+
+	/**
+	 * \brief Returns the number of servos of the firmware
+	 *
+	 * \return the number of servos of the firmware
+	 */
+	static int numServos();
+
+	/**
+	 * \brief Returns true if no more points can be added
+	 *
+	 * \return true if the buffer of the player is full
+	 */
+	bool bufferFull() const;
+
+	/**
+	 * \brief Returns true if there are no points to play
+	 *
+	 * \return true if the buffer of the player is empty
+	 */
+	bool bufferEmpty() const;
+
+	/**
+	 * \brief Adds a point to the buffer of the player
+	 *
+	 * This must not be called if the buffer is full
+	 * \param point the target of the point, with 8 fractional bits. Must have
+	 *              numServos() elements
+	 * \param duration the duration of the point in milliseconds
+	 * \param timeToTarget the time to target of the point in milliseconds
+	 * \param profile the interpolation profile
+	 * \param channels the channels updated by the point. If empty the point
+	 *                 is not partial, otherwise it must have numServos()
+	 *                 elements
+	 * \param startTime the time at which the point starts. If negative the
+	 *                  point is not scheduled
+	 */
+	void addPoint(const QVector<unsigned int>& point, unsigned int duration, unsigned int timeToTarget, unsigned char profile = 0, const QVector<bool>& channels = QVector<bool>(), qint64 startTime = -1);
+
+	/**
+	 * \brief Sets the time scale of the player
+	 *
+	 * \param scale the time scale with 8 fractional bits (256 is normal
+	 *              speed)
+	 */
+	void setTimeScale(unsigned int scale);
+
+	/**
+	 * \brief Runs one step of the player
+	 *
+	 * \param time the value millis() returns during the step. Must not be
+	 *             less than the value of the previous call
+	 * \return the value returned by SequencePlayer::step()
+	 */
+	bool step(unsigned long time);
+
+	/**
+	 * \brief Returns the current pose
+	 *
+	 * \return the value last written to the PWM channel of each servo
+	 */
+	QVector<unsigned int> pose() const;
+
+private:
+	/**
+	 * \brief The player
+	 */
+	std::unique_ptr<SequencePlayer> m_player;
+};
+
+#endif // HOSTPLAYER_H
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include "hostplayer.h"
+#include "sequenceplayer.h"
+#include "stubs.h"
+
+static_assert(SequencePlayer::numBoards <= simulatedBoards, "Not enough simulated PWM boards");
+
+HostPlayer::HostPlayer(const QVector<unsigned int>& startPose)
+	: m_player()
+{
+	// The whole PWM range is used, so PWM values are positions
+	unsigned int servoMin[SequencePoint::dim];
+	unsigned int servoMax[SequencePoint::dim];
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		servoMin[i] = 0;
+		servoMax[i] = SequencePoint::maxPosition;
+	}
+	unsigned char boardAddresses[SequencePlayer::numBoards];
+	for (int i = 0; i < SequencePlayer::numBoards; ++i) {
+		boardAddresses[i] = 0x40 + i;
+	}
+
+	simulatedTime = 0;
+	m_player.reset(new SequencePlayer(servoMin, servoMax, boardAddresses));
+
+	SequencePoint curPos;
+	memset(&curPos, 0, sizeof(SequencePoint));
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		curPos.point[i] = startPose[i];
+	}
+	m_player->begin(curPos);
+}
+
+HostPlayer::~HostPlayer()
+{
+}
+
+int HostPlayer::numServos()
+{
+	return SequencePoint::dim;
+}
+
+bool HostPlayer::bufferFull() const
+{
+	return m_player->bufferFull();
+}
+
+bool HostPlayer::bufferEmpty() const
+{
+	return m_player->bufferEmpty();
+}
+
+void HostPlayer::addPoint(const QVector<unsigned int>& point, unsigned int duration, unsigned int timeToTarget, unsigned char profile, const QVector<bool>& channels, qint64 startTime)
+{
+	// This is what SerialCommunication does in the firmware when a packet is
+	// received
+	SequencePoint* p = m_player->pointToFill();
+
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		if (channels.isEmpty() || channels[i]) {
+			p->point[i] = point[i];
+		}
+	}
+	p->duration = duration;
+	p->timeToTarget = timeToTarget;
+	p->profile = profile;
+	p->partial = !channels.isEmpty();
+	memset(p->channels, channels.isEmpty() ? 0xFF : 0, sizeof(p->channels));
+	for (int i = 0; i < channels.size(); ++i) {
+		if (channels[i]) {
+			p->channels[i / 8] |= 1 << (i % 8);
+		}
+	}
+	p->scheduled = (startTime >= 0);
+	p->startTime = p->scheduled ? static_cast<unsigned long>(startTime) : 0;
+
+	m_player->pointFilled();
+}
+
+void HostPlayer::setTimeScale(unsigned int scale)
+{
+	m_player->setTimeScale(scale);
+}
+
+bool HostPlayer::step(unsigned long time)
+{
+	simulatedTime = time;
+
+	return m_player->step();
+}
+
+QVector<unsigned int> HostPlayer::pose() const
+{
+	QVector<unsigned int> p(SequencePoint::dim);
+	for (int i = 0; i < SequencePoint::dim; ++i) {
+		p[i] = simulatedPwm[i];
+	}
+
+	return p;
+}
@@ -0,0 +1,130 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+// The stubs of the Arduino core and of the drivers used by the SequencePlayer
+// of the firmware. PWM values are stored in the array of simulated outputs,
+// I2C transactions are never queued
+
+#include "stubs.h"
+#include <Arduino.h>
+#include "AdafruitPWMServoDriver.h"
+#include "twiqueue.h"
+
+unsigned long simulatedTime = 0;
+uint16_t simulatedPwm[simulatedBoards * PCA9685_CHANNELS];
+
+unsigned long millis()
+{
+	return simulatedTime;
+}
+
+unsigned long micros()
+{
+	return simulatedTime * 1000;
+}
+
+Adafruit_PWMServoDriver::Adafruit_PWMServoDriver(uint8_t addr)
+	: _i2caddr(addr)
+	, _inFrame(false)
+	, _frameFirst(PCA9685_CHANNELS)
+	, _frameLast(0)
+{
+	memset(_on, 0, sizeof(_on));
+	memset(_off, 0, sizeof(_off));
+}
+
+void Adafruit_PWMServoDriver::begin()
+{
+}
+
+void Adafruit_PWMServoDriver::reset()
+{
+}
+
+void Adafruit_PWMServoDriver::setPWMFreq(float)
+{
+}
+
+void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off)
+{
+	_on[num] = on;
+	_off[num] = off;
+	simulatedPwm[(_i2caddr - 0x40) * PCA9685_CHANNELS + num] = off;
+}
+
+void Adafruit_PWMServoDriver::setPin(uint8_t num, uint16_t val, bool)
+{
+	setPWM(num, 0, val);
+}
+
+uint8_t Adafruit_PWMServoDriver::read8(uint8_t)
+{
+	return 0;
+}
+
+void Adafruit_PWMServoDriver::write8(uint8_t, uint8_t)
+{
+}
+
+void Adafruit_PWMServoDriver::beginFrame()
+{
+	_inFrame = true;
+}
+
+void Adafruit_PWMServoDriver::commitFrame()
+{
+	_inFrame = false;
+}
+
+TwiQueue twiQueue;
+
+TwiQueue::TwiQueue()
+	: m_head(0)
+	, m_tail(0)
+	, m_writePos(0)
+	, m_pendingLength(0)
+	, m_busy(false)
+	, m_reading(false)
+	, m_stopAfter(false)
+	, m_remaining(0)
+	, m_received(0)
+	, m_readIndex(0)
+	, m_maxQueued(0)
+	, m_completed(0)
+	, m_failed(0)
+	, m_stalls(0)
+	, m_initialized(false)
+{
+}
+
+void TwiQueue::flush()
+{
+}
+
+unsigned int TwiQueue::completedTransactions() const
+{
+	return m_completed;
+}
+
+unsigned int TwiQueue::failedTransactions() const
+{
+	return m_failed;
+}
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef STUBS_H
+#define STUBS_H
+
+#include <stdint.h>
+
+/**
+ * \brief The number of PWM boards whose outputs are simulated
+ *
+ * Boards must have consecutive addresses starting from 0x40
+ */
+const int simulatedBoards = 4;
+
+/**
+ * \brief The time returned by millis()
+ */
+extern unsigned long simulatedTime;
+
+/**
+ * \brief The last value written to each PWM channel
+ *
+ * Channel c of the board with address a is at position
+ * ((a - 0x40) * PCA9685_CHANNELS + c)
+ */
+extern uint16_t simulatedPwm[];
+
+#endif
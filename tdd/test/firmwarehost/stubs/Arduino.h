@@ -0,0 +1,51 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/**
+ * \file Arduino.h
+ *
+ * The parts of the Arduino core used by the SequencePlayer of the firmware.
+ * Time is simulated: it is set by HostPlayer::step() (see hostplayer.h)
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \brief Returns the simulated time in milliseconds
+ *
+ * \return the simulated time in milliseconds
+ */
+unsigned long millis();
+
+/**
+ * \brief Returns the simulated time in microseconds
+ *
+ * \return the simulated time in microseconds
+ */
+unsigned long micros();
+
+#endif
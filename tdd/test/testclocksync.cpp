@@ -0,0 +1,229 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QtTest/QtTest>
+#include <cmath>
+#include "clocksync.h"
+
+// NOTES AND TODOS
+//
+// ClockSync is part of the GUI, its source is compiled in this test (see
+// CMakeLists.txt). Samples are synthetic: the hardware clock is a line with
+// known offset and skew, read at a random time between the ping and the pong
+
+namespace {
+	/**
+	 * \brief The clock of the hardware, as millis() on the Arduino
+	 */
+	struct SyntheticClock
+	{
+		/**
+		 * \brief The value of the clock at host time 0 (may be negative or
+		 *        beyond 32 bits, the clock wraps around)
+		 */
+		double offset;
+
+		/**
+		 * \brief The skew in parts per million
+		 */
+		double skewPpm;
+
+		/**
+		 * \brief The value of the clock at the given host time
+		 */
+		quint32 at(double hostTime) const
+		{
+			const double t = offset + (1.0 + skewPpm * 1.0e-6) * hostTime;
+
+			return static_cast<quint32>(static_cast<qint64>(std::floor(t)));
+		}
+	};
+
+	/**
+	 * \brief Returns a random number in [min, max)
+	 */
+	double randomBetween(double min, double max)
+	{
+		return min + (max - min) * (double(qrand()) / (double(RAND_MAX) + 1.0));
+	}
+
+	/**
+	 * \brief Adds a ping/pong exchange
+	 *
+	 * The hardware reads its clock at a random time during the exchange
+	 * \param sync the object receiving the sample
+	 * \param clock the clock of the hardware
+	 * \param sendTime the host time at which the ping is sent
+	 * \param roundTripTime the round trip time of the exchange
+	 */
+	void exchange(ClockSync& sync, const SyntheticClock& clock, double sendTime, double roundTripTime)
+	{
+		const double readTime = sendTime + randomBetween(0.0, roundTripTime);
+		sync.addSample(sendTime, sendTime + roundTripTime, clock.at(readTime));
+	}
+
+	/**
+	 * \brief Returns the difference between the estimate and the real clock
+	 *
+	 * The difference is computed modulo 2^32, as the clock wraps around
+	 */
+	qint32 error(const ClockSync& sync, const SyntheticClock& clock, double hostTime)
+	{
+		return static_cast<qint32>(sync.hardwareTime(hostTime) - clock.at(hostTime));
+	}
+}
+
+/**
+ * \brief The class to perform unit tests
+ *
+ * Each private slot is a test
+ */
+class TestClockSync : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void synchronizedAfterMinSamples()
+	{
+		const SyntheticClock clock{5000.0, 0.0};
+		ClockSync sync;
+
+		for (int i = 0; i < ClockSync::minSamples; ++i) {
+			QVERIFY(!sync.synchronized());
+			exchange(sync, clock, i * 1000.0, 4.0);
+		}
+		QVERIFY(sync.synchronized());
+	}
+
+	void knownOffset_data()
+	{
+		QTest::addColumn<double>("offset");
+
+		QTest::newRow("ahead of the host") << 123456.0;
+		QTest::newRow("behind the host") << -98765.0;
+		QTest::newRow("wrapping around") << 4294967295.0 - 22000.0;
+	}
+
+	void knownOffset()
+	{
+		QFETCH(double, offset);
+
+		const SyntheticClock clock{offset, 0.0};
+		ClockSync sync;
+
+		// Without jitter the clock is read in the middle of the exchange,
+		// as ClockSync assumes
+		for (int i = 0; i < 5; ++i) {
+			const double sendTime = 20000.0 + i * 1000.0;
+			sync.addSample(sendTime, sendTime + 4.0, clock.at(sendTime + 2.0));
+		}
+
+		QVERIFY(sync.synchronized());
+		QCOMPARE(sync.skewPpm(), 0.0);
+		QVERIFY(sync.maxError() <= 3.0);
+		for (double t: {24000.0, 25000.0, 26500.0, 28000.0}) {
+			QVERIFY(std::abs(error(sync, clock, t)) <= 1);
+		}
+	}
+
+	void skewWithJitteredRoundTripTimes_data()
+	{
+		QTest::addColumn<double>("skewPpm");
+		QTest::addColumn<uint>("seed");
+
+		QTest::newRow("fast hardware") << 800.0 << 1u;
+		QTest::newRow("slow hardware") << -1500.0 << 2u;
+		QTest::newRow("no skew") << 0.0 << 3u;
+	}
+
+	void skewWithJitteredRoundTripTimes()
+	{
+		QFETCH(double, skewPpm);
+		QFETCH(uint, seed);
+
+		qsrand(seed);
+
+		const SyntheticClock clock{7000000.0, skewPpm};
+		ClockSync sync;
+
+		// One ping per second for a minute, with round trip times between 2
+		// and 6 milliseconds and some exchanges delayed in buffers. The
+		// delayed ones are far off and must be discarded
+		double sendTime = 1000.0;
+		for (int i = 0; i < 60; ++i, sendTime += 1000.0) {
+			const bool delayed = (i % 7) == 3;
+			exchange(sync, clock, sendTime, delayed ? randomBetween(100.0, 300.0) : randomBetween(2.0, 6.0));
+		}
+
+		QVERIFY(std::abs(sync.skewPpm() - skewPpm) < 100.0);
+		QVERIFY(sync.maxError() < 10.0);
+		// The estimate is used to schedule the next points, shortly after
+		// the last sample
+		for (double dt: {0.0, 500.0, 2000.0}) {
+			QVERIFY(std::abs(error(sync, clock, sendTime + dt)) <= 4);
+		}
+	}
+
+	void wrapAroundOfTheHardwareClock()
+	{
+		qsrand(4);
+
+		// The clock wraps around after 30 seconds
+		const SyntheticClock clock{4294967296.0 - 30000.0, 300.0};
+		ClockSync sync;
+
+		double sendTime = 0.0;
+		for (int i = 0; i < 60; ++i, sendTime += 1000.0) {
+			exchange(sync, clock, sendTime, randomBetween(2.0, 6.0));
+
+			if (sync.synchronized()) {
+				QVERIFY(std::abs(error(sync, clock, sendTime + 500.0)) <= 4);
+			}
+		}
+
+		QVERIFY(clock.at(sendTime) < 60000);
+		QVERIFY(std::abs(sync.skewPpm() - 300.0) < 100.0);
+	}
+
+	void clearForgetsPreviousSamples()
+	{
+		ClockSync sync;
+
+		const SyntheticClock before{100000.0, 0.0};
+		for (int i = 0; i < 10; ++i) {
+			sync.addSample(i * 1000.0, i * 1000.0 + 4.0, before.at(i * 1000.0 + 2.0));
+		}
+
+		// The hardware restarted, its clock starts from 0 again
+		sync.clear();
+		QVERIFY(!sync.synchronized());
+
+		const SyntheticClock after{-10000.0, 0.0};
+		for (int i = 10; i < 13; ++i) {
+			sync.addSample(i * 1000.0, i * 1000.0 + 4.0, after.at(i * 1000.0 + 2.0));
+		}
+		QVERIFY(sync.synchronized());
+		QVERIFY(std::abs(error(sync, after, 13000.0)) <= 1);
+	}
+};
+
+QTEST_MAIN(TestClockSync)
+#include "testclocksync.moc"
@@ -0,0 +1,245 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QtTest/QtTest>
+#include <algorithm>
+#include <cstring>
+#include "matrixblit.h"
+
+// NOTES AND TODOS
+//
+// Benchmarks measure the time on the PC, not on the AVR. Run them with
+// -tickcounter to get CPU cycles per frame: only the ratio between the two
+// paths is meaningful for the firmware
+
+namespace {
+	/**
+	 * \brief Draws bitmaps pixel by pixel as Adafruit_GFX::drawBitmap() does
+	 *        on an Adafruit_8x8matrix
+	 *
+	 * drawPixel() is virtual and has the same logic as
+	 * Adafruit_8x8matrix::drawPixel() in the firmware
+	 */
+	class PixelMatrix
+	{
+	public:
+		PixelMatrix(uint8_t rotation)
+			: m_rotation(rotation)
+		{
+			clear();
+		}
+
+		virtual ~PixelMatrix()
+		{
+		}
+
+		void clear()
+		{
+			std::fill(displaybuffer, displaybuffer + 8, 0);
+		}
+
+		void drawBitmap(const uint8_t rows[8])
+		{
+			for (int16_t j = 0; j < 8; ++j) {
+				for (int16_t i = 0; i < 8; ++i) {
+					if (rows[j] & (128 >> i)) {
+						drawPixel(i, j, 1);
+					}
+				}
+			}
+		}
+
+		virtual void drawPixel(int16_t x, int16_t y, uint16_t color)
+		{
+			if ((y < 0) || (y >= 8)) return;
+			if ((x < 0) || (x >= 8)) return;
+
+			switch (m_rotation) {
+				case 1:
+					std::swap(x, y);
+					x = 8 - x - 1;
+					break;
+				case 2:
+					x = 8 - x - 1;
+					y = 8 - y - 1;
+					break;
+				case 3:
+					std::swap(x, y);
+					y = 8 - y - 1;
+					break;
+			}
+
+			x += 7;
+			x %= 8;
+
+			if (color) {
+				displaybuffer[y] |= 1 << x;
+			} else {
+				displaybuffer[y] &= ~(1 << x);
+			}
+		}
+
+		uint16_t displaybuffer[8];
+
+	private:
+		const uint8_t m_rotation;
+	};
+
+	// The smile of the face
+	const uint8_t smile[8] = {0x00, 0x66, 0x00, 0x24, 0x00, 0x42, 0x3C, 0x00};
+}
+
+/**
+ * \brief The class to perform unit tests
+ *
+ * Each private slot is a test
+ */
+class TestMatrixBlit : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void reverseBits()
+	{
+		QCOMPARE(reverseMatrixRowBits(0x01), uint8_t(0x80));
+		QCOMPARE(reverseMatrixRowBits(0x0F), uint8_t(0xF0));
+		QCOMPARE(reverseMatrixRowBits(0x35), uint8_t(0xAC));
+	}
+
+	void singlePixels_data()
+	{
+		QTest::addColumn<int>("rotation");
+
+		QTest::newRow("rotation 0") << 0;
+		QTest::newRow("rotation 1") << 1;
+		QTest::newRow("rotation 2") << 2;
+		QTest::newRow("rotation 3") << 3;
+	}
+
+	void singlePixels()
+	{
+		QFETCH(int, rotation);
+
+		for (int j = 0; j < 8; ++j) {
+			for (int i = 0; i < 8; ++i) {
+				uint8_t rows[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+				rows[j] = 128 >> i;
+
+				PixelMatrix expected(rotation);
+				expected.drawBitmap(rows);
+				uint16_t displaybuffer[8];
+				blitMatrixRows(rows, rotation, displaybuffer);
+
+				for (int y = 0; y < 8; ++y) {
+					QCOMPARE(displaybuffer[y], expected.displaybuffer[y]);
+				}
+			}
+		}
+	}
+
+	void randomBitmaps_data()
+	{
+		singlePixels_data();
+	}
+
+	void randomBitmaps()
+	{
+		QFETCH(int, rotation);
+
+		qsrand(rotation);
+		for (int n = 0; n < 100; ++n) {
+			uint8_t rows[8];
+			for (int j = 0; j < 8; ++j) {
+				rows[j] = qrand() & 0xFF;
+			}
+
+			PixelMatrix expected(rotation);
+			expected.drawBitmap(rows);
+			// The blit replaces what was in the buffer
+			uint16_t displaybuffer[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+			blitMatrixRows(rows, rotation, displaybuffer);
+
+			for (int y = 0; y < 8; ++y) {
+				QCOMPARE(displaybuffer[y], expected.displaybuffer[y]);
+			}
+		}
+	}
+
+	void randomColumns_data()
+	{
+		singlePixels_data();
+	}
+
+	void randomColumns()
+	{
+		QFETCH(int, rotation);
+
+		qsrand(rotation);
+		for (int n = 0; n < 100; ++n) {
+			// Columns have the top pixel in the least significant bit
+			uint8_t columns[8];
+			uint8_t rows[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+			for (int i = 0; i < 8; ++i) {
+				columns[i] = qrand() & 0xFF;
+				for (int j = 0; j < 8; ++j) {
+					if (columns[i] & (1 << j)) {
+						rows[j] |= 128 >> i;
+					}
+				}
+			}
+
+			PixelMatrix expected(rotation);
+			expected.drawBitmap(rows);
+			uint16_t displaybuffer[8];
+			blitMatrixColumns(columns, rotation, displaybuffer);
+
+			for (int y = 0; y < 8; ++y) {
+				QCOMPARE(displaybuffer[y], expected.displaybuffer[y]);
+			}
+		}
+	}
+
+	void benchmarkDrawPixel()
+	{
+		// Rotation 3 is the one of the face on the robot
+		PixelMatrix matrix(3);
+
+		QBENCHMARK {
+			matrix.clear();
+			matrix.drawBitmap(smile);
+		}
+	}
+
+	void benchmarkBlit()
+	{
+		uint16_t displaybuffer[8];
+
+		QBENCHMARK {
+			blitMatrixRows(smile, 3, displaybuffer);
+		}
+
+		// Using the result, so that the compiler cannot remove the benchmark
+		QVERIFY(std::memcmp(displaybuffer, PixelMatrix(0).displaybuffer, sizeof(displaybuffer)) != 0);
+	}
+};
+
+QTEST_MAIN(TestMatrixBlit)
+#include "testmatrixblit.moc"
@@ -0,0 +1,291 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QtTest/QtTest>
+#include <cstdlib>
+#include "ratelimiter.h"
+
+// NOTES AND TODOS
+//
+// Positions have 8 fractional bits as in the firmware. Limits are given in
+// positions per second (squared) and are converted to coarser internal units,
+// so the checks below allow for the rounding of those units
+
+namespace {
+	/**
+	 * \brief Converts a position without fractional part to the format of
+	 *        RateLimiter
+	 */
+	unsigned int pos(unsigned int p)
+	{
+		return p << 8;
+	}
+
+	/**
+	 * \brief The maximum distance covered in dt milliseconds with the given
+	 *        maximum speed (in positions per second)
+	 */
+	long maxDistance(unsigned int maxSpeed, unsigned long dt)
+	{
+		return (long(maxSpeed) * 256l * long(dt)) / 1000l;
+	}
+
+	/**
+	 * \brief The maximum change of speed in dt milliseconds with the given
+	 *        maximum acceleration (in positions per second squared)
+	 *
+	 * Speeds are in 1/256 of position per millisecond, the unit the limiter
+	 * uses internally (its speed is never changed by less than one unit)
+	 */
+	long maxSpeedChange(unsigned int maxAcceleration, unsigned long dt)
+	{
+		return std::max(1l, (long(maxAcceleration) * 256l * long(dt)) / 1000000l);
+	}
+
+	/**
+	 * \brief Moves the limiter towards the target until it settles
+	 *
+	 * This checks at each step that the limiter never goes past the target
+	 * and never moves away from it when starting from rest
+	 * \param limiter the limiter
+	 * \param target the position to reach
+	 * \param dt the time between steps in milliseconds
+	 * \param maxTime the time within which the limiter must settle
+	 * \return the time the limiter took to settle or -1 if the checks fail
+	 */
+	long settle(RateLimiter& limiter, unsigned int target, unsigned long dt, unsigned long maxTime)
+	{
+		const bool up = target > limiter.position();
+		unsigned long time = 0;
+		unsigned int prev = limiter.position();
+
+		while (!limiter.settled(target)) {
+			if (time > maxTime) {
+				return -1;
+			}
+
+			const unsigned int p = limiter.update(target, dt);
+			time += dt;
+			if ((up && ((p < prev) || (p > target))) || (!up && ((p > prev) || (p < target)))) {
+				return -1;
+			}
+			prev = p;
+		}
+
+		return long(time);
+	}
+}
+
+/**
+ * \brief The class to perform unit tests
+ *
+ * Each private slot is a test
+ */
+class TestRateLimiter : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void withoutLimitsPositionsAreReturnedAsIs()
+	{
+		RateLimiter limiter;
+		limiter.reset(pos(10));
+
+		QVERIFY(!limiter.limited());
+		QCOMPARE(limiter.update(pos(200), 1), pos(200));
+		QVERIFY(!limiter.saturated());
+		QCOMPARE(limiter.update(pos(3) + 17, 0), pos(3) + 17);
+		QVERIFY(limiter.settled(pos(3) + 17));
+	}
+
+	void speedLimitIsReachedAndHonoured_data()
+	{
+		QTest::addColumn<unsigned int>("maxSpeed");
+		QTest::addColumn<unsigned int>("start");
+		QTest::addColumn<unsigned int>("target");
+		QTest::addColumn<unsigned int>("dt");
+
+		QTest::newRow("upwards") << 100u << pos(0) << pos(100) << 10u;
+		QTest::newRow("downwards") << 100u << pos(200) << pos(50) << 10u;
+		QTest::newRow("fast, short steps") << 1000u << pos(10) << pos(250) << 5u;
+		QTest::newRow("slow, 1ms steps") << 60u << pos(0) << pos(30) << 1u;
+		QTest::newRow("fractional target") << 100u << pos(20) << (pos(90) + 77) << 10u;
+	}
+
+	void speedLimitIsReachedAndHonoured()
+	{
+		QFETCH(unsigned int, maxSpeed);
+		QFETCH(unsigned int, start);
+		QFETCH(unsigned int, target);
+		QFETCH(unsigned int, dt);
+
+		RateLimiter limiter;
+		limiter.setLimits(maxSpeed, 0);
+		limiter.reset(start);
+
+		const long distance = std::labs(long(target) - long(start));
+		const long expectedTime = (distance * 1000l) / (long(maxSpeed) * 256l);
+		unsigned int prev = start;
+		long time = 0;
+		bool limitReached = false;
+		while (limiter.position() != target) {
+			QVERIFY(time <= (expectedTime * 105) / 100 + long(dt));
+
+			const unsigned int p = limiter.update(target, dt);
+			time += dt;
+
+			const long step = std::labs(long(p) - long(prev));
+			QVERIFY(step <= maxDistance(maxSpeed, dt));
+			// The limiter rounds the speed down to its internal units
+			if (step * 100 >= maxDistance(maxSpeed, dt) * 95) {
+				limitReached = true;
+			}
+			QVERIFY((target > start) ? (p <= target) : (p >= target));
+			prev = p;
+		}
+
+		QVERIFY(limitReached);
+		QVERIFY(time >= expectedTime);
+
+		// The speed drops to zero at the next step
+		QCOMPARE(limiter.update(target, dt), target);
+		QVERIFY(limiter.settled(target));
+	}
+
+	void accelerationIsLimited_data()
+	{
+		QTest::addColumn<unsigned int>("maxAcceleration");
+		QTest::addColumn<unsigned int>("dt");
+
+		QTest::newRow("10ms steps") << 1000u << 10u;
+		QTest::newRow("1ms steps") << 1000u << 1u;
+		QTest::newRow("high acceleration") << 20000u << 5u;
+	}
+
+	void accelerationIsLimited()
+	{
+		QFETCH(unsigned int, maxAcceleration);
+		QFETCH(unsigned int, dt);
+
+		RateLimiter limiter;
+		limiter.setLimits(0, maxAcceleration);
+		limiter.reset(pos(0));
+
+		// Going far away, so that the limiter accelerates for the whole test
+		const unsigned int target = pos(250);
+		const long dvMax = maxSpeedChange(maxAcceleration, dt);
+		unsigned int prev = limiter.position();
+		long prevSpeed = 0;
+		for (int i = 0; i < 20; ++i) {
+			const unsigned int p = limiter.update(target, dt);
+			const long speed = (long(p) - long(prev)) / long(dt);
+
+			QVERIFY(limiter.saturated());
+			QVERIFY(speed > prevSpeed);
+			QVERIFY((speed - prevSpeed) <= dvMax);
+
+			prev = p;
+			prevSpeed = speed;
+		}
+	}
+
+	void brakingStopsOnTheTarget_data()
+	{
+		QTest::addColumn<unsigned int>("maxSpeed");
+		QTest::addColumn<unsigned int>("maxAcceleration");
+		QTest::addColumn<unsigned int>("start");
+		QTest::addColumn<unsigned int>("target");
+		QTest::addColumn<unsigned int>("dt");
+
+		QTest::newRow("acceleration only") << 0u << 500u << pos(0) << pos(120) << 10u;
+		QTest::newRow("speed and acceleration") << 200u << 1000u << pos(10) << pos(240) << 10u;
+		QTest::newRow("downwards") << 200u << 1000u << pos(240) << pos(10) << 10u;
+		QTest::newRow("short movement") << 200u << 1000u << pos(100) << (pos(101) + 5) << 10u;
+		QTest::newRow("1ms steps") << 90u << 400u << pos(30) << pos(150) << 1u;
+		QTest::newRow("uneven steps") << 150u << 700u << pos(0) << (pos(200) + 200) << 7u;
+	}
+
+	void brakingStopsOnTheTarget()
+	{
+		QFETCH(unsigned int, maxSpeed);
+		QFETCH(unsigned int, maxAcceleration);
+		QFETCH(unsigned int, start);
+		QFETCH(unsigned int, target);
+		QFETCH(unsigned int, dt);
+
+		RateLimiter limiter;
+		limiter.setLimits(maxSpeed, maxAcceleration);
+		limiter.reset(start);
+
+		QVERIFY(settle(limiter, target, dt, 60000) > 0);
+		QCOMPARE(limiter.position(), target);
+
+		// Once settled the limiter stays where it is
+		QCOMPARE(limiter.update(target, dt), target);
+		QVERIFY(!limiter.saturated());
+	}
+
+	void brakingStopsOnACloserTarget()
+	{
+		RateLimiter limiter;
+		limiter.setLimits(200, 1000);
+		limiter.reset(pos(0));
+
+		// Getting up to speed, then asking to stop just ahead: the limiter
+		// brakes harder than its acceleration limit rather than going past
+		// the new target
+		for (int i = 0; i < 30; ++i) {
+			limiter.update(pos(250), 10);
+		}
+		const unsigned int target = limiter.position() + pos(2);
+
+		QVERIFY(settle(limiter, target, 10, 10000) > 0);
+		QCOMPARE(limiter.position(), target);
+	}
+
+	void saturationFlag()
+	{
+		RateLimiter limiter;
+		limiter.setLimits(100, 0);
+		limiter.reset(pos(50));
+
+		// 100 positions per second are 1 position in 10ms
+		QCOMPARE(limiter.update(pos(50) + 128, 10), pos(50) + 128);
+		QVERIFY(!limiter.saturated());
+		QVERIFY(limiter.update(pos(80), 10) < pos(80));
+		QVERIFY(limiter.saturated());
+
+		// A null interval does not move the servo and keeps the flag
+		const unsigned int p = limiter.position();
+		QCOMPARE(limiter.update(pos(80), 0), p);
+		QVERIFY(limiter.saturated());
+
+		limiter.reset(pos(20));
+		QVERIFY(!limiter.saturated());
+
+		limiter.setLimits(0, 0);
+		QCOMPARE(limiter.update(pos(200), 10), pos(200));
+		QVERIFY(!limiter.saturated());
+	}
+};
+
+QTEST_MAIN(TestRateLimiter)
+#include "testratelimiter.moc"
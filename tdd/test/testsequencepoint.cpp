@@ -44,6 +44,7 @@ private slots:
 		QCOMPARE(p.point.size(), static_cast<decltype(p.point.size())>(7));
 		QCOMPARE(p.duration, 0);
 		QCOMPARE(p.timeToTarget, 0);
+		QCOMPARE(p.profile, static_cast<int>(LinearProfile));
 	}
 
 	void pointConstruction()
@@ -86,6 +87,23 @@ private slots:
 		QCOMPARE(pointJsonObject, txtJsonObject);
 	}
 
+	void toJsonWithProfile()
+	{
+		const typename SequencePoint<2>::Array p = {17.2, 989.4};
+		const SequencePoint<2> point(p, 745, 9934, MinimumJerkProfile);
+		QJsonObject pointJsonObject = point.toJson();
+		QJsonObject txtJsonObject = QJsonDocument::fromJson("{\"duration\":745, \"point\":[17.2,989.4], \"timeToTarget\":9934, \"profile\":2}").object();
+
+		QCOMPARE(pointJsonObject, txtJsonObject);
+	}
+
+	void fromJsonWithoutProfile()
+	{
+		QJsonObject txtJsonObject = QJsonDocument::fromJson("{\"duration\":745, \"point\":[17.2,989.4], \"timeToTarget\":9934}").object();
+
+		QCOMPARE((SequencePoint<2>::fromJson(txtJsonObject)).profile, static_cast<int>(LinearProfile));
+	}
+
 	void fromJsonValid()
 	{
 		QJsonObject txtJsonObject = QJsonDocument::fromJson("{\"duration\":745, \"point\":[17.2,989.4], \"timeToTarget\":9934}").object();
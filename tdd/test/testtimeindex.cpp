@@ -0,0 +1,278 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QtTest/QtTest>
+#include "timeindex.h"
+
+// NOTES AND TODOS
+//
+// TimeIndex is part of the GUI, its source is compiled in this test (see
+// CMakeLists.txt). Every result is compared with the one computed by linear
+// sums on a plain list of intervals
+
+namespace {
+	/**
+	 * \brief Returns the sum of the first pos intervals
+	 */
+	qint64 linearPrefixSum(const QVector<qint64>& values, int pos)
+	{
+		qint64 sum = 0;
+		for (int i = 0; i < pos; ++i) {
+			sum += values[i];
+		}
+
+		return sum;
+	}
+
+	/**
+	 * \brief Returns the interval containing t, as TimeIndex::find() does
+	 *
+	 * This is the largest pos such that the sum of the first pos intervals
+	 * is not greater than t
+	 */
+	int linearFind(const QVector<qint64>& values, qint64 t)
+	{
+		int pos = 0;
+		qint64 sum = 0;
+		for (int i = 0; i < values.size(); ++i) {
+			sum += values[i];
+			if (sum > t) {
+				break;
+			}
+			pos = i + 1;
+		}
+
+		return pos;
+	}
+
+	/**
+	 * \brief Checks the index against the list of intervals
+	 *
+	 * Prefix sums are checked for all positions, find() for the start and
+	 * the end of all intervals and for some times in the middle
+	 * \return true if the index agrees with the list
+	 */
+	bool sameAsLinear(const TimeIndex& index, const QVector<qint64>& values)
+	{
+		if (index.size() != values.size()) {
+			return false;
+		}
+
+		for (int i = 0; i <= values.size(); ++i) {
+			const qint64 sum = linearPrefixSum(values, i);
+			if (index.prefixSum(i) != sum) {
+				return false;
+			}
+			if ((i < values.size()) && (index.value(i) != values[i])) {
+				return false;
+			}
+
+			for (qint64 t: {sum - 1, sum, sum + 1, sum + values.value(i) / 2}) {
+				const int expected = (t < 0) ? 0 : linearFind(values, t);
+				if (index.find(t) != expected) {
+					return false;
+				}
+			}
+		}
+
+		return index.total() == linearPrefixSum(values, values.size());
+	}
+
+	/**
+	 * \brief Returns a random interval length (some lengths are zero)
+	 */
+	qint64 randomLength()
+	{
+		return ((qrand() % 5) == 0) ? 0 : (qrand() % 1000);
+	}
+}
+
+/**
+ * \brief The class to perform unit tests
+ *
+ * Each private slot is a test
+ */
+class TestTimeIndex : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void emptyIndex()
+	{
+		TimeIndex index;
+
+		QCOMPARE(index.size(), 0);
+		QCOMPARE(index.total(), qint64(0));
+		QCOMPARE(index.prefixSum(0), qint64(0));
+		QCOMPARE(index.find(-1), 0);
+		QCOMPARE(index.find(0), 0);
+		QCOMPARE(index.find(100), 0);
+	}
+
+	void appendComputesPrefixSums()
+	{
+		TimeIndex index;
+		QVector<qint64> values;
+
+		for (qint64 v = 1; v <= 37; ++v) {
+			index.append(v * 10);
+			values.append(v * 10);
+
+			QVERIFY(sameAsLinear(index, values));
+		}
+	}
+
+	void findReturnsTheIntervalContainingTime()
+	{
+		TimeIndex index;
+		for (qint64 v: {100, 0, 50, 0, 0, 25}) {
+			index.append(v);
+		}
+
+		QCOMPARE(index.find(0), 0);
+		QCOMPARE(index.find(99), 0);
+		// Intervals with zero length are skipped
+		QCOMPARE(index.find(100), 2);
+		QCOMPARE(index.find(149), 2);
+		QCOMPARE(index.find(150), 5);
+		QCOMPARE(index.find(174), 5);
+		QCOMPARE(index.find(175), 6);
+		QCOMPARE(index.find(1000), 6);
+		QCOMPARE(index.find(-5), 0);
+	}
+
+	void setChangesPrefixSums()
+	{
+		TimeIndex index;
+		QVector<qint64> values;
+		for (qint64 v = 0; v < 20; ++v) {
+			index.append(v);
+			values.append(v);
+		}
+
+		for (int i = 0; i < values.size(); i += 3) {
+			index.set(i, 1000 - i);
+			values[i] = 1000 - i;
+
+			QVERIFY(sameAsLinear(index, values));
+		}
+	}
+
+	void insertAndRemoveRebuildTheTree_data()
+	{
+		QTest::addColumn<int>("pos");
+
+		QTest::newRow("first") << 0;
+		QTest::newRow("power of two") << 8;
+		QTest::newRow("middle") << 11;
+		QTest::newRow("last") << 16;
+	}
+
+	void insertAndRemoveRebuildTheTree()
+	{
+		QFETCH(int, pos);
+
+		TimeIndex index;
+		QVector<qint64> values;
+		for (qint64 v = 1; v <= 16; ++v) {
+			index.append(v);
+			values.append(v);
+		}
+
+		index.insert(pos, 500);
+		values.insert(pos, 500);
+		QVERIFY(sameAsLinear(index, values));
+
+		// Appending after an insertion must extend the rebuilt tree
+		index.append(7);
+		values.append(7);
+		QVERIFY(sameAsLinear(index, values));
+
+		index.remove(pos);
+		values.remove(pos);
+		QVERIFY(sameAsLinear(index, values));
+
+		index.remove(0);
+		values.remove(0);
+		QVERIFY(sameAsLinear(index, values));
+	}
+
+	void clearEmptiesTheIndex()
+	{
+		TimeIndex index;
+		for (qint64 v = 1; v <= 10; ++v) {
+			index.append(v);
+		}
+
+		index.clear();
+		QVERIFY(sameAsLinear(index, QVector<qint64>()));
+
+		index.append(42);
+		QVERIFY(sameAsLinear(index, QVector<qint64>{42}));
+	}
+
+	void randomOperationsMatchLinearSums_data()
+	{
+		QTest::addColumn<uint>("seed");
+
+		QTest::newRow("seed 1") << 1u;
+		QTest::newRow("seed 2") << 2u;
+		QTest::newRow("seed 3") << 3u;
+		QTest::newRow("seed 4") << 4u;
+	}
+
+	void randomOperationsMatchLinearSums()
+	{
+		QFETCH(uint, seed);
+
+		qsrand(seed);
+
+		TimeIndex index;
+		QVector<qint64> values;
+		for (int op = 0; op < 1000; ++op) {
+			const int choice = qrand() % 10;
+			if ((choice < 3) || values.isEmpty()) {
+				const qint64 v = randomLength();
+				index.append(v);
+				values.append(v);
+			} else if (choice < 5) {
+				const int pos = qrand() % (values.size() + 1);
+				const qint64 v = randomLength();
+				index.insert(pos, v);
+				values.insert(pos, v);
+			} else if (choice < 7) {
+				const int pos = qrand() % values.size();
+				index.remove(pos);
+				values.remove(pos);
+			} else {
+				const int pos = qrand() % values.size();
+				const qint64 v = randomLength();
+				index.set(pos, v);
+				values[pos] = v;
+			}
+
+			QVERIFY(sameAsLinear(index, values));
+		}
+	}
+};
+
+QTEST_MAIN(TestTimeIndex)
+#include "testtimeindex.moc"
@@ -0,0 +1,593 @@
+/******************************************************************************
+ * SequencerGUI                                                               *
+ * Copyright (C) 2015                                                         *
+ * Tomassino Ferrauto <t_ferrauto@yahoo.it>                                   *
+ * Luca Anastasio <anastasio.lu@gmail.com>                                    *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the GNU General Public License as published by       *
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software                *
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA *
+ ******************************************************************************/
+
+#include <QtTest/QtTest>
+#include "trajectory.h"
+#include "sequence.h"
+#include "interpolation.h"
+#include "hostplayer.h"
+
+// NOTES AND TODOS
+//
+//
+
+namespace {
+	/**
+	 * \brief The dimension of points, the same as in the firmware
+	 */
+	const int dim = HostPlayer::numServos();
+
+	/**
+	 * \brief Returns a point with all coordinates set to the same value
+	 *
+	 * \param v the value of coordinates
+	 * \param d the duration in milliseconds
+	 * \param t the time to target in milliseconds
+	 * \param pr the interpolation profile
+	 * \return a point with all coordinates set to v
+	 */
+	SequencePoint uniformPoint(double v, int d = 0, int t = 0, int pr = LinearProfile)
+	{
+		return SequencePoint(QVector<double>(dim, v), d, t, pr);
+	}
+
+	/**
+	 * \brief The minimum values of points, those accepted by the robot
+	 */
+	const SequencePoint minPoint = uniformPoint(0.0);
+
+	/**
+	 * \brief The maximum values of points, those accepted by the robot
+	 */
+	const SequencePoint maxPoint = uniformPoint(255.0, 65535, 65535);
+
+	/**
+	 * \brief Returns a pose with all servos in the same position
+	 *
+	 * \param v the position of servos, with 8 fractional bits
+	 * \return a pose with all servos in position v
+	 */
+	QVector<unsigned int> uniformPose(unsigned int v)
+	{
+		return QVector<unsigned int>(dim, v);
+	}
+
+	/**
+	 * \brief Returns a partial point updating the given channels
+	 *
+	 * Channels not updated are set to 0
+	 * \param values the values of channels, as (channel, value) pairs
+	 * \param d the duration in milliseconds
+	 * \param t the time to target in milliseconds
+	 * \param pr the interpolation profile
+	 * \return the partial point
+	 */
+	SequencePoint partialPoint(const QList<QPair<int, double>>& values, int d, int t, int pr = LinearProfile)
+	{
+		SequencePoint p(QVector<double>(dim, 0.0), d, t, pr);
+		p.channels.fill(false, dim);
+		for (const auto& v: values) {
+			p.point[v.first] = v.second;
+			p.channels[v.first] = true;
+		}
+
+		return p;
+	}
+
+	/**
+	 * \brief Fills a sequence with random points in the range accepted by
+	 *        the robot
+	 *
+	 * Points use all interpolation profiles in turn and about one in three
+	 * is partial
+	 * \param sequence the sequence to fill
+	 * \param numPoints the number of points to add
+	 * \param seed the seed of the random number generator
+	 * \param evenPlayTimes if true points are played for an even number of
+	 *                      milliseconds, so that play times are exact at
+	 *                      double speed
+	 * \param numProfiles how many interpolation profiles are used (1 means
+	 *                    that all points use LinearProfile)
+	 */
+	void generateRobotSequence(Sequence& sequence, int numPoints, uint seed, bool evenPlayTimes = false, int numProfiles = NumInterpolationProfiles)
+	{
+		qsrand(seed);
+
+		QList<SequencePoint> points;
+		for (int i = 0; i < numPoints; ++i) {
+			SequencePoint p(QVector<double>(dim), qrand() % 40, qrand() % 150, i % numProfiles);
+			for (auto& v: p.point) {
+				v = (qrand() % 25600) / 100.0;
+			}
+
+			if ((qrand() % 3) == 0) {
+				p.channels.fill(false, dim);
+				p.channels[qrand() % dim] = true;
+				for (int c = 0; c < dim; ++c) {
+					p.channels[c] = p.channels[c] || ((qrand() % 4) == 0);
+				}
+			}
+
+			if (evenPlayTimes && (((p.isPartial() ? 0 : p.timeToTarget) + p.duration + 1) % 2 != 0)) {
+				++p.duration;
+			}
+
+			points.append(p);
+		}
+
+		sequence.appendPoints(points);
+	}
+
+	/**
+	 * \brief Returns the points of a sequence
+	 *
+	 * \param sequence the sequence
+	 * \param from the index of the first point to return
+	 * \return the points of the sequence starting from the given one
+	 */
+	QList<SequencePoint> pointsOf(const Sequence& sequence, int from = 0)
+	{
+		QList<SequencePoint> points;
+		for (int i = from; i < sequence.numPoints(); ++i) {
+			points.append(sequence[i]);
+		}
+
+		return points;
+	}
+
+	/**
+	 * \brief Streams points to the SequencePlayer of the firmware
+	 *
+	 * Points are sent as soon as there is space in the buffer of the player
+	 * and step() is called once per millisecond. Scheduled points start
+	 * when the previous ones have been played, at the speed of the player
+	 * (as in SerialCommunication)
+	 * \param points the points to stream
+	 * \param startPose the pose of the robot before the first point starts
+	 * \param highResolution if true positions are sent with 16 bits
+	 * \param timeScale the time scale of the player (256 is normal speed)
+	 * \param scheduleStart the time at which the first point is scheduled
+	 *                      to start. If negative points are not scheduled
+	 * \param duration for how many milliseconds step() is called
+	 * \return the poses of the robot, one per millisecond
+	 */
+	QList<QVector<unsigned int>> playOnFirmware(const QList<SequencePoint>& points, const QVector<unsigned int>& startPose, bool highResolution, unsigned int timeScale, qint64 scheduleStart, unsigned long duration)
+	{
+		HostPlayer player(startPose);
+		player.setTimeScale(timeScale);
+
+		QList<QVector<unsigned int>> poses;
+		int nextPoint = 0;
+		qint64 elapsed = 0;
+		for (unsigned long m = 0; m < duration; ++m) {
+			while ((nextPoint < points.size()) && !player.bufferFull()) {
+				const SequencePoint& p = points[nextPoint];
+				const qint64 startTime = (scheduleStart < 0) ? -1 : (scheduleStart + (elapsed * 256) / timeScale);
+
+				player.addPoint(Trajectory::quantize(p.point, highResolution), p.duration, p.timeToTarget, p.profile, p.channels, startTime);
+				elapsed += p.isPartial() ? pointPlayTime(0, p.duration) : pointPlayTime(p.timeToTarget, p.duration);
+				++nextPoint;
+			}
+
+			player.step(m);
+			poses.append(player.pose());
+		}
+
+		return poses;
+	}
+
+	/**
+	 * \brief Streams a sequence to the firmware starting at the given time
+	 *
+	 * This is what SerialCommunication::startStreamAt() sends: the points
+	 * returned by Trajectory::seekPoints() and then those after the one
+	 * being played at the given time. Positions are sent with 16 bits
+	 * \param sequence the sequence to stream
+	 * \param t the time at which to start
+	 * \param delay set to how late the rest of the sequence starts
+	 * \return the poses of the robot, one per millisecond, until 10
+	 *         milliseconds after the end of the sequence
+	 */
+	QList<QVector<unsigned int>> seekOnFirmware(const Sequence& sequence, qint64 t, int* delay)
+	{
+		const Trajectory trajectory(sequence, true);
+		const QList<SequencePoint> points = trajectory.seekPoints(t, delay) + pointsOf(sequence, trajectory.pointAt(t) + 1);
+		const unsigned long duration = trajectory.totalTime() - t + *delay + 10;
+
+		return playOnFirmware(points, uniformPose(0), true, 256, -1, duration);
+	}
+
+	/**
+	 * \brief Returns the maximum distance covered by a servo in one
+	 *        millisecond
+	 *
+	 * \param trajectory the trajectory
+	 * \return the maximum distance covered by a servo in one millisecond
+	 */
+	unsigned int maxStep(const Trajectory& trajectory)
+	{
+		unsigned int m = 0;
+		for (qint64 t = 1; t <= trajectory.totalTime(); ++t) {
+			for (int c = 0; c < trajectory.pointDim(); ++c) {
+				m = std::max(m, unsigned(qAbs(int(trajectory.channelAt(c, t)) - int(trajectory.channelAt(c, t - 1)))));
+			}
+		}
+
+		return m;
+	}
+}
+
+/**
+ * \brief The class to perform unit tests
+ *
+ * Each private slot is a test
+ */
+class TestTrajectory : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void emptySequence()
+	{
+		const Sequence sequence(dim, minPoint, maxPoint);
+		const QVector<unsigned int> startPose = uniformPose(10 << 8);
+		const Trajectory trajectory(sequence, startPose);
+
+		QCOMPARE(trajectory.numPoints(), 0);
+		QCOMPARE(trajectory.totalTime(), qint64(0));
+		QCOMPARE(trajectory.pointAt(100), -1);
+		QCOMPARE(trajectory.poseAt(100), startPose);
+		QVERIFY(trajectory.seekPoints(100).isEmpty());
+	}
+
+	void quantization()
+	{
+		const QVector<double> p{-12.0, 100.7, 300.0};
+		const QVector<unsigned int> expected{0, 100 << 8, 255 << 8};
+		const QVector<unsigned int> expectedHighResolution{0, 25779, 255 << 8};
+
+		QCOMPARE(Trajectory::quantize(p), expected);
+		QCOMPARE(Trajectory::quantize(p, true), expectedHighResolution);
+	}
+
+	void startPoseIsTheFirstPoint()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({uniformPoint(100.7, 10, 10), uniformPoint(0.0)});
+		const Trajectory trajectory(sequence, true);
+
+		QCOMPARE(trajectory.pointDim(), dim);
+		QCOMPARE(trajectory.poseAt(0), uniformPose(25779));
+	}
+
+	void totalTime()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({uniformPoint(0.0, 100, 50), uniformPoint(10.0)});
+		const Trajectory trajectory(sequence);
+
+		QCOMPARE(trajectory.totalTime(), qint64(pointPlayTime(50, 100) + pointPlayTime(0, 0)));
+		QCOMPARE(trajectory.pointStartTime(1), qint64(pointPlayTime(50, 100)));
+	}
+
+	void totalTimeWithPartialPoints()
+	{
+		// Partial points do not wait for their channels to reach the target
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({uniformPoint(0.0), partialPoint({{0, 100.0}}, 10, 100), uniformPoint(0.0)});
+		const Trajectory trajectory(sequence);
+
+		QCOMPARE(trajectory.pointStartTime(2), qint64(pointPlayTime(0, 0) + pointPlayTime(0, 10)));
+		QCOMPARE(trajectory.totalTime(), qint64(pointPlayTime(0, 0) + pointPlayTime(0, 10) + pointPlayTime(0, 0)));
+	}
+
+	void lastPointWaitsForAllSegments()
+	{
+		// The last point ends when all channels reach the target, even
+		// those moving because of previous points
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({uniformPoint(0.0), partialPoint({{0, 100.0}}, 10, 100), partialPoint({{1, 100.0}}, 5, 20)});
+		const Trajectory trajectory(sequence);
+
+		QCOMPARE(trajectory.totalTime(), qint64(pointPlayTime(0, 0) + pointPlayTime(100, 0)));
+	}
+
+	void pointAt()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({uniformPoint(0.0, 10, 10), uniformPoint(10.0, 0, 5)});
+		const Trajectory trajectory(sequence);
+
+		QCOMPARE(trajectory.pointAt(-10), 0);
+		QCOMPARE(trajectory.pointAt(0), 0);
+		QCOMPARE(trajectory.pointAt(20), 0);
+		QCOMPARE(trajectory.pointAt(21), 1);
+		QCOMPARE(trajectory.pointAt(1000), 1);
+	}
+
+	void integerInterpolation()
+	{
+		QVector<unsigned int> startPose = uniformPose(0);
+		startPose[1] = 255 << 8;
+		QVector<double> target(dim, 0.0);
+		target[0] = 10.0;
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({SequencePoint(target, 0, 3)});
+		const Trajectory trajectory(sequence, startPose);
+
+		// Values are truncated as in the firmware
+		QCOMPARE(trajectory.channelAt(0, 1), 853u);
+		QCOMPARE(trajectory.channelAt(1, 1), 43520u);
+	}
+
+	void profilesReachTarget()
+	{
+		const QVector<unsigned int> startPose = uniformPose(0);
+
+		for (int profile = 0; profile < NumInterpolationProfiles; ++profile) {
+			Sequence sequence(dim, minPoint, maxPoint);
+			sequence.appendPoints({uniformPoint(200.0, 0, 100, profile)});
+			const Trajectory trajectory(sequence, startPose);
+
+			QCOMPARE(trajectory.poseAt(0), startPose);
+			QCOMPARE(trajectory.poseAt(100), uniformPose(200 << 8));
+
+			// Movements are monotonic
+			for (qint64 t = 1; t <= 100; ++t) {
+				QVERIFY(trajectory.channelAt(0, t) >= trajectory.channelAt(0, t - 1));
+			}
+		}
+	}
+
+	void smoothProfilesStartSlowly()
+	{
+		const QVector<unsigned int> startPose = uniformPose(0);
+		Sequence linear(dim, minPoint, maxPoint);
+		linear.appendPoints({uniformPoint(255.0, 0, 1000)});
+		const Trajectory linearTrajectory(linear, startPose);
+
+		for (int profile = CubicProfile; profile < NumInterpolationProfiles; ++profile) {
+			Sequence sequence(dim, minPoint, maxPoint);
+			sequence.appendPoints({uniformPoint(255.0, 0, 1000, profile)});
+			const Trajectory trajectory(sequence, startPose);
+
+			// Symmetric profiles are at half way at half time, behind the
+			// linear one before and ahead after
+			QCOMPARE(trajectory.channelAt(0, 500), 32640u);
+			QVERIFY(trajectory.channelAt(0, 100) < linearTrajectory.channelAt(0, 100));
+			QVERIFY(trajectory.channelAt(0, 900) > linearTrajectory.channelAt(0, 900));
+		}
+	}
+
+	void partialPointsKeepSegmentsRunning()
+	{
+		// Channel 0 moves for 100 milliseconds while the following points
+		// start, channel 1 starts moving 10 milliseconds later and channel 2
+		// is moved by a full point from where it is
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({partialPoint({{0, 100.0}}, 9, 100), partialPoint({{1, 200.0}}, 9, 50), partialPoint({{2, 50.0}, {0, 100.0}}, 0, 0)});
+		const Trajectory trajectory(sequence, uniformPose(0));
+
+		QCOMPARE(trajectory.channelAt(0, 15), interpolatePosition(0, 100 << 8, 15, 100));
+		QCOMPARE(trajectory.channelAt(1, 15), interpolatePosition(0, 200 << 8, 5, 50));
+		QCOMPARE(trajectory.channelAt(2, 15), 0u);
+		QCOMPARE(trajectory.channelAt(2, 20), 50u << 8);
+
+		// Channel 0 is updated again by the third point, jumping to the
+		// target
+		QCOMPARE(trajectory.segmentAt(0, 15).point, 0);
+		QCOMPARE(trajectory.segmentAt(0, 20).point, 2);
+		QCOMPARE(trajectory.segmentAt(0, 20).start, interpolatePosition(0, 100 << 8, 20, 100));
+		QCOMPARE(trajectory.channelAt(0, 20), 100u << 8);
+
+		// Channel 1 has not reached the target yet when the last point
+		// starts, the sequence ends when it does
+		QCOMPARE(trajectory.segmentAt(1, 30).point, 1);
+		QCOMPARE(trajectory.segmentAt(1, 30).startTime, qint64(10));
+		QCOMPARE(trajectory.segmentAt(3, 30).point, -1);
+		QCOMPARE(trajectory.totalTime(), qint64(61));
+		QCOMPARE(trajectory.channelAt(1, 59), interpolatePosition(0, 200 << 8, 49, 50));
+		QCOMPARE(trajectory.channelAt(1, 60), 200u << 8);
+	}
+
+	void sameAsFirmware_data()
+	{
+		QTest::addColumn<bool>("highResolution");
+		QTest::addColumn<unsigned int>("timeScale");
+		QTest::addColumn<qint64>("scheduleStart");
+		QTest::addColumn<uint>("seed");
+
+		QTest::newRow("8 bits") << false << 256u << qint64(-1) << 1u;
+		QTest::newRow("16 bits") << true << 256u << qint64(-1) << 2u;
+		QTest::newRow("half speed") << true << 128u << qint64(-1) << 3u;
+		QTest::newRow("double speed") << true << 512u << qint64(-1) << 4u;
+		QTest::newRow("scheduled") << true << 256u << qint64(37) << 5u;
+		QTest::newRow("scheduled at double speed") << false << 512u << qint64(20) << 6u;
+	}
+
+	void sameAsFirmware()
+	{
+		QFETCH(bool, highResolution);
+		QFETCH(unsigned int, timeScale);
+		QFETCH(qint64, scheduleStart);
+		QFETCH(uint, seed);
+
+		// At double speed the firmware moves to the next point after an even
+		// number of milliseconds
+		Sequence sequence(dim, minPoint, maxPoint);
+		generateRobotSequence(sequence, 40, seed, timeScale > 256);
+		QVector<unsigned int> startPose(dim);
+		for (int c = 0; c < dim; ++c) {
+			startPose[c] = (c * 16) << 8;
+		}
+		const Trajectory trajectory(sequence, startPose, highResolution);
+
+		// The time in the trajectory is the time elapsed since the first
+		// point started, scaled
+		const qint64 start = std::max(qint64(0), scheduleStart);
+		const unsigned long duration = start + (trajectory.totalTime() * 256) / timeScale + 10;
+		const QList<QVector<unsigned int>> poses = playOnFirmware(pointsOf(sequence), startPose, highResolution, timeScale, scheduleStart, duration);
+
+		for (int m = 0; m < poses.size(); ++m) {
+			const qint64 t = (m < start) ? -1 : (((m - start) * timeScale) / 256);
+
+			QCOMPARE(trajectory.poseAt(t), poses[m]);
+		}
+	}
+
+	void seekStartsFromThePose()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		generateRobotSequence(sequence, 20, 9);
+		const Trajectory trajectory(sequence, true);
+
+		for (qint64 t = 0; t < trajectory.totalTime(); t += 17) {
+			const QList<SequencePoint> points = trajectory.seekPoints(t);
+
+			QVERIFY(!points.isEmpty());
+			QVERIFY(!points[0].isPartial());
+			QCOMPARE(points[0].timeToTarget, 0);
+			QCOMPARE(Trajectory::quantize(points[0].point, true), trajectory.poseAt(t));
+
+			// The other points restart the segments still running, each
+			// channel at most once
+			QVector<bool> restarted(dim, false);
+			for (int i = 1; i < points.size(); ++i) {
+				QVERIFY(points[i].isPartial());
+				for (int c = 0; c < dim; ++c) {
+					if (points[i].updatesChannel(c)) {
+						const Trajectory::Segment segment = trajectory.segmentAt(c, t);
+						QVERIFY(!restarted[c]);
+						QVERIFY((segment.startTime + segment.timeToTarget) > t);
+						QCOMPARE(Trajectory::quantize(points[i].point, true)[c], segment.target);
+						restarted[c] = true;
+					}
+				}
+			}
+		}
+	}
+
+	void seekMatchesFirmware_data()
+	{
+		QTest::addColumn<uint>("seed");
+
+		QTest::newRow("seed 10") << 10u;
+		QTest::newRow("seed 11") << 11u;
+		QTest::newRow("seed 12") << 12u;
+	}
+
+	void seekMatchesFirmware()
+	{
+		QFETCH(uint, seed);
+
+		// With linear profiles the restarted segments only differ from the
+		// original ones because they start at most one millisecond per
+		// point sent later (and for rounding)
+		Sequence sequence(dim, minPoint, maxPoint);
+		generateRobotSequence(sequence, 15, seed, false, 1);
+		const Trajectory trajectory(sequence, true);
+		const unsigned int step = maxStep(trajectory);
+
+		// Times at which the rest of the sequence would start late are
+		// tested below
+		int numSeeks = 0;
+		for (qint64 t = 3; t < trajectory.totalTime(); t += 41) {
+			int delay = 0;
+			const int numSeekPoints = trajectory.seekPoints(t, &delay).size();
+			if (delay != 0) {
+				continue;
+			}
+			const QList<QVector<unsigned int>> poses = seekOnFirmware(sequence, t, &delay);
+			++numSeeks;
+
+			QCOMPARE(poses[0], trajectory.poseAt(t));
+			for (int m = 0; m < poses.size(); ++m) {
+				const QVector<unsigned int> expected = trajectory.poseAt(t + m);
+				for (int c = 0; c < dim; ++c) {
+					QVERIFY(unsigned(qAbs(int(poses[m][c]) - int(expected[c]))) <= (numSeekPoints * step + 2));
+				}
+			}
+
+			// The sequence ends when it would
+			QCOMPARE(poses[trajectory.totalTime() - t - 1], trajectory.poseAt(trajectory.totalTime()));
+		}
+		QVERIFY(numSeeks > 10);
+	}
+
+	void seekIsLateWhenThePointIsTooShort()
+	{
+		// Channels 0, 1 and 2 are moved by three partial points. One
+		// millisecond before the third point ends, four points are needed
+		Sequence sequence(dim, minPoint, maxPoint);
+		sequence.appendPoints({partialPoint({{0, 100.0}}, 9, 100), partialPoint({{1, 100.0}}, 9, 100), partialPoint({{2, 100.0}}, 9, 100), uniformPoint(200.0, 0, 50)});
+		const Trajectory trajectory(sequence, true);
+
+		int delay = 0;
+		const QList<SequencePoint> points = trajectory.seekPoints(29, &delay);
+		QCOMPARE(points.size(), 4);
+		QCOMPARE(points.last().duration, 0);
+		QCOMPARE(delay, 3);
+
+		// The last point starts 3 milliseconds late
+		const QList<QVector<unsigned int>> poses = seekOnFirmware(sequence, 29, &delay);
+		const int lastPointStart = trajectory.pointStartTime(3) - 29 + 3;
+		QVERIFY(poses[lastPointStart + 50] == uniformPose(200 << 8));
+		QVERIFY(poses[lastPointStart + 49] != uniformPose(200 << 8));
+	}
+
+	void channelAt()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		generateRobotSequence(sequence, 10, 7);
+		const Trajectory trajectory(sequence);
+
+		for (qint64 t = 0; t <= trajectory.totalTime(); t += 7) {
+			const auto pose = trajectory.poseAt(t);
+
+			for (int c = 0; c < dim; ++c) {
+				QCOMPARE(trajectory.channelAt(c, t), pose[c]);
+			}
+		}
+	}
+
+	void render()
+	{
+		Sequence sequence(dim, minPoint, maxPoint);
+		generateRobotSequence(sequence, 20, 8);
+		const Trajectory trajectory(sequence);
+		const qint64 period = 13;
+
+		const QVector<unsigned int> buffer = trajectory.render(period);
+
+		const int numPoses = trajectory.totalTime() / period + 1;
+		QCOMPARE(buffer.size(), numPoses * dim);
+		for (int k = 0; k < numPoses; ++k) {
+			const auto pose = trajectory.poseAt(k * period);
+
+			for (int c = 0; c < dim; ++c) {
+				QCOMPARE(buffer[k * dim + c], pose[c]);
+			}
+		}
+	}
+};
+
+QTEST_MAIN(TestTrajectory)
+#include "testtrajectory.moc"